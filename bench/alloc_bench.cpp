@@ -0,0 +1,99 @@
+#include "bench.h"
+
+#include <videoPlayer/frame_types.h>
+
+#include <memory>
+#include <string>
+
+extern "C"
+{
+#include <libavutil/buffer.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/mem.h>
+}
+
+// Выделение буферов на каждый кадр (как сейчас в decode_video и
+// decode_audio) против переиспользования через AVBufferPool.
+
+namespace
+{
+    constexpr size_t PAGE_SIZE = 4096;
+
+    // Касаемся каждой страницы: большие буферы malloc отдаёт через mmap,
+    // и основная цена — page faults при первой записи
+    void touch_pages(uint8_t* data, size_t size)
+    {
+        for (size_t offset = 0; offset < size; offset += PAGE_SIZE)
+        {
+            data[offset] = static_cast<uint8_t>(offset);
+        }
+        bench_do_not_optimize(data[0]);
+    }
+
+    void bench_frame_buffers(BenchContext& context, const std::string& label, int width, int height)
+    {
+        size_t size = static_cast<size_t>(av_image_get_buffer_size(AV_PIX_FMT_RGB24, width, height, 1));
+
+        context.run("alloc/rgb24_malloc/" + label, [size](uint64_t iterations)
+        {
+            for (uint64_t i = 0; i < iterations; i++)
+            {
+                uint8_t* buffer = static_cast<uint8_t*>(av_malloc(size));
+                touch_pages(buffer, size);
+                av_free(buffer);
+            }
+        });
+
+        AVBufferPool* pool = av_buffer_pool_init(size, nullptr);
+        context.run("alloc/rgb24_pool/" + label, [pool, size](uint64_t iterations)
+        {
+            for (uint64_t i = 0; i < iterations; i++)
+            {
+                AVBufferRef* buffer = av_buffer_pool_get(pool);
+                touch_pages(buffer->data, size);
+                av_buffer_unref(&buffer);
+            }
+        });
+        av_buffer_pool_uninit(&pool);
+    }
+
+    void bench_audio_frames(BenchContext& context)
+    {
+        constexpr int size = 1024 * 2 * sizeof(int16_t);
+
+        context.run("alloc/audio_frame_make_shared", [](uint64_t iterations)
+        {
+            for (uint64_t i = 0; i < iterations; i++)
+            {
+                auto frame = std::make_shared<AudioFrame>();
+                frame->data = static_cast<uint8_t*>(av_malloc(size));
+                frame->size = size;
+                frame->data[0] = 1;
+                bench_do_not_optimize(frame->data[0]);
+            }
+        });
+
+        AVBufferPool* pool = av_buffer_pool_init(size, nullptr);
+        context.run("alloc/audio_frame_pool", [pool](uint64_t iterations)
+        {
+            for (uint64_t i = 0; i < iterations; i++)
+            {
+                AVBufferRef* buffer = av_buffer_pool_get(pool);
+                buffer->data[0] = 1;
+                bench_do_not_optimize(buffer->data[0]);
+                av_buffer_unref(&buffer);
+            }
+        });
+        av_buffer_pool_uninit(&pool);
+    }
+
+    void register_alloc_benchmarks(BenchContext& context)
+    {
+        bench_frame_buffers(context, "480p", 854, 480);
+        bench_frame_buffers(context, "1080p", 1920, 1080);
+        bench_frame_buffers(context, "4k", 3840, 2160);
+        bench_audio_frames(context);
+    }
+
+    BenchGroup alloc_group("alloc", register_alloc_benchmarks);
+}
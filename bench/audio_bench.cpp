@@ -0,0 +1,169 @@
+#include "bench.h"
+
+#include <videoPlayer/audio_decoder.h>
+#include <videoPlayer/shared_data.h>
+#include <videoPlayer/time_stretch.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+extern "C"
+{
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+#include <libswresample/swresample.h>
+}
+
+namespace
+{
+    // Параметры устройства, которые запрашивает initialize_audio
+    constexpr int DEVICE_RATE = 48000;
+    constexpr int DEVICE_CHANNELS = 2;
+    constexpr int DEVICE_SAMPLES = 4096;
+    constexpr int BYTES_PER_SAMPLE = DEVICE_CHANNELS * sizeof(int16_t);
+
+    std::shared_ptr<AudioFrame> make_audio_frame(int samples)
+    {
+        auto frame = std::make_shared<AudioFrame>();
+        frame->size = samples * BYTES_PER_SAMPLE;
+        frame->data = static_cast<uint8_t*>(av_malloc(frame->size));
+        frame->samples = samples;
+        frame->sample_rate = DEVICE_RATE;
+        for (int i = 0; i < frame->size; i++)
+        {
+            frame->data[i] = static_cast<uint8_t>(i * 7);
+        }
+        return frame;
+    }
+
+    // Один вызов колбэка на итерацию; очередь заранее пополняется копиями
+    // shared_ptr на одни и те же кадры, так что данные не перевыделяются
+    void bench_callback(BenchContext& context, const std::string& name, int frame_samples)
+    {
+        SharedData shared;
+        auto frame = make_audio_frame(frame_samples);
+        int len = DEVICE_SAMPLES * BYTES_PER_SAMPLE;
+        int frames_per_call = DEVICE_SAMPLES / frame_samples + 2;
+        std::vector<uint8_t> stream(len);
+
+        context.run(name, [&](uint64_t iterations)
+        {
+            for (uint64_t i = 0; i < iterations; i++)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(shared.audio_mutex);
+                    while (static_cast<int>(shared.audio_queue.size()) < frames_per_call)
+                    {
+                        shared.audio_queue.push(frame);
+                    }
+                }
+                audio_callback(&shared, stream.data(), len);
+                bench_do_not_optimize(stream[0]);
+            }
+        }, static_cast<double>(len));
+    }
+
+    void bench_resample(BenchContext& context, const std::string& name, AVSampleFormat in_format,
+        int in_rate, int in_channels)
+    {
+        constexpr int in_samples = 1024;
+
+        AVChannelLayout in_layout;
+        AVChannelLayout out_layout;
+        av_channel_layout_default(&in_layout, in_channels);
+        av_channel_layout_default(&out_layout, DEVICE_CHANNELS);
+
+        SwrContext* swr_ctx = nullptr;
+        if (swr_alloc_set_opts2(&swr_ctx, &out_layout, AV_SAMPLE_FMT_S16, DEVICE_RATE,
+                &in_layout, in_format, in_rate, 0, nullptr) < 0 ||
+            swr_init(swr_ctx) < 0)
+        {
+            std::cerr << "Skipping " << name << ": could not set up swresample" << std::endl;
+            swr_free(&swr_ctx);
+            av_channel_layout_uninit(&in_layout);
+            av_channel_layout_uninit(&out_layout);
+            return;
+        }
+
+        uint8_t** in_data = nullptr;
+        int in_linesize = 0;
+        av_samples_alloc_array_and_samples(&in_data, &in_linesize, in_channels, in_samples, in_format, 0);
+        int planes = av_sample_fmt_is_planar(in_format) ? in_channels : 1;
+        for (int p = 0; p < planes; p++)
+        {
+            for (int i = 0; i < in_linesize; i++)
+            {
+                in_data[p][i] = static_cast<uint8_t>((i * 13 + p) & 0x3F);
+            }
+        }
+
+        int out_capacity = static_cast<int>(av_rescale_rnd(in_samples * 2, DEVICE_RATE, in_rate, AV_ROUND_UP));
+        uint8_t** out_data = nullptr;
+        int out_linesize = 0;
+        av_samples_alloc_array_and_samples(&out_data, &out_linesize, DEVICE_CHANNELS, out_capacity,
+            AV_SAMPLE_FMT_S16, 0);
+
+        context.run(name, [&](uint64_t iterations)
+        {
+            for (uint64_t i = 0; i < iterations; i++)
+            {
+                int converted = swr_convert(swr_ctx, out_data, out_capacity,
+                    (const uint8_t**)in_data, in_samples);
+                bench_do_not_optimize(converted);
+            }
+        }, static_cast<double>(in_samples) * in_channels * av_get_bytes_per_sample(in_format));
+
+        av_freep(&out_data[0]);
+        av_freep(&out_data);
+        av_freep(&in_data[0]);
+        av_freep(&in_data);
+        swr_free(&swr_ctx);
+        av_channel_layout_uninit(&in_layout);
+        av_channel_layout_uninit(&out_layout);
+    }
+
+    // Один кадр AAC (1024 сэмпла стерео) через растяжение; стоимость на
+    // отрезок постоянна, так что время на кадр и есть доля ядра
+    void bench_stretch(BenchContext& context, const std::string& name, double speed)
+    {
+        constexpr int samples = 1024;
+        std::vector<int16_t> input(samples * DEVICE_CHANNELS);
+        for (size_t i = 0; i < input.size(); i++)
+        {
+            input[i] = static_cast<int16_t>((i * 37) % 20000 - 10000);
+        }
+
+        TimeStretch stretch(DEVICE_RATE, DEVICE_CHANNELS);
+        stretch.set_speed(speed);
+        std::vector<int16_t> output;
+
+        context.run(name, [&](uint64_t iterations)
+        {
+            for (uint64_t i = 0; i < iterations; i++)
+            {
+                stretch.process(input.data(), samples, output);
+                bench_do_not_optimize(output.size());
+            }
+        }, static_cast<double>(samples) * BYTES_PER_SAMPLE);
+    }
+
+    void register_audio_benchmarks(BenchContext& context)
+    {
+        // 1024 сэмпла (AAC) делят буфер устройства нацело; 1152 (MP3) — нет,
+        // и колбэк проходит через ветку с частичным кадром
+        bench_callback(context, "audio_callback/aac_1024", 1024);
+        bench_callback(context, "audio_callback/mp3_1152", 1152);
+
+        bench_resample(context, "swresample/fltp_44100_stereo", AV_SAMPLE_FMT_FLTP, 44100, 2);
+        bench_resample(context, "swresample/fltp_48000_stereo", AV_SAMPLE_FMT_FLTP, 48000, 2);
+        bench_resample(context, "swresample/fltp_48000_5.1", AV_SAMPLE_FMT_FLTP, 48000, 6);
+        bench_resample(context, "swresample/s16_48000_stereo", AV_SAMPLE_FMT_S16, 48000, 2);
+
+        bench_stretch(context, "time_stretch/x0.5", 0.5);
+        bench_stretch(context, "time_stretch/x1.5", 1.5);
+        bench_stretch(context, "time_stretch/x2", 2.0);
+    }
+
+    BenchGroup audio_group("audio", register_audio_benchmarks);
+}
@@ -0,0 +1,67 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Минимальный харнесс микробенчмарков: функция выполняет заданное число
+// итераций, харнесс подбирает их количество под min_time и берёт медиану
+// нескольких повторов.
+
+struct BenchResult
+{
+    std::string name;
+    uint64_t iterations = 0;
+    double ns_per_op = 0.0;
+    double bytes_per_op = 0.0;
+};
+
+class BenchContext
+{
+public:
+    BenchContext(std::string filter, double min_time_ms, int repetitions, std::ostream& log);
+
+    // body(iterations) выполняет iterations операций
+    void run(const std::string& name, const std::function<void(uint64_t)>& body,
+        double bytes_per_op = 0.0);
+
+    const std::vector<BenchResult>& results() const
+    {
+        return results_;
+    }
+
+private:
+    std::string filter_;
+    double min_time_ms_;
+    int repetitions_;
+    std::ostream& log_;
+    std::vector<BenchResult> results_;
+};
+
+using BenchRegistrar = void (*)(BenchContext&);
+
+// Каждый файл с бенчмарками регистрирует свою группу статическим объектом
+struct BenchGroup
+{
+    BenchGroup(const char* name, BenchRegistrar registrar);
+};
+
+struct BenchGroupEntry
+{
+    const char* name;
+    BenchRegistrar registrar;
+};
+
+std::vector<BenchGroupEntry>& bench_groups();
+
+// Не даёт компилятору выбросить вычисления, результат которых не используется
+template <typename T>
+inline void bench_do_not_optimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+#endif
@@ -0,0 +1,184 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+BenchGroup::BenchGroup(const char* name, BenchRegistrar registrar)
+{
+    bench_groups().push_back(BenchGroupEntry{name, registrar});
+}
+
+std::vector<BenchGroupEntry>& bench_groups()
+{
+    static std::vector<BenchGroupEntry> groups;
+    return groups;
+}
+
+BenchContext::BenchContext(std::string filter, double min_time_ms, int repetitions,
+    std::ostream& log)
+    : filter_(std::move(filter))
+    , min_time_ms_(min_time_ms)
+    , repetitions_(std::max(1, repetitions))
+    , log_(log)
+{
+}
+
+void BenchContext::run(const std::string& name, const std::function<void(uint64_t)>& body,
+    double bytes_per_op)
+{
+    if (!filter_.empty() && name.find(filter_) == std::string::npos)
+        return;
+
+    using clock = std::chrono::steady_clock;
+    auto time_ms = [&body](uint64_t iterations)
+    {
+        auto start = clock::now();
+        body(iterations);
+        return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    };
+
+    // Прогрев и подбор числа итераций
+    uint64_t iterations = 1;
+    double elapsed = time_ms(iterations);
+    while (elapsed < min_time_ms_ && iterations < (uint64_t(1) << 40))
+    {
+        double scale = elapsed > 0.0 ? min_time_ms_ / elapsed * 1.2 : 10.0;
+        iterations = std::max(iterations + 1, static_cast<uint64_t>(iterations * std::min(scale, 10.0)));
+        elapsed = time_ms(iterations);
+    }
+
+    std::vector<double> samples;
+    for (int i = 0; i < repetitions_; i++)
+    {
+        samples.push_back(time_ms(iterations) * 1e6 / iterations);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.ns_per_op = samples[samples.size() / 2];
+    result.bytes_per_op = bytes_per_op;
+    results_.push_back(result);
+
+    log_ << std::left << std::setw(48) << name << std::right
+         << std::setw(14) << std::fixed << std::setprecision(1) << result.ns_per_op << " ns/op";
+    if (bytes_per_op > 0.0)
+    {
+        log_ << std::setw(12) << std::setprecision(1)
+             << bytes_per_op / result.ns_per_op * 1e9 / (1024.0 * 1024.0) << " MiB/s";
+    }
+    log_ << std::endl;
+}
+
+static std::string results_json(const std::vector<BenchResult>& results)
+{
+    std::ostringstream out;
+    out << std::setprecision(6);
+    out << "{\n  \"timestamp\": " << std::time(nullptr)
+        << ",\n  \"hardware_concurrency\": " << std::thread::hardware_concurrency()
+        << ",\n  \"results\": [";
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult& r = results[i];
+        out << (i ? ",\n" : "\n")
+            << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+            << ", \"ns_per_op\": " << r.ns_per_op;
+        if (r.bytes_per_op > 0.0)
+        {
+            out << ", \"bytes_per_second\": " << r.bytes_per_op / r.ns_per_op * 1e9;
+        }
+        out << "}";
+    }
+
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+static void print_usage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options]" << std::endl
+              << "  --filter <substr>   run only benchmarks whose name contains <substr>" << std::endl
+              << "  --min-time <ms>     minimum time per measurement (default 200)" << std::endl
+              << "  --repetitions <n>   measurements per benchmark, median is reported (default 5)" << std::endl
+              << "  --json <file>       write results as JSON ('-' for stdout)" << std::endl
+              << "  --list              list benchmark groups" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string filter;
+    std::string json_path;
+    double min_time_ms = 200.0;
+    int repetitions = 5;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (std::strcmp(arg, "--filter") == 0 && has_value)
+        {
+            filter = argv[++i];
+        }
+        else if (std::strcmp(arg, "--min-time") == 0 && has_value)
+        {
+            min_time_ms = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--repetitions") == 0 && has_value)
+        {
+            repetitions = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--json") == 0 && has_value)
+        {
+            json_path = argv[++i];
+        }
+        else if (std::strcmp(arg, "--list") == 0)
+        {
+            for (const BenchGroupEntry& group : bench_groups())
+            {
+                std::cout << group.name << std::endl;
+            }
+            return 0;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return std::strcmp(arg, "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    // С --json - таблица уходит в stderr, чтобы stdout оставался валидным JSON
+    BenchContext context(filter, min_time_ms, repetitions, json_path == "-" ? std::cerr : std::cout);
+    for (const BenchGroupEntry& group : bench_groups())
+    {
+        group.registrar(context);
+    }
+
+    if (json_path == "-")
+    {
+        std::cout << results_json(context.results());
+    }
+    else if (!json_path.empty())
+    {
+        std::ofstream file(json_path);
+        if (!file)
+        {
+            std::cerr << "Could not write " << json_path << std::endl;
+            return 1;
+        }
+        file << results_json(context.results());
+    }
+
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "bench.h"
+
+#include <iostream>
+#include <string>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+// Преобразование декодированного кадра в RGB24 так же, как это делает
+// decode_video (sws_scale, SWS_BILINEAR, буфер с выравниванием 1).
+
+namespace
+{
+    struct Resolution
+    {
+        const char* name;
+        int width;
+        int height;
+    };
+
+    const Resolution resolutions[] = {
+        {"480p", 854, 480},
+        {"1080p", 1920, 1080},
+        {"4k", 3840, 2160},
+    };
+
+    const AVPixelFormat source_formats[] = {
+        AV_PIX_FMT_YUV420P,
+        AV_PIX_FMT_YUVJ420P,
+        AV_PIX_FMT_NV12,
+        AV_PIX_FMT_YUV422P,
+        AV_PIX_FMT_YUV444P,
+        AV_PIX_FMT_YUV420P10LE,
+        AV_PIX_FMT_GRAY8,
+    };
+
+    // Синтетический кадр: градиенты по всем плоскостям, чтобы не упираться
+    // в особые случаи для константных данных
+    AVFrame* make_frame(AVPixelFormat format, int width, int height)
+    {
+        AVFrame* frame = av_frame_alloc();
+        frame->format = format;
+        frame->width = width;
+        frame->height = height;
+        if (av_frame_get_buffer(frame, 0) < 0)
+        {
+            av_frame_free(&frame);
+            return nullptr;
+        }
+
+        for (int plane = 0; plane < AV_NUM_DATA_POINTERS && frame->data[plane]; plane++)
+        {
+            for (int y = 0; y < height; y++)
+            {
+                uint8_t* row = frame->data[plane] + static_cast<size_t>(y) * frame->linesize[plane];
+                for (int x = 0; x < frame->linesize[plane]; x++)
+                {
+                    row[x] = static_cast<uint8_t>((x + y * 3 + plane * 50) & 0xFF);
+                }
+            }
+        }
+
+        // Старшие биты 10-битных форматов должны оставаться нулевыми
+        if (format == AV_PIX_FMT_YUV420P10LE)
+        {
+            for (int plane = 0; plane < 3; plane++)
+            {
+                int plane_height = plane == 0 ? height : (height + 1) / 2;
+                for (int y = 0; y < plane_height; y++)
+                {
+                    uint8_t* row = frame->data[plane] + static_cast<size_t>(y) * frame->linesize[plane];
+                    for (int x = 1; x < frame->linesize[plane]; x += 2)
+                    {
+                        row[x] &= 0x03;
+                    }
+                }
+            }
+        }
+
+        return frame;
+    }
+
+    void register_convert_benchmarks(BenchContext& context)
+    {
+        for (const Resolution& resolution : resolutions)
+        {
+            for (AVPixelFormat format : source_formats)
+            {
+                std::string name = std::string("convert_rgb24/") + av_get_pix_fmt_name(format) + "/" + resolution.name;
+
+                AVFrame* frame = make_frame(format, resolution.width, resolution.height);
+                SwsContext* sws_ctx = sws_getContext(
+                    resolution.width, resolution.height, format,
+                    resolution.width, resolution.height, AV_PIX_FMT_RGB24,
+                    SWS_BILINEAR, nullptr, nullptr, nullptr);
+
+                if (!frame || !sws_ctx)
+                {
+                    std::cerr << "Skipping " << name << ": could not set up conversion" << std::endl;
+                    av_frame_free(&frame);
+                    sws_freeContext(sws_ctx);
+                    continue;
+                }
+
+                int buffer_size = av_image_get_buffer_size(AV_PIX_FMT_RGB24, resolution.width,
+                    resolution.height, 1);
+                uint8_t* buffer = static_cast<uint8_t*>(av_malloc(buffer_size));
+                uint8_t* dst_data[4];
+                int dst_linesize[4];
+                av_image_fill_arrays(dst_data, dst_linesize, buffer, AV_PIX_FMT_RGB24,
+                    resolution.width, resolution.height, 1);
+
+                context.run(name, [&](uint64_t iterations)
+                {
+                    for (uint64_t i = 0; i < iterations; i++)
+                    {
+                        sws_scale(sws_ctx, frame->data, frame->linesize, 0, resolution.height,
+                            dst_data, dst_linesize);
+                        bench_do_not_optimize(dst_data[0][0]);
+                    }
+                }, static_cast<double>(buffer_size));
+
+                av_free(buffer);
+                sws_freeContext(sws_ctx);
+                av_frame_free(&frame);
+            }
+        }
+    }
+
+    BenchGroup convert_group("convert_rgb24", register_convert_benchmarks);
+}
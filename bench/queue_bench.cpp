@@ -0,0 +1,193 @@
+#include "bench.h"
+
+#include <videoPlayer/shared_data.h>
+
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+// Очередь пакетов в том виде, в каком её используют demux_packets и
+// decode_video/decode_audio: общий packet_mutex, одно условие на все
+// очереди, ограничение MAX_PACKET_QUEUE_SIZE. Варианты "threads" —
+// прежняя схема с потоком на стадию и condition_variable, варианты
+// "tasks" — корутины на TaskScheduler с AsyncCondition.
+
+namespace
+{
+    std::vector<std::shared_ptr<AVPacket>> make_packets(size_t count)
+    {
+        std::vector<std::shared_ptr<AVPacket>> packets;
+        for (size_t i = 0; i < count; i++)
+        {
+            packets.emplace_back(av_packet_alloc(), [](AVPacket* p)
+            {
+                av_packet_free(&p);
+            });
+        }
+        return packets;
+    }
+
+    uint64_t share_of(uint64_t iterations, int parts, int index)
+    {
+        return iterations / parts + (index < static_cast<int>(iterations % parts) ? 1 : 0);
+    }
+
+    struct BlockingQueues
+    {
+        SharedData shared;
+        std::condition_variable cv;
+    };
+
+    void push_packet(BlockingQueues& queues, std::queue<std::shared_ptr<AVPacket>>& queue,
+        const std::shared_ptr<AVPacket>& packet)
+    {
+        std::unique_lock<std::mutex> lock(queues.shared.packet_mutex);
+        while (queue.size() >= queues.shared.MAX_PACKET_QUEUE_SIZE)
+        {
+            queues.cv.wait(lock);
+        }
+        queue.push(packet);
+        queues.cv.notify_all();
+    }
+
+    void pop_packet(BlockingQueues& queues, std::queue<std::shared_ptr<AVPacket>>& queue)
+    {
+        std::unique_lock<std::mutex> lock(queues.shared.packet_mutex);
+        queues.cv.wait(lock, [&queue]()
+        {
+            return !queue.empty();
+        });
+        queue.pop();
+        queues.cv.notify_all();
+    }
+
+    // producers потоков кладут в video_packets, consumers потоков забирают
+    void run_single_queue(uint64_t iterations, int producers, int consumers)
+    {
+        BlockingQueues queues;
+        auto packets = make_packets(256);
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++)
+        {
+            uint64_t count = share_of(iterations, producers, p);
+            threads.emplace_back([&queues, &packets, count]()
+            {
+                for (uint64_t i = 0; i < count; i++)
+                {
+                    push_packet(queues, queues.shared.video_packets, packets[i % packets.size()]);
+                }
+            });
+        }
+        for (int c = 0; c < consumers; c++)
+        {
+            uint64_t count = share_of(iterations, consumers, c);
+            threads.emplace_back([&queues, count]()
+            {
+                for (uint64_t i = 0; i < count; i++)
+                {
+                    pop_packet(queues, queues.shared.video_packets);
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    // Топология плеера: один демультиплексор раскладывает пакеты по двум
+    // очередям, видео- и аудиодекодер ждут на общем условии
+    void run_demux_topology(uint64_t iterations)
+    {
+        BlockingQueues queues;
+        auto packets = make_packets(256);
+        uint64_t video_count = (iterations + 1) / 2;
+        uint64_t audio_count = iterations / 2;
+
+        std::thread video([&queues, video_count]()
+        {
+            for (uint64_t i = 0; i < video_count; i++)
+            {
+                pop_packet(queues, queues.shared.video_packets);
+            }
+        });
+        std::thread audio([&queues, audio_count]()
+        {
+            for (uint64_t i = 0; i < audio_count; i++)
+            {
+                pop_packet(queues, queues.shared.audio_packets);
+            }
+        });
+
+        for (uint64_t i = 0; i < iterations; i++)
+        {
+            auto& queue = (i % 2 == 0) ? queues.shared.video_packets : queues.shared.audio_packets;
+            push_packet(queues, queue, packets[i % packets.size()]);
+        }
+
+        video.join();
+        audio.join();
+    }
+
+    PipelineTask produce_task(SharedData& shared, std::queue<std::shared_ptr<AVPacket>>& queue,
+        const std::vector<std::shared_ptr<AVPacket>>& packets, uint64_t count)
+    {
+        for (uint64_t i = 0; i < count; i++)
+        {
+            std::unique_lock<std::mutex> lock(shared.packet_mutex);
+            while (queue.size() >= shared.MAX_PACKET_QUEUE_SIZE)
+            {
+                co_await shared.packet_cv.wait(lock);
+            }
+            queue.push(packets[i % packets.size()]);
+            shared.packet_cv.notify_all();
+        }
+    }
+
+    PipelineTask consume_task(SharedData& shared, std::queue<std::shared_ptr<AVPacket>>& queue,
+        uint64_t count)
+    {
+        for (uint64_t i = 0; i < count; i++)
+        {
+            std::unique_lock<std::mutex> lock(shared.packet_mutex);
+            while (queue.empty())
+            {
+                co_await shared.packet_cv.wait(lock);
+            }
+            queue.pop();
+            shared.packet_cv.notify_all();
+        }
+    }
+
+    // streams независимых пар демультиплексор/декодер на пуле из threads потоков
+    void run_task_streams(uint64_t iterations, int streams, int threads)
+    {
+        TaskScheduler scheduler(threads);
+        TaskGroup group;
+        auto packets = make_packets(256);
+        std::vector<std::unique_ptr<SharedData>> shared;
+
+        for (int s = 0; s < streams; s++)
+        {
+            shared.push_back(std::make_unique<SharedData>());
+            uint64_t count = share_of(iterations, streams, s);
+            scheduler.spawn(produce_task(*shared[s], shared[s]->video_packets, packets, count), group);
+            scheduler.spawn(consume_task(*shared[s], shared[s]->video_packets, count), group);
+        }
+
+        group.wait();
+    }
+
+    void register_queue_benchmarks(BenchContext& context)
+    {
+        context.run("packet_queue/threads_1p1c", [](uint64_t n) { run_single_queue(n, 1, 1); });
+        context.run("packet_queue/threads_demux_video_audio", [](uint64_t n) { run_demux_topology(n); });
+        context.run("packet_queue/threads_4p4c", [](uint64_t n) { run_single_queue(n, 4, 4); });
+        context.run("packet_queue/tasks_1_stream_3_workers", [](uint64_t n) { run_task_streams(n, 1, 3); });
+        context.run("packet_queue/tasks_32_streams_4_workers", [](uint64_t n) { run_task_streams(n, 32, 4); });
+    }
+
+    BenchGroup queue_group("packet_queue", register_queue_benchmarks);
+}
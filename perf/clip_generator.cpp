@@ -0,0 +1,343 @@
+#include "clip_generator.h"
+
+#include <cmath>
+#include <iostream>
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/samplefmt.h>
+#include <libswscale/swscale.h>
+}
+
+namespace
+{
+    struct OutputStream
+    {
+        AVStream* stream = nullptr;
+        AVCodecContext* codec_ctx = nullptr;
+        AVFrame* frame = nullptr;
+        int64_t next_pts = 0;
+        bool finished = false;
+    };
+
+    void close_stream(OutputStream& output)
+    {
+        av_frame_free(&output.frame);
+        avcodec_free_context(&output.codec_ctx);
+    }
+
+    bool write_packets(AVFormatContext* format_ctx, OutputStream& output)
+    {
+        AVPacket* packet = av_packet_alloc();
+        if (!packet)
+            return false;
+
+        bool ok = true;
+        while (true)
+        {
+            int ret = avcodec_receive_packet(output.codec_ctx, packet);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+                break;
+            if (ret < 0)
+            {
+                ok = false;
+                break;
+            }
+
+            av_packet_rescale_ts(packet, output.codec_ctx->time_base, output.stream->time_base);
+            packet->stream_index = output.stream->index;
+            if (av_interleaved_write_frame(format_ctx, packet) < 0)
+            {
+                ok = false;
+                break;
+            }
+        }
+
+        av_packet_free(&packet);
+        return ok;
+    }
+
+    bool encode_frame(AVFormatContext* format_ctx, OutputStream& output, AVFrame* frame)
+    {
+        if (avcodec_send_frame(output.codec_ctx, frame) < 0)
+            return false;
+        return write_packets(format_ctx, output);
+    }
+
+    bool open_video(AVFormatContext* format_ctx, const ClipSpec& spec, OutputStream& output)
+    {
+        const AVCodec* codec = avcodec_find_encoder(spec.video_codec);
+        if (!codec)
+            return false;
+
+        output.stream = avformat_new_stream(format_ctx, nullptr);
+        output.codec_ctx = avcodec_alloc_context3(codec);
+        if (!output.stream || !output.codec_ctx)
+            return false;
+
+        AVCodecContext* ctx = output.codec_ctx;
+        ctx->width = spec.width;
+        ctx->height = spec.height;
+        ctx->time_base = AVRational{1, spec.fps};
+        ctx->framerate = AVRational{spec.fps, 1};
+        ctx->pix_fmt = codec->pix_fmts ? codec->pix_fmts[0] : AV_PIX_FMT_YUV420P;
+        ctx->gop_size = spec.fps;
+        ctx->max_b_frames = 0;
+        ctx->bit_rate = static_cast<int64_t>(spec.width) * spec.height * spec.fps / 8;
+        ctx->thread_count = 1;
+        ctx->flags |= AV_CODEC_FLAG_BITEXACT;
+        if (format_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+        {
+            ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        }
+
+        if (avcodec_open2(ctx, codec, nullptr) < 0 ||
+            avcodec_parameters_from_context(output.stream->codecpar, ctx) < 0)
+            return false;
+
+        output.stream->time_base = ctx->time_base;
+
+        output.frame = av_frame_alloc();
+        output.frame->format = ctx->pix_fmt;
+        output.frame->width = ctx->width;
+        output.frame->height = ctx->height;
+        return av_frame_get_buffer(output.frame, 0) >= 0;
+    }
+
+    bool open_audio(AVFormatContext* format_ctx, const ClipSpec& spec, OutputStream& output)
+    {
+        const AVCodec* codec = avcodec_find_encoder(spec.audio_codec);
+        if (!codec)
+            return false;
+
+        output.stream = avformat_new_stream(format_ctx, nullptr);
+        output.codec_ctx = avcodec_alloc_context3(codec);
+        if (!output.stream || !output.codec_ctx)
+            return false;
+
+        AVCodecContext* ctx = output.codec_ctx;
+        ctx->sample_rate = spec.audio_sample_rate;
+        ctx->sample_fmt = codec->sample_fmts ? codec->sample_fmts[0] : AV_SAMPLE_FMT_S16;
+        av_channel_layout_default(&ctx->ch_layout, spec.audio_channels);
+        ctx->bit_rate = 64000 * spec.audio_channels;
+        ctx->time_base = AVRational{1, spec.audio_sample_rate};
+        ctx->thread_count = 1;
+        ctx->flags |= AV_CODEC_FLAG_BITEXACT;
+        if (format_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+        {
+            ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        }
+
+        if (avcodec_open2(ctx, codec, nullptr) < 0 ||
+            avcodec_parameters_from_context(output.stream->codecpar, ctx) < 0)
+            return false;
+
+        output.stream->time_base = ctx->time_base;
+
+        output.frame = av_frame_alloc();
+        output.frame->format = ctx->sample_fmt;
+        output.frame->sample_rate = ctx->sample_rate;
+        output.frame->nb_samples = ctx->frame_size > 0 ? ctx->frame_size : 1024;
+        av_channel_layout_copy(&output.frame->ch_layout, &ctx->ch_layout);
+        return av_frame_get_buffer(output.frame, 0) >= 0;
+    }
+
+    // Кадр рисуется в YUV420P и при необходимости переводится в формат кодера
+    void fill_video_frame(AVFrame* yuv, int64_t index)
+    {
+        int width = yuv->width;
+        int height = yuv->height;
+
+        int box_size = height / 4;
+        int box_x = static_cast<int>((index * 7) % std::max(1, width - box_size));
+        int box_y = static_cast<int>((index * 3) % std::max(1, height - box_size));
+
+        for (int y = 0; y < height; y++)
+        {
+            uint8_t* row = yuv->data[0] + static_cast<size_t>(y) * yuv->linesize[0];
+            bool box_row = y >= box_y && y < box_y + box_size;
+            for (int x = 0; x < width; x++)
+            {
+                bool in_box = box_row && x >= box_x && x < box_x + box_size;
+                row[x] = in_box ? 235 : static_cast<uint8_t>(16 + ((x + y + index * 2) & 0x7F));
+            }
+        }
+
+        for (int plane = 1; plane < 3; plane++)
+        {
+            for (int y = 0; y < (height + 1) / 2; y++)
+            {
+                uint8_t* row = yuv->data[plane] + static_cast<size_t>(y) * yuv->linesize[plane];
+                for (int x = 0; x < (width + 1) / 2; x++)
+                {
+                    row[x] = static_cast<uint8_t>(128 + (((x * plane + y + index) & 0x3F) - 32));
+                }
+            }
+        }
+    }
+
+    void fill_audio_frame(AVFrame* frame, int64_t first_sample)
+    {
+        AVSampleFormat format = static_cast<AVSampleFormat>(frame->format);
+        int channels = frame->ch_layout.nb_channels;
+        bool planar = av_sample_fmt_is_planar(format);
+
+        for (int i = 0; i < frame->nb_samples; i++)
+        {
+            double t = static_cast<double>(first_sample + i) / frame->sample_rate;
+            for (int c = 0; c < channels; c++)
+            {
+                // У каждого канала своя частота, чтобы микширование было заметно
+                double value = 0.3 * std::sin(2.0 * M_PI * (220.0 + 110.0 * c) * t);
+                int index = planar ? i : i * channels + c;
+                uint8_t* data = frame->data[planar ? c : 0];
+
+                switch (format)
+                {
+                case AV_SAMPLE_FMT_S16:
+                case AV_SAMPLE_FMT_S16P:
+                    reinterpret_cast<int16_t*>(data)[index] = static_cast<int16_t>(value * 32767);
+                    break;
+                case AV_SAMPLE_FMT_S32:
+                case AV_SAMPLE_FMT_S32P:
+                    reinterpret_cast<int32_t*>(data)[index] = static_cast<int32_t>(value * 2147483647.0);
+                    break;
+                case AV_SAMPLE_FMT_FLT:
+                case AV_SAMPLE_FMT_FLTP:
+                    reinterpret_cast<float*>(data)[index] = static_cast<float>(value);
+                    break;
+                case AV_SAMPLE_FMT_DBL:
+                case AV_SAMPLE_FMT_DBLP:
+                    reinterpret_cast<double*>(data)[index] = value;
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+    }
+}
+
+bool clip_encoders_available(const ClipSpec& spec)
+{
+    if (!avcodec_find_encoder(spec.video_codec))
+        return false;
+    if (spec.audio_codec != AV_CODEC_ID_NONE && !avcodec_find_encoder(spec.audio_codec))
+        return false;
+    return true;
+}
+
+bool generate_clip(const ClipSpec& spec, const std::string& path)
+{
+    AVFormatContext* format_ctx = nullptr;
+    if (avformat_alloc_output_context2(&format_ctx, nullptr, "matroska", path.c_str()) < 0)
+    {
+        std::cerr << "Could not create output context for " << path << std::endl;
+        return false;
+    }
+    format_ctx->flags |= AVFMT_FLAG_BITEXACT;
+
+    OutputStream video;
+    OutputStream audio;
+    bool has_audio = spec.audio_codec != AV_CODEC_ID_NONE;
+    bool ok = open_video(format_ctx, spec, video) && (!has_audio || open_audio(format_ctx, spec, audio));
+
+    AVFrame* yuv = nullptr;
+    SwsContext* sws_ctx = nullptr;
+    if (ok && video.codec_ctx->pix_fmt != AV_PIX_FMT_YUV420P)
+    {
+        yuv = av_frame_alloc();
+        yuv->format = AV_PIX_FMT_YUV420P;
+        yuv->width = spec.width;
+        yuv->height = spec.height;
+        sws_ctx = sws_getContext(spec.width, spec.height, AV_PIX_FMT_YUV420P,
+            spec.width, spec.height, video.codec_ctx->pix_fmt, SWS_POINT, nullptr, nullptr, nullptr);
+        ok = sws_ctx && av_frame_get_buffer(yuv, 0) >= 0;
+    }
+
+    if (ok)
+    {
+        ok = avio_open(&format_ctx->pb, path.c_str(), AVIO_FLAG_WRITE) >= 0 &&
+            avformat_write_header(format_ctx, nullptr) >= 0;
+    }
+
+    int64_t total_video_frames = static_cast<int64_t>(spec.seconds * spec.fps);
+    int64_t total_audio_samples = static_cast<int64_t>(spec.seconds * spec.audio_sample_rate);
+    audio.finished = !has_audio;
+
+    // Чередуем потоки по времени, чтобы мультиплексору не приходилось
+    // буферизовать один из них целиком
+    while (ok && (!video.finished || !audio.finished))
+    {
+        bool write_video = !video.finished;
+        if (!video.finished && !audio.finished)
+        {
+            double video_time = static_cast<double>(video.next_pts) / spec.fps;
+            double audio_time = static_cast<double>(audio.next_pts) / spec.audio_sample_rate;
+            write_video = video_time <= audio_time;
+        }
+
+        if (write_video)
+        {
+            if (video.next_pts >= total_video_frames)
+            {
+                ok = encode_frame(format_ctx, video, nullptr);
+                video.finished = true;
+                continue;
+            }
+
+            ok = av_frame_make_writable(video.frame) >= 0;
+            if (yuv)
+            {
+                fill_video_frame(yuv, video.next_pts);
+                sws_scale(sws_ctx, yuv->data, yuv->linesize, 0, spec.height,
+                    video.frame->data, video.frame->linesize);
+            }
+            else
+            {
+                fill_video_frame(video.frame, video.next_pts);
+            }
+            video.frame->pts = video.next_pts++;
+            ok = ok && encode_frame(format_ctx, video, video.frame);
+        }
+        else
+        {
+            if (audio.next_pts >= total_audio_samples)
+            {
+                ok = encode_frame(format_ctx, audio, nullptr);
+                audio.finished = true;
+                continue;
+            }
+
+            ok = av_frame_make_writable(audio.frame) >= 0;
+            fill_audio_frame(audio.frame, audio.next_pts);
+            audio.frame->pts = audio.next_pts;
+            audio.next_pts += audio.frame->nb_samples;
+            ok = ok && encode_frame(format_ctx, audio, audio.frame);
+        }
+    }
+
+    if (ok)
+    {
+        ok = av_write_trailer(format_ctx) >= 0;
+    }
+    else
+    {
+        std::cerr << "Failed to generate clip " << spec.name << std::endl;
+    }
+
+    if (format_ctx->pb)
+    {
+        avio_closep(&format_ctx->pb);
+    }
+
+    sws_freeContext(sws_ctx);
+    av_frame_free(&yuv);
+    close_stream(video);
+    close_stream(audio);
+    avformat_free_context(format_ctx);
+    return ok;
+}
@@ -0,0 +1,33 @@
+#ifndef CLIP_GENERATOR_H
+#define CLIP_GENERATOR_H
+
+#include <string>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+// Параметры синтетического ролика. Содержимое детерминировано: градиент с
+// движущимся прямоугольником и синус на каждом канале, кодеры работают
+// в одном потоке с AV_CODEC_FLAG_BITEXACT.
+struct ClipSpec
+{
+    std::string name;
+    AVCodecID video_codec = AV_CODEC_ID_MPEG4;
+    int width = 640;
+    int height = 480;
+    int fps = 30;
+    AVCodecID audio_codec = AV_CODEC_ID_NONE;
+    int audio_channels = 2;
+    int audio_sample_rate = 48000;
+    double seconds = 5.0;
+};
+
+// Проверяет, что в сборке libavcodec есть нужные кодеры
+bool clip_encoders_available(const ClipSpec& spec);
+
+// Пишет ролик в контейнер Matroska
+bool generate_clip(const ClipSpec& spec, const std::string& path);
+
+#endif
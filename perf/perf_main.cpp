@@ -0,0 +1,441 @@
+#include "clip_generator.h"
+#include "perf_report.h"
+
+#include "videoPlayer/alloc_profile.h"
+#include "videoPlayer/media_player.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    // Стадии с целью «ноль выделений в установившемся режиме» и время
+    // разгона, после которого выделения уже считаются установившимися
+    const AllocStage steady_alloc_stages[] = {
+        AllocStage::Demux, AllocStage::Video, AllocStage::Audio, AllocStage::Callback};
+    constexpr auto ALLOC_WARMUP = std::chrono::seconds(1);
+
+    std::vector<ClipSpec> perf_scenarios()
+    {
+        std::vector<ClipSpec> scenarios;
+
+        auto add = [&scenarios](const char* name, AVCodecID video_codec, int width, int height,
+            int fps, AVCodecID audio_codec, int channels, int sample_rate)
+        {
+            ClipSpec spec;
+            spec.name = name;
+            spec.video_codec = video_codec;
+            spec.width = width;
+            spec.height = height;
+            spec.fps = fps;
+            spec.audio_codec = audio_codec;
+            spec.audio_channels = channels;
+            spec.audio_sample_rate = sample_rate;
+            scenarios.push_back(spec);
+        };
+
+        // Без аудио сценариев нет: часы плеера ведёт аудиопоток
+        add("mpeg4_480p30_aac_stereo", AV_CODEC_ID_MPEG4, 640, 480, 30, AV_CODEC_ID_AAC, 2, 48000);
+        add("mpeg4_720p30_mp2_mono", AV_CODEC_ID_MPEG4, 1280, 720, 30, AV_CODEC_ID_MP2, 1, 44100);
+        add("mpeg2_1080p25_ac3_5.1", AV_CODEC_ID_MPEG2VIDEO, 1920, 1080, 25, AV_CODEC_ID_AC3, 6, 48000);
+        add("mjpeg_480p24_pcm_stereo", AV_CODEC_ID_MJPEG, 640, 480, 24, AV_CODEC_ID_PCM_S16LE, 2, 44100);
+        add("h264_1080p60_aac_stereo", AV_CODEC_ID_H264, 1920, 1080, 60, AV_CODEC_ID_AAC, 2, 48000);
+        add("mpeg4_360p30_flac_mono", AV_CODEC_ID_MPEG4, 480, 360, 30, AV_CODEC_ID_FLAC, 1, 22050);
+
+        return scenarios;
+    }
+
+    // Проигрывание идёт в дочернем процессе: так пиковый RSS и процессорное
+    // время относятся только к одному сценарию, а падение плеера не роняет прогон
+    bool run_scenario(const std::string& clip_path, const PlayerConfig& base, ScenarioResult& result)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+        {
+            std::cerr << "pipe() failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            std::cerr << "fork() failed: " << strerror(errno) << std::endl;
+            close(fds[0]);
+            close(fds[1]);
+            return false;
+        }
+
+        if (pid == 0)
+        {
+            close(fds[0]);
+
+            auto sink = std::make_shared<NullVideoSink>();
+            PlayerConfig config = base;
+            config.video_sink = sink;
+            config.audio_output = AudioOutputType::Null;
+
+            const bool count_allocs = alloc_profile_available();
+            if (count_allocs)
+            {
+                alloc_profile_start();
+            }
+
+            MediaPlayer player;
+            if (!player.initialize(clip_path, config))
+                _exit(2);
+
+            auto start = std::chrono::steady_clock::now();
+            player.start();
+            
+            std::vector<uint64_t> warm_allocs;
+            auto warm_time = start;
+            if (count_allocs)
+            {
+                std::this_thread::sleep_for(ALLOC_WARMUP);
+                warm_time = std::chrono::steady_clock::now();
+                for (AllocStage stage : steady_alloc_stages)
+                {
+                    warm_allocs.push_back(alloc_profile_stats(stage).allocations);
+                }
+            }
+            
+            player.wait();
+            auto end = std::chrono::steady_clock::now();
+            double wall = std::chrono::duration<double>(end - start).count();
+
+            PlaybackStats stats = player.stats();
+            player.cleanup();
+
+            std::ostringstream out;
+            out << wall << ' ' << stats.frames_decoded << ' ' << stats.frames_displayed << ' '
+                << stats.frames_dropped << ' ' << stats.audio_underruns << ' '
+                << stats.max_abs_drift_seconds << ' ' << stats.slow_io.stalls << ' '
+                << stats.slow_io.recoveries << ' ' << stats.slow_io.mean_recovery_seconds << ' '
+                << stats.slow_io.max_recovery_seconds;
+            if (count_allocs)
+            {
+                out << ' ' << std::chrono::duration<double>(end - warm_time).count();
+                for (size_t i = 0; i < warm_allocs.size(); i++)
+                {
+                    out << ' ' << alloc_profile_stats(steady_alloc_stages[i]).allocations - warm_allocs[i];
+                }
+            }
+            std::string text = out.str();
+            ssize_t written = write(fds[1], text.data(), text.size());
+            close(fds[1]);
+            _exit(written == static_cast<ssize_t>(text.size()) ? 0 : 3);
+        }
+
+        close(fds[1]);
+        std::string text;
+        char buffer[256];
+        ssize_t n;
+        while ((n = read(fds[0], buffer, sizeof(buffer))) > 0)
+        {
+            text.append(buffer, n);
+        }
+        close(fds[0]);
+
+        int status = 0;
+        rusage usage{};
+        if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            std::cerr << "Player process for " << clip_path << " failed" << std::endl;
+            return false;
+        }
+
+        double wall = 0.0;
+        double drift = 0.0;
+        uint64_t decoded = 0, displayed = 0, dropped = 0, underruns = 0;
+        uint64_t io_stalls = 0, io_recoveries = 0;
+        double io_recovery_mean = 0.0, io_recovery_max = 0.0;
+        std::istringstream in(text);
+        if (!(in >> wall >> decoded >> displayed >> dropped >> underruns >> drift >>
+            io_stalls >> io_recoveries >> io_recovery_mean >> io_recovery_max))
+            return false;
+
+        double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+            usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#ifdef __APPLE__
+        double peak_rss_kb = usage.ru_maxrss / 1024.0;
+#else
+        double peak_rss_kb = usage.ru_maxrss;
+#endif
+
+        result.metrics["wall_seconds"] = wall;
+        result.metrics["frames_decoded"] = static_cast<double>(decoded);
+        result.metrics["frames_displayed"] = static_cast<double>(displayed);
+        result.metrics["frames_dropped"] = static_cast<double>(dropped);
+        result.metrics["audio_underruns"] = static_cast<double>(underruns);
+        result.metrics["display_fps"] = wall > 0.0 ? displayed / wall : 0.0;
+        result.metrics["max_drift_ms"] = drift * 1000.0;
+        result.metrics["cpu_seconds"] = cpu;
+        result.metrics["cpu_percent"] = wall > 0.0 ? 100.0 * cpu / wall : 0.0;
+        // Добровольные переключения контекста — засыпания с пробуждением
+        result.metrics["wakeups_per_second"] = wall > 0.0 ? usage.ru_nvcsw / wall : 0.0;
+        result.metrics["peak_rss_kb"] = peak_rss_kb;
+        if (base.slow_io.enabled())
+        {
+            result.metrics["io_stalls"] = static_cast<double>(io_stalls);
+            // Остановки, после которых очередь так и не заполнилась до конца
+            result.metrics["io_unrecovered_stalls"] = static_cast<double>(io_stalls - std::min(io_stalls, io_recoveries));
+            result.metrics["io_recovery_mean_ms"] = io_recovery_mean * 1000.0;
+            result.metrics["io_recovery_max_ms"] = io_recovery_max * 1000.0;
+        }
+
+        // Есть только в сборке с ENABLE_ALLOC_PROFILE
+        double steady_seconds = 0.0;
+        if (in >> steady_seconds && steady_seconds > 0.0)
+        {
+            for (AllocStage stage : steady_alloc_stages)
+            {
+                uint64_t allocations = 0;
+                if (!(in >> allocations))
+                    break;
+                result.metrics[std::string("steady_allocs_per_s/") + alloc_stage_name(stage)] =
+                    allocations / steady_seconds;
+            }
+        }
+        return true;
+    }
+
+    void print_usage(const char* program)
+    {
+        std::cout << "Usage: " << program << " [options]" << std::endl
+                  << "  --filter <substr>      run only scenarios whose name contains <substr>" << std::endl
+                  << "  --work-dir <dir>       where generated clips are cached (default perf_clips)" << std::endl
+                  << "  --out <file>           write results as JSON ('-' for stdout)" << std::endl
+                  << "  --baseline <file>      compare against a stored baseline, exit 1 on regression" << std::endl
+                  << "  --threshold <percent>  allowed regression per metric (default 10)" << std::endl
+                  << "  --update-baseline      overwrite --baseline with the results of this run" << std::endl
+                  << "  --power-save           also run every scenario in power-save mode and compare" << std::endl
+                  << "  --slow-io <spec>       also run every scenario reading the clip like a slow disk" << std::endl
+                  << "                         (see the player's --slow-io)" << std::endl
+                  << "  --packet-queue <n>     demuxer packet queue limit for all runs (default 100)" << std::endl
+                  << "  --list                 list scenarios" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string filter;
+    std::string work_dir = "perf_clips";
+    std::string out_path;
+    std::string baseline_path;
+    double threshold = 10.0;
+    bool update_baseline = false;
+    bool list_only = false;
+    bool power_save = false;
+    PlayerConfig base;
+    SlowSourceOptions slow_io;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = i + 1 < argc;
+
+        if (strcmp(argv[i], "--filter") == 0 && has_value)
+        {
+            filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--work-dir") == 0 && has_value)
+        {
+            work_dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--out") == 0 && has_value)
+        {
+            out_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && has_value)
+        {
+            baseline_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threshold") == 0 && has_value)
+        {
+            threshold = std::atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--update-baseline") == 0)
+        {
+            update_baseline = true;
+        }
+        else if (strcmp(argv[i], "--power-save") == 0)
+        {
+            power_save = true;
+        }
+        else if (strcmp(argv[i], "--slow-io") == 0 && has_value)
+        {
+            if (!parse_slow_source_options(argv[++i], slow_io) || !slow_io.enabled())
+            {
+                std::cerr << "Invalid --slow-io spec: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--packet-queue") == 0 && has_value)
+        {
+            base.packet_queue_size = static_cast<size_t>(std::max(std::atoi(argv[++i]), 16));
+        }
+        else if (strcmp(argv[i], "--list") == 0)
+        {
+            list_only = true;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    if (update_baseline && baseline_path.empty())
+    {
+        std::cerr << "--update-baseline requires --baseline <file>" << std::endl;
+        return 1;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(work_dir, ec);
+    if (ec)
+    {
+        std::cerr << "Could not create work directory " << work_dir << ": " << ec.message() << std::endl;
+        return 1;
+    }
+
+    std::vector<ScenarioResult> results;
+    bool failed = false;
+
+    for (const ClipSpec& spec : perf_scenarios())
+    {
+        if (!filter.empty() && spec.name.find(filter) == std::string::npos)
+            continue;
+
+        if (list_only)
+        {
+            std::cout << spec.name << std::endl;
+            continue;
+        }
+
+        if (!clip_encoders_available(spec))
+        {
+            std::cout << spec.name << ": skipped, encoder not available" << std::endl;
+            continue;
+        }
+
+        std::string clip_path = (std::filesystem::path(work_dir) / (spec.name + ".mkv")).string();
+        if (!std::filesystem::exists(clip_path) && !generate_clip(spec, clip_path))
+        {
+            std::filesystem::remove(clip_path, ec);
+            failed = true;
+            continue;
+        }
+
+        ScenarioResult result;
+        result.name = spec.name;
+        if (!run_scenario(clip_path, base, result))
+        {
+            failed = true;
+            continue;
+        }
+
+        std::cout << spec.name << ": " << result.metrics["display_fps"] << " fps, "
+                  << result.metrics["frames_dropped"] << " dropped, "
+                  << result.metrics["max_drift_ms"] << " ms max drift, "
+                  << result.metrics["peak_rss_kb"] << " KiB peak RSS" << std::endl;
+
+        results.push_back(result);
+
+        if (power_save)
+        {
+            ScenarioResult saving;
+            saving.name = spec.name + "/power_save";
+            PlayerConfig config = base;
+            config.power_save = true;
+            if (!run_scenario(clip_path, config, saving))
+            {
+                failed = true;
+            }
+            else
+            {
+                std::cout << saving.name << ": CPU " << result.metrics["cpu_percent"] << "% -> "
+                          << saving.metrics["cpu_percent"] << "%, wakeups/s "
+                          << result.metrics["wakeups_per_second"] << " -> "
+                          << saving.metrics["wakeups_per_second"] << ", "
+                          << saving.metrics["frames_dropped"] << " dropped" << std::endl;
+                results.push_back(std::move(saving));
+            }
+        }
+
+        if (slow_io.enabled())
+        {
+            ScenarioResult slow;
+            slow.name = spec.name + "/slow_io";
+            PlayerConfig config = base;
+            config.slow_io = slow_io;
+            if (!run_scenario(clip_path, config, slow))
+            {
+                failed = true;
+            }
+            else
+            {
+                std::cout << slow.name << ": " << slow.metrics["io_stalls"] << " stalls, recovery mean "
+                          << slow.metrics["io_recovery_mean_ms"] << " ms, max "
+                          << slow.metrics["io_recovery_max_ms"] << " ms, "
+                          << slow.metrics["frames_dropped"] << " dropped, "
+                          << slow.metrics["audio_underruns"] << " underruns" << std::endl;
+                results.push_back(std::move(slow));
+            }
+        }
+    }
+
+    if (list_only)
+        return 0;
+
+    if (!out_path.empty())
+    {
+        if (out_path == "-")
+        {
+            write_report(std::cout, results);
+        }
+        else
+        {
+            std::ofstream out(out_path);
+            write_report(out, results);
+        }
+    }
+
+    if (update_baseline)
+    {
+        std::ofstream out(baseline_path);
+        write_report(out, results);
+        std::cout << "Baseline written to " << baseline_path << std::endl;
+    }
+    else if (!baseline_path.empty())
+    {
+        std::ifstream in(baseline_path);
+        std::vector<ScenarioResult> baseline;
+        if (!in || !read_report(in, baseline))
+        {
+            std::cerr << "Could not read baseline " << baseline_path << std::endl;
+            return 1;
+        }
+
+        std::vector<MetricRegression> regressions = compare_reports(baseline, results, threshold / 100.0);
+        for (const MetricRegression& r : regressions)
+        {
+            std::cerr << "REGRESSION " << r.scenario << " " << r.metric << ": "
+                      << r.baseline << " -> " << r.current << std::endl;
+        }
+        if (!regressions.empty())
+            return 1;
+    }
+
+    return failed ? 1 : 0;
+}
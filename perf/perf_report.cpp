@@ -0,0 +1,199 @@
+#include "perf_report.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <istream>
+#include <iterator>
+#include <ostream>
+
+namespace
+{
+    struct MetricRule
+    {
+        const char* name;
+        bool higher_is_better;
+        // Абсолютный допуск для метрик, которые около нуля шумят сильнее,
+        // чем позволяет относительный порог
+        double slack;
+    };
+
+    const MetricRule metric_rules[] = {
+        {"display_fps", true, 0.0},
+        {"frames_displayed", true, 0.0},
+        {"frames_dropped", false, 2.0},
+        {"audio_underruns", false, 2.0},
+        {"max_drift_ms", false, 5.0},
+        {"cpu_seconds", false, 0.05},
+        {"cpu_percent", false, 1.0},
+        {"wakeups_per_second", false, 20.0},
+        {"peak_rss_kb", false, 0.0},
+        // Только у прогонов с --slow-io
+        {"io_unrecovered_stalls", false, 1.0},
+        {"io_recovery_mean_ms", false, 50.0},
+        {"io_recovery_max_ms", false, 100.0},
+        // Цель — ноль; допуск на редкие выделения вроде роста очереди
+        {"steady_allocs_per_s/demux", false, 1.0},
+        {"steady_allocs_per_s/video", false, 1.0},
+        {"steady_allocs_per_s/audio", false, 1.0},
+        {"steady_allocs_per_s/callback", false, 1.0},
+    };
+
+    const MetricRule* find_rule(const std::string& metric)
+    {
+        for (const MetricRule& rule : metric_rules)
+        {
+            if (metric == rule.name)
+                return &rule;
+        }
+        return nullptr;
+    }
+
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(std::string text)
+            : text_(std::move(text))
+        {
+        }
+
+        bool expect(char c)
+        {
+            skip_spaces();
+            if (pos_ >= text_.size() || text_[pos_] != c)
+                return false;
+            pos_++;
+            return true;
+        }
+
+        bool peek(char c)
+        {
+            skip_spaces();
+            return pos_ < text_.size() && text_[pos_] == c;
+        }
+
+        bool read_string(std::string& out)
+        {
+            if (!expect('"'))
+                return false;
+            out.clear();
+            while (pos_ < text_.size() && text_[pos_] != '"')
+            {
+                if (text_[pos_] == '\\' && pos_ + 1 < text_.size())
+                    pos_++;
+                out += text_[pos_++];
+            }
+            return expect('"');
+        }
+
+        bool read_number(double& out)
+        {
+            skip_spaces();
+            const char* begin = text_.c_str() + pos_;
+            char* end = nullptr;
+            out = std::strtod(begin, &end);
+            if (end == begin)
+                return false;
+            pos_ += end - begin;
+            return true;
+        }
+
+    private:
+        void skip_spaces()
+        {
+            while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_])))
+                pos_++;
+        }
+
+        std::string text_;
+        size_t pos_ = 0;
+    };
+}
+
+void write_report(std::ostream& out, const std::vector<ScenarioResult>& results)
+{
+    out << std::setprecision(6) << "{\n  \"scenarios\": {";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        out << (i ? ",\n" : "\n") << "    \"" << results[i].name << "\": {";
+        bool first = true;
+        for (const auto& [metric, value] : results[i].metrics)
+        {
+            out << (first ? "" : ", ") << "\"" << metric << "\": " << value;
+            first = false;
+        }
+        out << "}";
+    }
+    out << "\n  }\n}\n";
+}
+
+bool read_report(std::istream& in, std::vector<ScenarioResult>& results)
+{
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    JsonReader reader(std::move(text));
+
+    std::string key;
+    if (!reader.expect('{') || !reader.read_string(key) || key != "scenarios" ||
+        !reader.expect(':') || !reader.expect('{'))
+        return false;
+
+    results.clear();
+    while (!reader.peek('}'))
+    {
+        ScenarioResult result;
+        if (!reader.read_string(result.name) || !reader.expect(':') || !reader.expect('{'))
+            return false;
+
+        while (!reader.peek('}'))
+        {
+            double value = 0.0;
+            if (!reader.read_string(key) || !reader.expect(':') || !reader.read_number(value))
+                return false;
+            result.metrics[key] = value;
+            reader.expect(',');
+        }
+        reader.expect('}');
+        results.push_back(std::move(result));
+        reader.expect(',');
+    }
+
+    return reader.expect('}') && reader.expect('}');
+}
+
+std::vector<MetricRegression> compare_reports(const std::vector<ScenarioResult>& baseline,
+    const std::vector<ScenarioResult>& current, double threshold)
+{
+    std::vector<MetricRegression> regressions;
+
+    for (const ScenarioResult& result : current)
+    {
+        const ScenarioResult* base = nullptr;
+        for (const ScenarioResult& candidate : baseline)
+        {
+            if (candidate.name == result.name)
+                base = &candidate;
+        }
+        if (!base)
+            continue;
+
+        for (const auto& [metric, value] : result.metrics)
+        {
+            const MetricRule* rule = find_rule(metric);
+            auto it = base->metrics.find(metric);
+            if (!rule || it == base->metrics.end())
+                continue;
+
+            double reference = it->second;
+            double allowed = std::abs(reference) * threshold + rule->slack;
+            bool regressed = rule->higher_is_better ? value < reference - allowed
+                                                    : value > reference + allowed;
+            if (regressed)
+            {
+                regressions.push_back(MetricRegression{result.name, metric, reference, value});
+            }
+        }
+    }
+
+    return regressions;
+}
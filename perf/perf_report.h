@@ -0,0 +1,35 @@
+#ifndef PERF_REPORT_H
+#define PERF_REPORT_H
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+// Результат прогона одного сценария. Метрики хранятся по имени, чтобы
+// отчёт и базовая линия читались и сравнивались одним кодом.
+struct ScenarioResult
+{
+    std::string name;
+    std::map<std::string, double> metrics;
+};
+
+struct MetricRegression
+{
+    std::string scenario;
+    std::string metric;
+    double baseline = 0.0;
+    double current = 0.0;
+};
+
+void write_report(std::ostream& out, const std::vector<ScenarioResult>& results);
+
+// Читает отчёт, записанный write_report (поддерживается только это подмножество JSON)
+bool read_report(std::istream& in, std::vector<ScenarioResult>& results);
+
+// threshold — допустимое относительное ухудшение (0.1 = 10%).
+// Сценарии и метрики, которых нет в базовой линии, не сравниваются.
+std::vector<MetricRegression> compare_reports(const std::vector<ScenarioResult>& baseline,
+    const std::vector<ScenarioResult>& current, double threshold);
+
+#endif
@@ -1,5 +0,0 @@
-#include <Globals.h>
-#include "OpenGLSomethingFrameDisplayerEVO.h"
-
-std::unique_ptr<OpenGLSomethingFrameDisplayerEVO::OpenGLSomethingFrameDisplayerEVO> GLobal::frameDisplayer;
-bool GLobal::shouldStop;
\ No newline at end of file
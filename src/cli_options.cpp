@@ -0,0 +1,383 @@
+#include "cli_options.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    bool parse_times(const char* text, std::vector<double>& times)
+    {
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ','))
+        {
+            char* end = nullptr;
+            double value = std::strtod(item.c_str(), &end);
+            if (item.empty() || *end != '\0' || value < 0.0)
+                return false;
+            times.push_back(value);
+        }
+        return !times.empty();
+    }
+}
+
+void print_usage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options]" << std::endl
+              << "  --trace <file>         write a Chrome/Perfetto trace-event timeline" << std::endl
+              << "  --metrics-port <port>  serve Prometheus metrics on 127.0.0.1:<port>" << std::endl
+              << "  --stall-ms <ms>        report pipeline threads idle for longer than <ms>" << std::endl
+              << "                         (default 2000 when --metrics-port is set)" << std::endl
+              << "  --pin-threads          reserve a core for the audio callback and the presenter" << std::endl
+              << "  --realtime             request SCHED_FIFO (or lower niceness) for those threads" << std::endl
+              << "  --alloc-profile        count heap allocations per pipeline stage and report them" << std::endl
+              << "                         at exit (needs a build with ENABLE_ALLOC_PROFILE)" << std::endl
+              << "  --shm <name>           publish frames to a POSIX shared-memory ring (e.g. /badplayer)" << std::endl
+              << "  --shm-slots <n>        frames in the shared-memory ring (default 4)" << std::endl
+              << "  --frame-cache-mb <n>   keep up to <n> MiB of shown frames for stepping and replay" << std::endl
+              << "  --reverse              play the file backward (frame cache defaults to 512 MiB)" << std::endl
+              << "  --dirty-tiles <px>     send only tiles changed since the last frame (e.g. 64)" << std::endl
+              << "  --monochrome           show only the luma plane, skipping colour conversion" << std::endl
+              << "  --no-monochrome        never switch black-and-white sources to luma only" << std::endl
+              << "  --bilevel <level>      two-tone mode: luma >= <level> is white, 1 bit per pixel" << std::endl
+              << "  --frame-file-dir <dir> keep decoded frames in <dir> and replay them without decoding" << std::endl
+              << "  --frame-file-mb <n>    disk budget for --frame-file-dir in MiB (default 4096)" << std::endl
+              << "  --frame-file-raw       store frames uncompressed even when LZ4 is available" << std::endl
+              << "  --loop                 play the file in a loop without restarting the pipeline" << std::endl
+              << "  --loop-cache-mb <n>    keep packets of files up to <n> MiB in memory (default 64," << std::endl
+              << "                         0 always seeks back to the start)" << std::endl
+              << "  --power-save           batch decoding and audio refills, coalesce timer wakeups" << std::endl
+              << "  --speed <x>            playback speed 0.5-2.0, audio keeps its pitch (default 1)" << std::endl
+              << "  --playlist <file>      play every path listed in <file> back to back" << std::endl
+              << "  --wall <file>          play every path listed in <file> at once as tiles of one" << std::endl
+              << "                         composed frame on a common clock" << std::endl
+              << "  --wall-columns <n>     tiles per row (default: square grid)" << std::endl
+              << "  --wall-size <WxH>      composed frame size (default 1920x1080)" << std::endl
+              << "  --wall-fps <n>         composed frames per second (default 30)" << std::endl
+              << "  --input <path|url>     play <path|url> instead of asking on stdin (- reads stdin)" << std::endl
+              << "  --stream               treat the input as a stream even if it looks like a file" << std::endl
+              << "  --jitter-low <s>       pause to rebuffer below <s> seconds queued (default 0.25)" << std::endl
+              << "  --jitter-high <s>      resume once <s> seconds are queued (default 1)" << std::endl
+              << "  --jitter-max <s>       upper bound for the adaptive resume level (default 8)" << std::endl
+              << "  --packet-queue <n>     demuxer packet queue limit for local files (default 100)" << std::endl
+              << "  --slow-io <spec>       read local files like a slow disk or NFS mount, e.g." << std::endl
+              << "                         latency=5,jitter=2,bandwidth=4096,stall=200,stall-every=5" << std::endl
+              << "                         (ms, ms, KiB/s, ms, s; also stall-rate=<p>, read-size, seed)" << std::endl
+              << "  --thumbnails <file>    extract thumbnails from <file> and exit" << std::endl
+              << "  --at <t1,t2,...>       thumbnail timestamps in seconds" << std::endl
+              << "  --every <seconds>      one thumbnail per interval over the whole file" << std::endl
+              << "  --thumb-width <px>     thumbnail width (default 320, 0 keeps aspect)" << std::endl
+              << "  --thumb-height <px>    thumbnail height (default 0 keeps aspect)" << std::endl
+              << "  --out-dir <dir>        directory for thumbnails (default .)" << std::endl
+              << "  --format <png|ppm>     thumbnail file format (default png)" << std::endl
+              << "  --jobs <n>             worker threads for thumbnails, export and scan (default: all CPUs)" << std::endl
+              << "  --export <file>        decode every frame of <file> in parallel GOP ranges and exit;" << std::endl
+              << "                         frames go to --out-dir as --format images, or into the" << std::endl
+              << "                         frame file when --frame-file-dir is set" << std::endl
+              << "  --export-width <px>    exported frame width (default 0 keeps the source size)" << std::endl
+              << "  --export-height <px>   exported frame height (default 0 keeps the source size)" << std::endl
+              << "  --scan <dir>           probe every media file under <dir> in parallel (--jobs)," << std::endl
+              << "                         update the metadata index and exit" << std::endl
+              << "  --scan-index <file>    metadata index for --scan (default media_index.tsv);" << std::endl
+              << "                         files with unchanged size and mtime are not probed again" << std::endl
+              << "  --help                 show this help" << std::endl;
+}
+
+bool parse_cli_options(int argc, char* argv[], CliOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (std::strcmp(arg, "--trace") == 0 && has_value)
+        {
+            options.trace_path = argv[++i];
+        }
+        else if (std::strcmp(arg, "--metrics-port") == 0 && has_value)
+        {
+            options.metrics_port = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--stall-ms") == 0 && has_value)
+        {
+            options.stall_timeout_ms = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--pin-threads") == 0)
+        {
+            options.pin_threads = true;
+        }
+        else if (std::strcmp(arg, "--realtime") == 0)
+        {
+            options.realtime = true;
+        }
+        else if (std::strcmp(arg, "--alloc-profile") == 0)
+        {
+            options.alloc_profile = true;
+        }
+        else if (std::strcmp(arg, "--shm") == 0 && has_value)
+        {
+            options.shm_name = argv[++i];
+        }
+        else if (std::strcmp(arg, "--shm-slots") == 0 && has_value)
+        {
+            options.shm_slots = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--frame-cache-mb") == 0 && has_value)
+        {
+            options.frame_cache_mb = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--reverse") == 0)
+        {
+            options.reverse = true;
+        }
+        else if (std::strcmp(arg, "--dirty-tiles") == 0 && has_value)
+        {
+            options.dirty_tile_size = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--monochrome") == 0)
+        {
+            options.monochrome = 1;
+        }
+        else if (std::strcmp(arg, "--no-monochrome") == 0)
+        {
+            options.monochrome = 0;
+        }
+        else if (std::strcmp(arg, "--bilevel") == 0 && has_value)
+        {
+            options.bilevel_threshold = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--frame-file-dir") == 0 && has_value)
+        {
+            options.frame_file_dir = argv[++i];
+        }
+        else if (std::strcmp(arg, "--frame-file-mb") == 0 && has_value)
+        {
+            options.frame_file_mb = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--frame-file-raw") == 0)
+        {
+            options.frame_file_raw = true;
+        }
+        else if (std::strcmp(arg, "--loop") == 0)
+        {
+            options.loop = true;
+        }
+        else if (std::strcmp(arg, "--loop-cache-mb") == 0 && has_value)
+        {
+            options.loop_cache_mb = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--power-save") == 0)
+        {
+            options.power_save = true;
+        }
+        else if (std::strcmp(arg, "--speed") == 0 && has_value)
+        {
+            options.speed = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--playlist") == 0 && has_value)
+        {
+            options.playlist_path = argv[++i];
+        }
+        else if (std::strcmp(arg, "--wall") == 0 && has_value)
+        {
+            options.wall_path = argv[++i];
+        }
+        else if (std::strcmp(arg, "--wall-columns") == 0 && has_value)
+        {
+            options.wall_columns = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--wall-size") == 0 && has_value)
+        {
+            if (std::sscanf(argv[++i], "%dx%d", &options.wall_width, &options.wall_height) != 2 ||
+                options.wall_width <= 0 || options.wall_height <= 0)
+            {
+                std::cerr << "Invalid wall size: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--wall-fps") == 0 && has_value)
+        {
+            options.wall_fps = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--input") == 0 && has_value)
+        {
+            options.input_path = argv[++i];
+        }
+        else if (std::strcmp(arg, "--stream") == 0)
+        {
+            options.stream = true;
+        }
+        else if (std::strcmp(arg, "--jitter-low") == 0 && has_value)
+        {
+            options.jitter_low = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--jitter-high") == 0 && has_value)
+        {
+            options.jitter_high = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--jitter-max") == 0 && has_value)
+        {
+            options.jitter_max = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--packet-queue") == 0 && has_value)
+        {
+            options.packet_queue = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--slow-io") == 0 && has_value)
+        {
+            if (!parse_slow_source_options(argv[++i], options.slow_io))
+            {
+                std::cerr << "Invalid --slow-io spec: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--thumbnails") == 0 && has_value)
+        {
+            options.thumbnail_input = argv[++i];
+        }
+        else if (std::strcmp(arg, "--at") == 0 && has_value)
+        {
+            if (!parse_times(argv[++i], options.thumbnail_times))
+            {
+                std::cerr << "Invalid timestamp list: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--every") == 0 && has_value)
+        {
+            options.thumbnail_interval = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--thumb-width") == 0 && has_value)
+        {
+            options.thumbnail_width = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--thumb-height") == 0 && has_value)
+        {
+            options.thumbnail_height = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--out-dir") == 0 && has_value)
+        {
+            options.thumbnail_dir = argv[++i];
+        }
+        else if (std::strcmp(arg, "--format") == 0 && has_value)
+        {
+            options.thumbnail_format = argv[++i];
+        }
+        else if (std::strcmp(arg, "--jobs") == 0 && has_value)
+        {
+            options.thumbnail_jobs = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--export") == 0 && has_value)
+        {
+            options.export_input = argv[++i];
+        }
+        else if (std::strcmp(arg, "--export-width") == 0 && has_value)
+        {
+            options.export_width = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--export-height") == 0 && has_value)
+        {
+            options.export_height = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--scan") == 0 && has_value)
+        {
+            options.scan_dir = argv[++i];
+        }
+        else if (std::strcmp(arg, "--scan-index") == 0 && has_value)
+        {
+            options.scan_index = argv[++i];
+        }
+        else if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0)
+        {
+            print_usage(argv[0]);
+            return false;
+        }
+        else
+        {
+            std::cerr << "Unknown or incomplete option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+
+    if (!options.thumbnail_input.empty())
+    {
+        if (options.thumbnail_times.empty() && options.thumbnail_interval <= 0.0)
+        {
+            std::cerr << "--thumbnails needs --at or --every" << std::endl;
+            return false;
+        }
+        if (options.thumbnail_format != "png" && options.thumbnail_format != "ppm")
+        {
+            std::cerr << "Unknown thumbnail format: " << options.thumbnail_format << std::endl;
+            return false;
+        }
+    }
+
+    if (!options.export_input.empty() && options.thumbnail_format != "png" && options.thumbnail_format != "ppm")
+    {
+        std::cerr << "Unknown export format: " << options.thumbnail_format << std::endl;
+        return false;
+    }
+
+    if (options.jitter_low < 0.0 || options.jitter_high <= options.jitter_low)
+    {
+        std::cerr << "--jitter-high must be greater than --jitter-low" << std::endl;
+        return false;
+    }
+
+    if (options.bilevel_threshold < 0 || options.bilevel_threshold > 255)
+    {
+        std::cerr << "--bilevel takes a luma level from 1 to 255" << std::endl;
+        return false;
+    }
+
+    if (!options.frame_file_dir.empty() && options.frame_file_mb <= 0)
+    {
+        std::cerr << "--frame-file-mb must be positive" << std::endl;
+        return false;
+    }
+
+    if (!options.wall_path.empty() && (options.wall_fps <= 0.0 || options.wall_columns < 0))
+    {
+        std::cerr << "--wall-fps must be positive and --wall-columns not negative" << std::endl;
+        return false;
+    }
+
+    if (options.speed < 0.5 || options.speed > 2.0)
+    {
+        std::cerr << "--speed takes a value from 0.5 to 2.0" << std::endl;
+        return false;
+    }
+
+    if (options.packet_queue < 16)
+    {
+        std::cerr << "--packet-queue must be at least 16" << std::endl;
+        return false;
+    }
+
+    if (options.loop_cache_mb < 0)
+    {
+        std::cerr << "--loop-cache-mb must not be negative" << std::endl;
+        return false;
+    }
+
+    if (!options.shm_name.empty() && options.shm_name[0] != '/')
+    {
+        options.shm_name.insert(0, "/");
+    }
+
+    if (options.reverse && options.frame_cache_mb <= 0)
+    {
+        options.frame_cache_mb = 512;
+    }
+
+    if (options.metrics_port > 0 && options.stall_timeout_ms == 0)
+    {
+        options.stall_timeout_ms = 2000;
+    }
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <videoPlayer/slow_source.h>
+
+struct CliOptions
+{
+    std::string trace_path;
+    int metrics_port = 0;
+    int stall_timeout_ms = 0;
+    bool pin_threads = false;
+    bool realtime = false;
+    // Счётчики выделений памяти по стадиям (сборка с ENABLE_ALLOC_PROFILE)
+    bool alloc_profile = false;
+    // Имя кольца кадров в разделяемой памяти, пусто — не публиковать
+    std::string shm_name;
+    int shm_slots = 4;
+    // Бюджет кэша кадров в МиБ (0 — без кэша) и обратное воспроизведение
+    int frame_cache_mb = 0;
+    bool reverse = false;
+    // Плитка для передачи только изменившихся областей кадра (0 — выключено)
+    int dirty_tile_size = 0;
+    // Только яркость: 1 — всегда, 0 — никогда, -1 — по содержимому
+    int monochrome = -1;
+    // Порог яркости двухцветного режима (0 — выключено)
+    int bilevel_threshold = 0;
+    // Каталог файлов декодированных кадров (пусто — выключено), его
+    // бюджет в МиБ и запись без LZ4
+    std::string frame_file_dir;
+    int frame_file_mb = 4096;
+    bool frame_file_raw = false;
+    // Повтор по кругу и лимит кэша пакетов в МиБ (0 — всегда перемотка)
+    bool loop = false;
+    int loop_cache_mb = 64;
+    // Режим экономии энергии
+    bool power_save = false;
+    // Темп воспроизведения 0.5..2.0
+    double speed = 1.0;
+    // Файл со списком путей для воспроизведения подряд без пауз
+    std::string playlist_path;
+    // Видеостена: файлы из списка (как у плейлиста) плитками одного
+    // кадра; сетка (0 — квадратная), размер кадра и частота
+    std::string wall_path;
+    int wall_columns = 0;
+    int wall_width = 1920;
+    int wall_height = 1080;
+    double wall_fps = 30.0;
+    // Путь или адрес вместо вопроса в консоли ("-" — stdin)
+    std::string input_path;
+    // Потоковый режим принудительно (иначе по адресу) и пороги буфера, с
+    bool stream = false;
+    double jitter_low = 0.25;
+    double jitter_high = 1.0;
+    double jitter_max = 8.0;
+    // Лимит очередей пакетов и имитация медленного диска для обычных файлов
+    int packet_queue = 100;
+    SlowSourceOptions slow_io;
+
+    // Пакетное извлечение превью вместо воспроизведения
+    std::string thumbnail_input;
+    std::vector<double> thumbnail_times;
+    double thumbnail_interval = 0.0;
+    int thumbnail_width = 320;
+    int thumbnail_height = 0;
+    std::string thumbnail_dir = ".";
+    std::string thumbnail_format = "png";
+    int thumbnail_jobs = 0;
+
+    // Офлайн-декодирование всего файла по GOP на нескольких ядрах: кадры
+    // в thumbnail_dir или файл кадров в frame_file_dir. Размер 0 — исходный
+    std::string export_input;
+    int export_width = 0;
+    int export_height = 0;
+
+    // Обход каталога с разбором файлов в индекс метаданных (пусто —
+    // выключено); потоков — thumbnail_jobs
+    std::string scan_dir;
+    std::string scan_index = "media_index.tsv";
+};
+
+bool parse_cli_options(int argc, char* argv[], CliOptions& options);
+void print_usage(const char* program);
@@ -1,10 +1,26 @@
+#include <atomic>
 #include <chrono>
+#include <cstdio>
 #include <memory>
 #include <thread>
 #include <videoPlayer/media_player.h>
+#include <videoPlayer/parallel_decoder.h>
 #include <iostream>
 #include <filesystem>
-#include "Globals.h"
+#include "OpenGLSomethingFrameDisplayerEVO.h"
+#include "cli_options.h"
+#include <videoPlayer/alloc_profile.h>
+#include <videoPlayer/displayer_sink.h>
+#include <videoPlayer/frame_navigator.h>
+#include <videoPlayer/gl_preview_sink.h>
+#include <videoPlayer/media_library.h>
+#include <videoPlayer/playlist_player.h>
+#include <videoPlayer/shm_frame_sink.h>
+#include <videoPlayer/stage_stats.h>
+#include <videoPlayer/thread_budget.h>
+#include <videoPlayer/thumbnail_extractor.h>
+#include <videoPlayer/trace.h>
+#include <videoPlayer/video_wall.h>
 
 namespace fs = std::filesystem;
 
@@ -55,42 +71,410 @@ fs::path getExecutableDir()
     return fs::current_path();
 }
 
-void VideoPlayerFunc()
+void PrintFrameCacheStats(const FrameCache& cache)
+{
+    FrameCacheStats stats = cache.stats();
+    std::cout << "Frame cache: " << stats.hits << " hits, " << stats.misses << " misses ("
+              << stats.hit_rate() * 100.0 << "% hit rate), " << stats.entries << " frames, "
+              << stats.bytes / (1024 * 1024) << "/" << stats.budget_bytes / (1024 * 1024) << " MiB, "
+              << stats.evictions << " evictions" << std::endl;
+}
+
+// Относительные пути плейлиста — от каталога самого плейлиста, как в M3U.
+// Адреса потоков (http://, pipe:, "-") остаются как есть
+std::vector<std::string> ResolvePlaylist(const std::string& playlist_path)
+{
+    std::vector<std::string> items = read_playlist(playlist_path);
+    fs::path base = fs::absolute(playlist_path).parent_path();
+    for (std::string& item : items)
+    {
+        if (item != "-" && item.find(':') == std::string::npos && fs::path(item).is_relative())
+        {
+            item = (base / item).lexically_normal().string();
+        }
+    }
+    return items;
+}
+
+void VideoPlayerFunc(const CliOptions& options, std::string video_path,
+    const std::vector<std::string>& playlist_items, MediaPlayer& player, PlaylistPlayer& playlist, VideoWall& wall,
+    OpenGLSomethingFrameDisplayerEVO::OpenGLSomethingFrameDisplayerEVO& displayer,
+    const std::atomic<bool>& playing)
 {
     fs::path exeDir = getExecutableDir();
     fs::current_path(exeDir);
     
     std::cout << "Working from: " << fs::current_path() << std::endl;
     
-    std::string video_path;
-    std::cout << "Enter video file path: " << std::endl;
-    std::getline(std::cin, video_path);
+    if (options.playlist_path.empty() && options.wall_path.empty() && video_path.empty())
+    {
+        std::cout << "Enter video file path: " << std::endl;
+        std::getline(std::cin, video_path);
+    }
     
-    MediaPlayer player;
-    if (!player.initialize(video_path))
+    PlayerConfig config;
+    config.metrics_port = options.metrics_port;
+    config.stall_timeout_ms = options.stall_timeout_ms;
+    config.decode_threads = thread_budget().decode_threads;
+    config.damage_tile_size = options.dirty_tile_size;
+    config.bilevel_threshold = options.bilevel_threshold;
+    config.monochrome = options.monochrome < 0 ? MonochromeMode::Auto :
+        options.monochrome > 0 ? MonochromeMode::On : MonochromeMode::Off;
+    config.power_save = options.power_save;
+    config.speed = options.speed;
+    config.loop = options.loop && options.playlist_path.empty();
+    config.loop_cache_bytes = static_cast<size_t>(options.loop_cache_mb) * 1024 * 1024;
+    config.streaming = options.stream ? StreamingMode::On : StreamingMode::Auto;
+    config.stream_options.low_watermark_seconds = options.jitter_low;
+    config.stream_options.high_watermark_seconds = options.jitter_high;
+    config.stream_options.max_watermark_seconds = options.jitter_max;
+    config.packet_queue_size = static_cast<size_t>(options.packet_queue);
+    config.slow_io = options.slow_io;
+    std::vector<std::shared_ptr<VideoSink>> sinks{
+        std::make_shared<DisplayerSink>(displayer), std::make_shared<GlPreviewSink>()};
+    if (!options.shm_name.empty())
+    {
+        sinks.push_back(std::make_shared<SharedMemorySink>(options.shm_name, options.shm_slots));
+    }
+    config.video_sink = std::make_shared<TeeVideoSink>(std::move(sinks));
+    if (options.frame_cache_mb > 0)
+    {
+        config.frame_cache = std::make_shared<FrameCache>(static_cast<size_t>(options.frame_cache_mb) * 1024 * 1024);
+    }
+    if (!options.frame_file_dir.empty())
+    {
+        config.frame_files = std::make_shared<FrameFileStore>(options.frame_file_dir,
+            static_cast<uint64_t>(options.frame_file_mb) * 1024 * 1024, !options.frame_file_raw);
+    }
+    
+    if (!options.wall_path.empty())
+    {
+        VideoWallOptions wall_options;
+        wall_options.columns = options.wall_columns;
+        wall_options.width = options.wall_width;
+        wall_options.height = options.wall_height;
+        wall_options.fps = options.wall_fps;
+        wall.play(playlist_items, wall_options, config, config.video_sink);
+        for (const WallTileReport& tile : wall.report())
+        {
+            std::cout << "Tile " << tile.path << ": ";
+            if (tile.failed)
+            {
+                std::cout << "not opened" << std::endl;
+                continue;
+            }
+            std::cout << tile.frames << " frames, " << tile.late_frames << " late, "
+                      << tile.frames_dropped << " dropped, lateness mean "
+                      << tile.mean_late_seconds * 1000.0 << " ms, max "
+                      << tile.max_late_seconds * 1000.0 << " ms" << std::endl;
+        }
+        return;
+    }
+    
+    if (!options.playlist_path.empty())
+    {
+        size_t played = playlist.play(playlist_items, config);
+        std::cout << "Playlist finished, items played: " << played << "/" << playlist_items.size() << std::endl;
+        return;
+    }
+    
+    if (options.reverse)
+    {
+        FrameNavigator navigator(config.frame_cache);
+        if (navigator.open(video_path))
+        {
+            uint64_t shown = play_reverse(navigator, *config.video_sink, playing);
+            std::cout << "Reverse playback finished, frames shown: " << shown << std::endl;
+        }
+        PrintFrameCacheStats(*config.frame_cache);
+        return;
+    }
+    
+    if (!player.initialize(video_path, config))
     {
         return;
     }
     player.run();
     player.cleanup();
+    
+    if (config.frame_cache)
+    {
+        PrintFrameCacheStats(*config.frame_cache);
+    }
+}
+
+int ScanFunc(const CliOptions& options)
+{
+    MediaLibrary library(options.scan_index);
+    // Файл другого формата не перезаписываем
+    if (!library.load())
+    {
+        std::cerr << "Not scanning: " << options.scan_index << " is not a media index" << std::endl;
+        return 1;
+    }
+
+    LibraryScanOptions scan_options;
+    scan_options.workers = options.thumbnail_jobs;
+    LibraryScanStats stats = library.scan(options.scan_dir, scan_options);
+    bool saved = library.save();
+
+    std::cout << "Scanned " << stats.files << " files in " << stats.seconds << " s ("
+              << stats.files_per_second() << " files/s) on " << stats.workers << " workers: "
+              << stats.probed << " probed (" << stats.full_probes << " needed a full probe, "
+              << stats.failed << " not media), " << stats.unchanged << " unchanged, "
+              << stats.removed << " removed from " << options.scan_index << std::endl;
+    return saved ? 0 : 1;
 }
 
-int main()
+int ThumbnailFunc(const CliOptions& options)
 {
+    std::vector<double> times = options.thumbnail_times;
+    if (times.empty())
+    {
+        double duration = probe_duration(options.thumbnail_input);
+        if (duration <= 0.0)
+        {
+            std::cerr << "Unknown duration, use --at instead of --every" << std::endl;
+            return 1;
+        }
+        times = thumbnail_times_every(duration, options.thumbnail_interval);
+    }
+
+    std::error_code error;
+    fs::create_directories(options.thumbnail_dir, error);
+    if (error)
+    {
+        std::cerr << "Could not create " << options.thumbnail_dir << ": " << error.message() << std::endl;
+        return 1;
+    }
+
+    ThumbnailOptions thumbnail_options;
+    thumbnail_options.width = options.thumbnail_width;
+    thumbnail_options.height = options.thumbnail_height;
+    thumbnail_options.workers = options.thumbnail_jobs;
+
+    bool png = options.thumbnail_format == "png";
+    ThumbnailFormat format = png ? ThumbnailFormat::Png : ThumbnailFormat::Ppm;
+    std::atomic<int> failed{0};
+
+    auto start = std::chrono::steady_clock::now();
+    int extracted = extract_thumbnails(options.thumbnail_input, times, thumbnail_options,
+        [&](const Thumbnail& thumbnail)
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "thumb_%05zu.%s", thumbnail.index, png ? "png" : "ppm");
+            if (!write_thumbnail(thumbnail, (fs::path(options.thumbnail_dir) / name).string(), format))
+            {
+                failed++;
+            }
+        });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (extracted < 0)
+    {
+        return 1;
+    }
+    std::cout << "Extracted " << extracted << "/" << times.size() << " thumbnails in "
+              << seconds << " s (" << (seconds > 0.0 ? extracted / seconds : 0.0)
+              << " thumbnails/s)" << std::endl;
+    return extracted == static_cast<int>(times.size()) && failed == 0 ? 0 : 1;
+}
+
+int ExportFunc(const CliOptions& options)
+{
+    ParallelDecodeOptions decode_options;
+    decode_options.workers = options.thumbnail_jobs;
+    decode_options.width = options.export_width;
+    decode_options.height = options.export_height;
+
+    // С --frame-file-dir кадры копятся в файл для повтора без декодера,
+    // иначе пишутся картинками
+    std::shared_ptr<FrameFileWriter> writer;
+    std::unique_ptr<FrameFileStore> store;
+    if (options.frame_file_dir.empty())
+    {
+        std::error_code error;
+        fs::create_directories(options.thumbnail_dir, error);
+        if (error)
+        {
+            std::cerr << "Could not create " << options.thumbnail_dir << ": " << error.message() << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        store = std::make_unique<FrameFileStore>(fs::absolute(options.frame_file_dir).string(),
+            static_cast<uint64_t>(options.frame_file_mb) * 1024 * 1024, !options.frame_file_raw);
+    }
+
+    bool png = options.thumbnail_format == "png";
+    ThumbnailFormat format = png ? ThumbnailFormat::Png : ThumbnailFormat::Ppm;
+    std::string input = fs::absolute(options.export_input).string();
+    int failed = 0;
+
+    ParallelDecodeStats stats;
+    bool decoded = decode_parallel(input, decode_options,
+        [&](DecodedFrame& frame)
+        {
+            if (store)
+            {
+                if (!writer && frame.index == 0)
+                {
+                    writer = store->create_writer(input, frame.width, frame.height);
+                    if (!writer)
+                    {
+                        std::cerr << "Could not create a frame file for " << input
+                                  << " in " << options.frame_file_dir << std::endl;
+                        failed++;
+                    }
+                }
+                if (writer && !writer->append(frame.rgb.data(), frame.seconds))
+                {
+                    writer.reset();
+                    failed++;
+                }
+                return;
+            }
+
+            Thumbnail image;
+            image.index = frame.index;
+            image.frame_seconds = frame.seconds;
+            image.width = frame.width;
+            image.height = frame.height;
+            image.rgb = std::move(frame.rgb);
+
+            char name[32];
+            std::snprintf(name, sizeof(name), "frame_%06llu.%s",
+                static_cast<unsigned long long>(frame.index), png ? "png" : "ppm");
+            if (!write_thumbnail(image, (fs::path(options.thumbnail_dir) / name).string(), format))
+            {
+                failed++;
+            }
+        }, &stats);
+
+    if (writer)
+    {
+        if (decoded && writer->finish())
+        {
+            store->enforce_budget();
+        }
+        else
+        {
+            writer->abort();
+            failed++;
+        }
+    }
+    else if (store && failed == 0)
+    {
+        std::cerr << "No frame file written for " << input << std::endl;
+        failed++;
+    }
+
+    std::cout << "Decoded " << stats.frames << " frames in " << stats.ranges << " GOP ranges on "
+              << stats.workers << " workers: " << stats.total_seconds << " s (scan "
+              << stats.scan_seconds << " s, " << (stats.total_seconds > 0.0 ? stats.frames / stats.total_seconds : 0.0)
+              << " fps)" << std::endl;
+    return decoded && failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    CliOptions options;
+    if (!parse_cli_options(argc, argv, options))
+    {
+        return 1;
+    }
+
+    // Пути в этом режиме относительно текущего каталога, поэтому до chdir
+    if (!options.thumbnail_input.empty())
+    {
+        return ThumbnailFunc(options);
+    }
+    if (!options.export_input.empty())
+    {
+        return ExportFunc(options);
+    }
+    if (!options.scan_dir.empty())
+    {
+        return ScanFunc(options);
+    }
+
+    if (options.alloc_profile)
+    {
+        if (alloc_profile_available())
+        {
+            alloc_profile_start();
+        }
+        else
+        {
+            std::cerr << "Allocation profiling needs a build with -DENABLE_ALLOC_PROFILE=ON" << std::endl;
+        }
+    }
+
+    if (!options.trace_path.empty() && !trace_start(options.trace_path))
+    {
+        return 1;
+    }
+    trace_set_thread_name("displayer");
+
+    ThreadBudgetOptions budget_options;
+    budget_options.pin_threads = options.pin_threads;
+    budget_options.realtime = options.realtime;
+    CpuTopology topology = detect_cpu_topology();
+    set_thread_budget(plan_thread_budget(topology, budget_options));
+    std::cout << describe_thread_budget(topology, thread_budget()) << std::endl;
+
+    // Потоки конвейера и libavcodec наследуют маску рабочих CPU
+    apply_thread_role(ThreadRole::Worker);
+
+    // Пути из командной строки относительно каталога запуска, поэтому до chdir
+    std::string video_path = options.input_path;
+    if (!video_path.empty() && video_path != "-" && fs::exists(video_path))
+    {
+        video_path = fs::absolute(video_path).string();
+    }
+    if (!options.frame_file_dir.empty())
+    {
+        options.frame_file_dir = fs::absolute(options.frame_file_dir).string();
+    }
+    // Список стены читается так же, как плейлист
+    std::vector<std::string> playlist_items;
+    if (!options.playlist_path.empty() || !options.wall_path.empty())
+    {
+        playlist_items = ResolvePlaylist(options.wall_path.empty() ? options.playlist_path : options.wall_path);
+    }
+    
     fs::path exeDir = getExecutableDir();
     fs::current_path(exeDir);
     
     std::cout << "Main working from: " << fs::current_path() << std::endl;
     
-    GLobal::shouldStop = false;
-    std::thread th([] {VideoPlayerFunc();});
-
-    GLobal::frameDisplayer = std::make_unique<OpenGLSomethingFrameDisplayerEVO::OpenGLSomethingFrameDisplayerEVO>();
-    GLobal::frameDisplayer->SetThreadCount(std::thread::hardware_concurrency() - 4);
-    GLobal::frameDisplayer->WaitForSetVideoSize();
-    GLobal::frameDisplayer->InitialiseGame(1300, 900);
-    GLobal::frameDisplayer->Start();
-    GLobal::shouldStop = true;
+    auto frameDisplayer = std::make_unique<OpenGLSomethingFrameDisplayerEVO::OpenGLSomethingFrameDisplayerEVO>();
+    MediaPlayer player;
+    std::atomic<bool> playing{true};
+    PlaylistPlayer playlist;
+    VideoWall wall;
+    std::thread th([&options, video_path, playlist_items, &player, &playlist, &wall, &frameDisplayer, &playing]
+        {VideoPlayerFunc(options, video_path, playlist_items, player, playlist, wall, *frameDisplayer, playing);});
+
+    frameDisplayer->SetThreadCount(thread_budget().displayer_threads);
+    frameDisplayer->WaitForSetVideoSize();
+    frameDisplayer->InitialiseGame(1300, 900);
+    // После InitialiseGame, чтобы потоки, созданные при инициализации
+    // frameDisplayer, не унаследовали маску и приоритет презентера
+    apply_thread_role(ThreadRole::Presenter);
+    frameDisplayer->Start();
+    // Окно закрыто — останавливаем воспроизведение
+    playing = false;
+    player.stop();
+    playlist.stop();
+    wall.stop();
     th.join();
+    trace_stop();
+    dump_stage_stats(std::cout);
+    if (options.alloc_profile && alloc_profile_available())
+    {
+        dump_alloc_profile(std::cout);
+    }
     return 0;
 }
\ No newline at end of file
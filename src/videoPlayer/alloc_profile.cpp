@@ -0,0 +1,356 @@
+#include "alloc_profile.h"
+
+#include <array>
+#include <atomic>
+#include <iomanip>
+
+#if defined(BADPLAYER_ALLOC_PROFILE) && defined(__GLIBC__)
+    #define ALLOC_PROFILE_ENABLED 1
+    #include <cerrno>
+    #include <cstdlib>
+    #include <malloc.h>
+    #include <sys/mman.h>
+#endif
+
+constinit thread_local AllocStage t_alloc_stage = AllocStage::Other;
+
+namespace
+{
+    const char* const alloc_stage_names[] = {
+        "other",
+        "demux",
+        "video",
+        "audio",
+        "callback",
+    };
+    static_assert(sizeof(alloc_stage_names) / sizeof(alloc_stage_names[0]) == static_cast<size_t>(AllocStage::Count),
+        "alloc_stage_names must match AllocStage");
+
+    struct StageCounters
+    {
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> frees{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<int64_t> live_bytes{0};
+        std::atomic<int64_t> peak_live_bytes{0};
+    };
+
+    std::array<StageCounters, static_cast<size_t>(AllocStage::Count)> counters;
+    // Блоки, которые не поместились в таблицу: их освобождение не увидим
+    std::atomic<uint64_t> untracked{0};
+
+#ifdef ALLOC_PROFILE_ENABLED
+    // Размер и стадия каждого живого блока — в таблице с открытой
+    // адресацией вне кучи (mmap), чтобы учёт сам ничего не выделял.
+    // Таблица разбита на части со своими спинлоками
+    constexpr int SHARD_BITS = 6;
+    constexpr size_t SHARD_COUNT = size_t{1} << SHARD_BITS;
+    constexpr size_t SHARD_SLOTS = size_t{1} << 15;
+    constexpr size_t SHARD_LIMIT = SHARD_SLOTS - SHARD_SLOTS / 8;
+    constexpr int STAGE_SHIFT = 56;
+
+    struct Slot
+    {
+        uintptr_t key;
+        // Размер в младших 56 битах, стадия в старших
+        uint64_t value;
+    };
+
+    struct Shard
+    {
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        Slot* slots = nullptr;
+        size_t used = 0;
+    };
+
+    std::array<Shard, SHARD_COUNT> shards;
+    std::atomic<bool> enabled{false};
+
+    uint64_t hash_pointer(const void* pointer)
+    {
+        return (reinterpret_cast<uintptr_t>(pointer) >> 4) * 0x9E3779B97F4A7C15ull;
+    }
+
+    class ShardLock
+    {
+    public:
+        explicit ShardLock(Shard& shard)
+            : shard_(shard)
+        {
+            while (shard_.lock.test_and_set(std::memory_order_acquire))
+            {
+            }
+        }
+
+        ~ShardLock()
+        {
+            shard_.lock.clear(std::memory_order_release);
+        }
+
+    private:
+        Shard& shard_;
+    };
+
+    bool table_insert(const void* pointer, uint64_t value)
+    {
+        uint64_t hash = hash_pointer(pointer);
+        Shard& shard = shards[hash >> (64 - SHARD_BITS)];
+        ShardLock lock(shard);
+        if (shard.used >= SHARD_LIMIT)
+            return false;
+
+        size_t index = hash & (SHARD_SLOTS - 1);
+        while (shard.slots[index].key != 0)
+        {
+            index = (index + 1) & (SHARD_SLOTS - 1);
+        }
+        shard.slots[index] = Slot{reinterpret_cast<uintptr_t>(pointer), value};
+        shard.used++;
+        return true;
+    }
+
+    // Удаление со сдвигом хвоста цепочки назад, без меток удалённых
+    bool table_remove(const void* pointer, uint64_t& value)
+    {
+        uint64_t hash = hash_pointer(pointer);
+        Shard& shard = shards[hash >> (64 - SHARD_BITS)];
+        ShardLock lock(shard);
+
+        const uintptr_t key = reinterpret_cast<uintptr_t>(pointer);
+        size_t index = hash & (SHARD_SLOTS - 1);
+        while (shard.slots[index].key != key)
+        {
+            if (shard.slots[index].key == 0)
+                return false;
+            index = (index + 1) & (SHARD_SLOTS - 1);
+        }
+        value = shard.slots[index].value;
+
+        size_t hole = index;
+        size_t next = (index + 1) & (SHARD_SLOTS - 1);
+        while (shard.slots[next].key != 0)
+        {
+            size_t home = hash_pointer(reinterpret_cast<const void*>(shard.slots[next].key)) & (SHARD_SLOTS - 1);
+            // Элемент можно сдвинуть в дыру, если его место не между дырой и ним
+            bool movable = hole <= next ? (home <= hole || home > next) : (home <= hole && home > next);
+            if (movable)
+            {
+                shard.slots[hole] = shard.slots[next];
+                hole = next;
+            }
+            next = (next + 1) & (SHARD_SLOTS - 1);
+        }
+        shard.slots[hole] = Slot{0, 0};
+        shard.used--;
+        return true;
+    }
+
+    void record_alloc(const void* pointer, size_t size)
+    {
+        if (!pointer || !enabled.load(std::memory_order_acquire))
+            return;
+
+        AllocStage stage = t_alloc_stage;
+        StageCounters& c = counters[static_cast<size_t>(stage)];
+        c.allocations.fetch_add(1, std::memory_order_relaxed);
+        c.bytes.fetch_add(size, std::memory_order_relaxed);
+
+        uint64_t value = (static_cast<uint64_t>(stage) << STAGE_SHIFT) |
+            (size & ((uint64_t{1} << STAGE_SHIFT) - 1));
+        if (!table_insert(pointer, value))
+        {
+            untracked.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        int64_t live = c.live_bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) +
+            static_cast<int64_t>(size);
+        int64_t peak = c.peak_live_bytes.load(std::memory_order_relaxed);
+        while (live > peak && !c.peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void record_free(const void* pointer)
+    {
+        if (!pointer || !enabled.load(std::memory_order_acquire))
+            return;
+
+        uint64_t value = 0;
+        if (!table_remove(pointer, value))
+            return;
+
+        StageCounters& c = counters[value >> STAGE_SHIFT];
+        c.frees.fetch_add(1, std::memory_order_relaxed);
+        c.live_bytes.fetch_sub(static_cast<int64_t>(value & ((uint64_t{1} << STAGE_SHIFT) - 1)),
+            std::memory_order_relaxed);
+    }
+#endif
+}
+
+#ifdef ALLOC_PROFILE_ENABLED
+// Подмена функций glibc. Исполняемый файл экспортирует их, так что
+// libavcodec, libstdc++ (operator new) и SDL тоже вызывают эти обёртки
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+    void* __libc_valloc(size_t size);
+    void* __libc_pvalloc(size_t size);
+    void __libc_free(void* pointer);
+
+    void* malloc(size_t size) noexcept
+    {
+        void* pointer = __libc_malloc(size);
+        record_alloc(pointer, size);
+        return pointer;
+    }
+
+    void* calloc(size_t count, size_t size) noexcept
+    {
+        void* pointer = __libc_calloc(count, size);
+        record_alloc(pointer, count * size);
+        return pointer;
+    }
+
+    void* realloc(void* pointer, size_t size) noexcept
+    {
+        void* moved = __libc_realloc(pointer, size);
+        if (moved || size == 0)
+        {
+            record_free(pointer);
+            record_alloc(moved, size);
+        }
+        return moved;
+    }
+
+    void free(void* pointer) noexcept
+    {
+        record_free(pointer);
+        __libc_free(pointer);
+    }
+
+    int posix_memalign(void** result, size_t alignment, size_t size) noexcept
+    {
+        if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+
+        void* pointer = __libc_memalign(alignment, size);
+        if (!pointer)
+            return ENOMEM;
+
+        record_alloc(pointer, size);
+        *result = pointer;
+        return 0;
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size) noexcept
+    {
+        void* pointer = __libc_memalign(alignment, size);
+        record_alloc(pointer, size);
+        return pointer;
+    }
+
+    void* memalign(size_t alignment, size_t size) noexcept
+    {
+        void* pointer = __libc_memalign(alignment, size);
+        record_alloc(pointer, size);
+        return pointer;
+    }
+
+    void* valloc(size_t size) noexcept
+    {
+        void* pointer = __libc_valloc(size);
+        record_alloc(pointer, size);
+        return pointer;
+    }
+
+    void* pvalloc(size_t size) noexcept
+    {
+        void* pointer = __libc_pvalloc(size);
+        record_alloc(pointer, size);
+        return pointer;
+    }
+}
+#endif
+
+bool alloc_profile_available()
+{
+#ifdef ALLOC_PROFILE_ENABLED
+    return true;
+#else
+    return false;
+#endif
+}
+
+void alloc_profile_start()
+{
+#ifdef ALLOC_PROFILE_ENABLED
+    if (enabled.load())
+        return;
+
+    for (Shard& shard : shards)
+    {
+        void* slots = mmap(nullptr, SHARD_SLOTS * sizeof(Slot), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (slots == MAP_FAILED)
+            return;
+        shard.slots = static_cast<Slot*>(slots);
+    }
+    enabled.store(true, std::memory_order_release);
+#endif
+}
+
+AllocStats alloc_profile_stats(AllocStage stage)
+{
+    const StageCounters& c = counters[static_cast<size_t>(stage)];
+    AllocStats stats;
+    stats.allocations = c.allocations.load(std::memory_order_relaxed);
+    stats.frees = c.frees.load(std::memory_order_relaxed);
+    stats.bytes = c.bytes.load(std::memory_order_relaxed);
+    stats.live_bytes = c.live_bytes.load(std::memory_order_relaxed);
+    stats.peak_live_bytes = c.peak_live_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+const char* alloc_stage_name(AllocStage stage)
+{
+    return alloc_stage_names[static_cast<size_t>(stage)];
+}
+
+void dump_alloc_profile(std::ostream& out)
+{
+    auto flags = out.flags();
+    auto precision = out.precision();
+
+    out << "Heap allocations by stage:" << std::endl;
+    out << std::left << std::setw(12) << "stage" << std::right
+        << std::setw(12) << "allocs"
+        << std::setw(12) << "frees"
+        << std::setw(12) << "MiB"
+        << std::setw(12) << "live KiB"
+        << std::setw(12) << "peak KiB" << std::endl;
+
+    out << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < static_cast<size_t>(AllocStage::Count); i++)
+    {
+        AllocStats s = alloc_profile_stats(static_cast<AllocStage>(i));
+        out << std::left << std::setw(12) << alloc_stage_names[i] << std::right
+            << std::setw(12) << s.allocations
+            << std::setw(12) << s.frees
+            << std::setw(12) << s.bytes / (1024.0 * 1024.0)
+            << std::setw(12) << s.live_bytes / 1024.0
+            << std::setw(12) << s.peak_live_bytes / 1024.0 << std::endl;
+    }
+
+    uint64_t lost = untracked.load(std::memory_order_relaxed);
+    if (lost > 0)
+    {
+        out << lost << " allocations did not fit the tracking table; their frees are not counted" << std::endl;
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
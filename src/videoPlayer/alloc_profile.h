@@ -0,0 +1,55 @@
+#ifndef ALLOC_PROFILE_H
+#define ALLOC_PROFILE_H
+
+#include <cstdint>
+#include <ostream>
+
+// Стадии, которым засчитываются выделения памяти
+enum class AllocStage : uint8_t
+{
+    // Пул задач между задачами, главный поток, потоки вне конвейера
+    Other,
+    Demux,
+    Video,
+    Audio,
+    Callback,
+    Count
+};
+
+// Стадия текущего потока. Задача конвейера ставит свою при запуске, а
+// ожидания TaskScheduler и AsyncCondition переносят её на поток, который
+// продолжит задачу
+extern constinit thread_local AllocStage t_alloc_stage;
+
+inline AllocStage alloc_stage()
+{
+    return t_alloc_stage;
+}
+
+inline void set_alloc_stage(AllocStage stage)
+{
+    t_alloc_stage = stage;
+}
+
+struct AllocStats
+{
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t bytes = 0;
+    // Память, выделенная стадией и ещё не освобождённая (кем бы ни
+    // освобождалась — пакет демультиплексора отпускает декодер)
+    int64_t live_bytes = 0;
+    int64_t peak_live_bytes = 0;
+};
+
+// Подсчёт есть только в сборке с ENABLE_ALLOC_PROFILE (glibc): там
+// malloc, calloc, realloc, posix_memalign и родственные подменяются
+// считающими обёртками. Через них же идут operator new и av_malloc
+bool alloc_profile_available();
+// Начать подсчёт; выделения до вызова не учитываются
+void alloc_profile_start();
+AllocStats alloc_profile_stats(AllocStage stage);
+const char* alloc_stage_name(AllocStage stage);
+void dump_alloc_profile(std::ostream& out);
+
+#endif
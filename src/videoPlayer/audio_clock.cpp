@@ -12,6 +12,11 @@ void AudioClock::update(int64_t pts, double time_base, int samples_played, int s
 
 double AudioClock::get_time()
 {
+    if (paused_.load())
+    {
+        return current_pts_.load();
+    }
+    
     int64_t now = av_gettime();
     int64_t elapsed = now - last_update_.load();
     double elapsed_seconds = static_cast<double>(elapsed) / 1000000.0 * speed_.load();
@@ -21,10 +26,33 @@ double AudioClock::get_time()
 
 void AudioClock::set_speed(double speed)
 {
+    // Прошедшее время досчитывается по старой скорости, новая действует
+    // с этого момента. До первого update часы ещё не идут
+    if (!paused_.load() && last_update_.load() != 0)
+    {
+        current_pts_.store(get_time());
+        last_update_.store(av_gettime());
+    }
     speed_.store(std::clamp(speed, 0.5, 2.0));
 }
 
 double AudioClock::get_speed() const
 {
     return speed_.load();
+}
+
+void AudioClock::set_paused(bool paused)
+{
+    if (paused == paused_.load())
+        return;
+    
+    if (paused)
+    {
+        current_pts_.store(get_time());
+    }
+    else
+    {
+        last_update_.store(av_gettime());
+    }
+    paused_.store(paused);
 }
\ No newline at end of file
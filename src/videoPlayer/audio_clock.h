@@ -14,12 +14,15 @@ private:
     std::atomic<double> current_pts_{0.0};
     std::atomic<int64_t> last_update_{0};
     std::atomic<double> speed_{1.0};
+    std::atomic<bool> paused_{false};
 
 public:
     void update(int64_t pts, double time_base, int samples_played, int sample_rate);
     double get_time();
     void set_speed(double speed);
     double get_speed() const;
+    // На паузе время стоит; после неё идёт дальше с того же места
+    void set_paused(bool paused);
 };
 
 #endif
\ No newline at end of file
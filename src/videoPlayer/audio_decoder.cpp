@@ -1,5 +1,9 @@
 #include "audio_decoder.h"
 #include "shared_data.h"
+#include "stage_stats.h"
+#include "trace.h"
+#include "thread_budget.h"
+#include "time_stretch.h"
 #include <iostream>
 
 extern "C" {
@@ -12,18 +16,9 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
-
-void audio_callback(void* userdata, Uint8* stream, int len);
-
 bool initialize_audio(AVFormatContext* format_ctx, int audio_stream_index,
-    AVCodecContext*& audio_codec_ctx, std::shared_ptr<SharedData> shared)
+    AVCodecContext*& audio_codec_ctx)
 {
-    if (SDL_Init(SDL_INIT_AUDIO) < 0)
-    {
-        std::cerr << "SDL initialization failed: " << SDL_GetError() << std::endl;
-        return false;
-    }
-    
     AVCodecParameters* audio_codec_params = format_ctx->streams[audio_stream_index]->codecpar;
     const AVCodec* audio_codec = avcodec_find_decoder(audio_codec_params->codec_id);
     
@@ -54,43 +49,48 @@ bool initialize_audio(AVFormatContext* format_ctx, int audio_stream_index,
         return false;
     }
     
-    SDL_AudioSpec wanted_spec, obtained_spec;
-    
-    wanted_spec.freq = 48000;
-    wanted_spec.format = AUDIO_S16SYS;
-    wanted_spec.channels = 2;
-    wanted_spec.samples = 4096;
-    wanted_spec.callback = audio_callback;
-    wanted_spec.userdata = shared.get();
-    
-    if (SDL_OpenAudio(&wanted_spec, &obtained_spec) < 0)
-    {
-        std::cerr << "Failed to open audio device: " << SDL_GetError() << std::endl;
-        avcodec_free_context(&audio_codec_ctx);
-        return false;
-    }
-    
-    SDL_PauseAudio(0);
     return true;
 }
 
 void audio_callback(void* userdata, Uint8* stream, int len)
 {
+    trace_set_thread_name("audio_callback");
+    apply_thread_role(ThreadRole::AudioCallback);
+    set_alloc_stage(AllocStage::Callback);
+    StageTimer timer(Stage::AudioCallback);
     SharedData* shared = static_cast<SharedData*>(userdata);
+    
+    // Идёт догрузка потока: часы стоят, очередь не трогаем
+    if (shared->jitter && shared->jitter->buffering())
+    {
+        memset(stream, 0, len);
+        return;
+    }
+    
     std::unique_lock<std::mutex> lock(shared->audio_mutex);
     
     if (shared->audio_queue.empty())
     {
+        if (shared->audio_running)
+        {
+            shared->metrics.audio_underruns++;
+        }
         memset(stream, 0, len);
         return;
     }
     
+    shared->metrics.progress(PipelineThread::AudioCallback);
+    
     int filled = 0;
     int total_samples_played = 0;
     
     while (filled < len && !shared->audio_queue.empty())
     {
         auto& frame = shared->audio_queue.front();
+        if (frame->speed != shared->audio_clock.get_speed())
+        {
+            shared->audio_clock.set_speed(frame->speed);
+        }
         
         int bytes_per_sample = 2 * sizeof(int16_t);
         int samples_in_chunk = std::min(frame->size - filled, len - filled) / bytes_per_sample;
@@ -108,6 +108,7 @@ void audio_callback(void* userdata, Uint8* stream, int len)
             new_frame->pts = frame->pts;
             new_frame->sample_rate = frame->sample_rate;
             new_frame->samples = frame->samples - samples_in_chunk;
+            new_frame->speed = frame->speed;
             memcpy(new_frame->data, frame->data + to_copy, new_frame->size);
             
             frame = new_frame;
@@ -115,7 +116,11 @@ void audio_callback(void* userdata, Uint8* stream, int len)
         else
         {
             shared->audio_queue.pop();
-            shared->audio_cv.notify_one();
+            // В экономичном режиме декодер доливает очередь с половины
+            if (!shared->power_save || shared->audio_queue.size() <= shared->MAX_FRAME_QUEUE_SIZE / 2)
+            {
+                shared->audio_cv.notify_one();
+            }
             
             shared->audio_samples_played_ += frame->samples;
         }
@@ -123,18 +128,25 @@ void audio_callback(void* userdata, Uint8* stream, int len)
     
     if (filled < len)
     {
+        if (shared->audio_running)
+        {
+            shared->metrics.audio_underruns++;
+        }
         memset(stream + filled, 0, len - filled);
     }
+    
+    trace_counter("audio_queue", shared->audio_queue.size());
 }
 
-void decode_audio(AVCodecContext* audio_codec_ctx, AVRational audio_time_base,
+PipelineTask decode_audio(AVCodecContext* audio_codec_ctx, AVRational audio_time_base,
     std::shared_ptr<SharedData> shared)
 {
+    set_alloc_stage(AllocStage::Audio);
     AVFrame* frame = av_frame_alloc();
     if (!frame)
     {
         std::cerr << "Failed to allocate audio frame" << std::endl;
-        return;
+        co_return;
     }
     
     SwrContext* swr_ctx = swr_alloc();
@@ -142,7 +154,7 @@ void decode_audio(AVCodecContext* audio_codec_ctx, AVRational audio_time_base,
     {
         std::cerr << "Failed to allocate swresample context" << std::endl;
         av_frame_free(&frame);
-        return;
+        co_return;
     }
     
     // ЗДЕСЬ ИСПРАВЛЕНИЕ: используем новый API для FFmpeg 5.0+
@@ -166,7 +178,7 @@ void decode_audio(AVCodecContext* audio_codec_ctx, AVRational audio_time_base,
         std::cerr << "Failed to set swresample options" << std::endl;
         swr_free(&swr_ctx);
         av_frame_free(&frame);
-        return;
+        co_return;
     }
     
     // УДАЛИТЬ СТАРОЕ:
@@ -186,20 +198,31 @@ void decode_audio(AVCodecContext* audio_codec_ctx, AVRational audio_time_base,
         std::cerr << "Failed to initialize swresample" << std::endl;
         swr_free(&swr_ctx);
         av_frame_free(&frame);
-        return;
+        co_return;
     }
     const int output_sample_rate = 48000;
     
+    // Темп меняется после swr_convert, до очереди: устройство всегда
+    // получает 48 кГц
+    TimeStretch stretch(output_sample_rate, 2);
+    std::vector<int16_t> stretched;
+    
+    shared->metrics.thread_started(PipelineThread::AudioDecode);
+    shared->metrics.thread_started(PipelineThread::AudioCallback);
+    
     while (shared->audio_running)
     {
         std::shared_ptr<AVPacket> packet;
         
         {
+            StageTimer wait_timer(Stage::AudioPacketWait);
             std::unique_lock<std::mutex> lock(shared->packet_mutex);
-            shared->packet_cv.wait(lock, [shared]()
+            const size_t batch = shared->packet_batch();
+            while (shared->audio_packets.size() < batch && shared->demuxer_running)
             {
-                return !shared->audio_packets.empty() || !shared->demuxer_running;
-            });
+                co_await shared->packet_cv.wait(lock);
+            }
+            wait_timer.stop();
             
             if (!shared->audio_running || (!shared->demuxer_running && shared->audio_packets.empty()))
             {
@@ -210,28 +233,42 @@ void decode_audio(AVCodecContext* audio_codec_ctx, AVRational audio_time_base,
             {
                 packet = shared->audio_packets.front();
                 shared->audio_packets.pop();
-                shared->packet_cv.notify_one();
+                if (shared->jitter && packet)
+                {
+                    shared->jitter->remove(JitterStream::Audio, packet->duration * av_q2d(audio_time_base));
+                }
+                trace_counter("audio_packets", shared->audio_packets.size());
+                if (batch == 1 || shared->audio_packets.size() == shared->MAX_PACKET_QUEUE_SIZE - batch)
+                {
+                    shared->packet_cv.notify_all();
+                }
             }
         }
         
+        TraceSpan packet_span("audio_packet", packet ? packet->pts : TraceSpan::NO_PTS);
         if (!packet)
         {
             avcodec_send_packet(audio_codec_ctx, nullptr);
         }
         else
         {
+            StageTimer send_timer(Stage::AudioSendPacket);
             int ret = avcodec_send_packet(audio_codec_ctx, packet.get());
+            send_timer.stop();
             if (ret < 0)
             {
                 continue;
             }
         }
+        packet_span.stop();
         
         while (true)
         {
+            StageTimer receive_timer(Stage::AudioReceiveFrame);
             int ret = avcodec_receive_frame(audio_codec_ctx, frame);
             if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
             {
+                receive_timer.cancel();
                 break;
             }
             else if (ret < 0)
@@ -239,6 +276,8 @@ void decode_audio(AVCodecContext* audio_codec_ctx, AVRational audio_time_base,
                 std::cerr << "Error during audio decoding" << std::endl;
                 break;
             }
+            receive_timer.stop();
+            shared->metrics.progress(PipelineThread::AudioDecode);
             
             int dst_nb_samples = av_rescale_rnd(
                 swr_get_delay(swr_ctx, frame->sample_rate) + frame->nb_samples,
@@ -256,8 +295,20 @@ void decode_audio(AVCodecContext* audio_codec_ctx, AVRational audio_time_base,
                 continue;
             }
             
+            StageTimer resample_timer(Stage::AudioResample);
             int converted_samples = swr_convert(swr_ctx, dst_data, dst_nb_samples,
                 (const uint8_t**)frame->data, frame->nb_samples);
+            resample_timer.stop();
+                
+            const uint8_t* samples = dst_data[0];
+            stretch.set_speed(shared->playback_speed.load());
+            if (converted_samples > 0 && !stretch.passthrough())
+            {
+                StageTimer stretch_timer(Stage::AudioStretch);
+                stretch.process(reinterpret_cast<const int16_t*>(dst_data[0]), converted_samples, stretched);
+                samples = reinterpret_cast<const uint8_t*>(stretched.data());
+                converted_samples = static_cast<int>(stretched.size() / 2);
+            }
                 
             if (converted_samples > 0)
             {
@@ -270,20 +321,22 @@ void decode_audio(AVCodecContext* audio_codec_ctx, AVRational audio_time_base,
                 audio_frame->pts = frame->pts;
                 audio_frame->sample_rate = output_sample_rate;
                 audio_frame->samples = converted_samples;
-                memcpy(audio_frame->data, dst_data[0], data_size);
+                audio_frame->speed = stretch.speed();
+                memcpy(audio_frame->data, samples, data_size);
                 
                 {
                     std::unique_lock<std::mutex> lock(shared->audio_mutex);
-                    shared->audio_cv.wait(lock, [shared]()
+                    while (shared->audio_queue.size() >= shared->MAX_FRAME_QUEUE_SIZE &&
+                        shared->audio_running)
                     {
-                        return shared->audio_queue.size() < shared->MAX_FRAME_QUEUE_SIZE ||
-                            !shared->audio_running;
-                    });
+                        co_await shared->audio_cv.wait(lock);
+                    }
                     
                     if (!shared->audio_running)
                         break;
                     
                     shared->audio_queue.push(audio_frame);
+                    trace_counter("audio_queue", shared->audio_queue.size());
                     
                     if (shared->last_audio_update_ == 0)
                     {
@@ -302,16 +355,19 @@ void decode_audio(AVCodecContext* audio_codec_ctx, AVRational audio_time_base,
             
             av_frame_unref(frame);
         }
+        
+        // Слит перед следующим проходом повтора по кругу
+        if (!packet)
+        {
+            avcodec_flush_buffers(audio_codec_ctx);
+        }
     }
     
+    shared->metrics.thread_finished(PipelineThread::AudioCallback);
+    shared->metrics.thread_finished(PipelineThread::AudioDecode);
+    
     // Не забудьте освободить AVChannelLayout в конце
     av_channel_layout_uninit(&out_ch_layout);
     swr_free(&swr_ctx);
     av_frame_free(&frame);
 }
-
-void cleanup_audio()
-{
-    SDL_CloseAudio();
-    SDL_Quit();
-}
\ No newline at end of file
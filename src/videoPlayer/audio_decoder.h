@@ -10,12 +10,14 @@ extern "C"
 #include <SDL2/SDL.h>
 }
 
+// Открывает декодер аудиопотока; вывод звука открывается отдельно (AudioOutput)
 bool initialize_audio(AVFormatContext* format_ctx, int audio_stream_index,
-    AVCodecContext*& audio_codec_ctx, std::shared_ptr<SharedData> shared);
+    AVCodecContext*& audio_codec_ctx);
 
-void decode_audio(AVCodecContext* audio_codec_ctx, AVRational audio_time_base,
+PipelineTask decode_audio(AVCodecContext* audio_codec_ctx, AVRational audio_time_base,
     std::shared_ptr<SharedData> shared);
 
-void cleanup_audio();
+// Колбэк SDL: заполняет stream из shared->audio_queue (userdata — SharedData*)
+void audio_callback(void* userdata, Uint8* stream, int len);
 
 #endif
\ No newline at end of file
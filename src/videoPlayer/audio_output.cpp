@@ -0,0 +1,153 @@
+#include "audio_output.h"
+#include "audio_decoder.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+extern "C"
+{
+#include <SDL2/SDL.h>
+}
+
+SdlAudioOutput::~SdlAudioOutput()
+{
+    close();
+}
+
+bool SdlAudioOutput::open(std::shared_ptr<SharedData> shared)
+{
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0)
+    {
+        std::cerr << "SDL initialization failed: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    
+    shared_ = std::move(shared);
+    
+    SDL_AudioSpec wanted_spec, obtained_spec;
+    
+    wanted_spec.freq = AUDIO_OUTPUT_SAMPLE_RATE;
+    wanted_spec.format = AUDIO_S16SYS;
+    wanted_spec.channels = AUDIO_OUTPUT_CHANNELS;
+    wanted_spec.samples = shared_->power_save ? AUDIO_OUTPUT_POWER_SAVE_SAMPLES : AUDIO_OUTPUT_BUFFER_SAMPLES;
+    wanted_spec.callback = callback;
+    wanted_spec.userdata = this;
+    
+    device_ = SDL_OpenAudioDevice(nullptr, 0, &wanted_spec, &obtained_spec, 0);
+    if (device_ == 0)
+    {
+        std::cerr << "Failed to open audio device: " << SDL_GetError() << std::endl;
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        shared_.reset();
+        return false;
+    }
+    
+    SDL_PauseAudioDevice(device_, 0);
+    return true;
+}
+
+void SdlAudioOutput::close()
+{
+    if (device_ == 0)
+        return;
+    
+    SDL_CloseAudioDevice(device_);
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    shared_.reset();
+    device_ = 0;
+}
+
+void SdlAudioOutput::set_source(std::shared_ptr<SharedData> shared)
+{
+    if (device_ == 0)
+        return;
+    
+    // SDL держит эту же блокировку на время callback
+    SDL_LockAudioDevice(device_);
+    shared_.swap(shared);
+    SDL_UnlockAudioDevice(device_);
+    // Прежний источник освобождается уже вне блокировки
+}
+
+void SdlAudioOutput::callback(void* userdata, uint8_t* stream, int len)
+{
+    auto* self = static_cast<SdlAudioOutput*>(userdata);
+    if (!self->shared_)
+    {
+        memset(stream, 0, len);
+        return;
+    }
+    audio_callback(self->shared_.get(), stream, len);
+}
+
+NullAudioOutput::~NullAudioOutput()
+{
+    close();
+}
+
+bool NullAudioOutput::open(std::shared_ptr<SharedData> shared)
+{
+    shared_ = std::move(shared);
+    running_ = true;
+    thread_ = std::thread(&NullAudioOutput::run, this);
+    return true;
+}
+
+void NullAudioOutput::close()
+{
+    running_ = false;
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+    shared_.reset();
+}
+
+void NullAudioOutput::run()
+{
+    int samples = AUDIO_OUTPUT_BUFFER_SAMPLES;
+    {
+        std::lock_guard<std::mutex> lock(source_mutex_);
+        if (shared_ && shared_->power_save)
+        {
+            samples = AUDIO_OUTPUT_POWER_SAVE_SAMPLES;
+        }
+    }
+    const int len = samples * AUDIO_OUTPUT_CHANNELS * sizeof(int16_t);
+    const auto period = std::chrono::microseconds(int64_t(samples) * 1000000 / AUDIO_OUTPUT_SAMPLE_RATE);
+    std::vector<Uint8> stream(len);
+    
+    auto next = std::chrono::steady_clock::now();
+    while (running_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(source_mutex_);
+            if (shared_)
+            {
+                audio_callback(shared_.get(), stream.data(), len);
+            }
+        }
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void NullAudioOutput::set_source(std::shared_ptr<SharedData> shared)
+{
+    std::lock_guard<std::mutex> lock(source_mutex_);
+    shared_.swap(shared);
+}
+
+std::unique_ptr<AudioOutput> make_audio_output(AudioOutputType type)
+{
+    switch (type)
+    {
+    case AudioOutputType::Null:
+        return std::make_unique<NullAudioOutput>();
+    case AudioOutputType::Sdl:
+    default:
+        return std::make_unique<SdlAudioOutput>();
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef AUDIO_OUTPUT_H
+#define AUDIO_OUTPUT_H
+
+#include "shared_data.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Формат, в который decode_audio пересэмплирует звук и который ожидает
+// audio_callback: 48 кГц, стерео, S16
+constexpr int AUDIO_OUTPUT_SAMPLE_RATE = 48000;
+constexpr int AUDIO_OUTPUT_CHANNELS = 2;
+constexpr int AUDIO_OUTPUT_BUFFER_SAMPLES = 4096;
+// Буфер устройства в режиме экономии энергии: callback вдвое реже
+constexpr int AUDIO_OUTPUT_POWER_SAVE_SAMPLES = 8192;
+
+enum class AudioOutputType
+{
+    Sdl,
+    Null
+};
+
+// Устройство вывода, которое периодически вызывает audio_callback
+class AudioOutput
+{
+public:
+    virtual ~AudioOutput() = default;
+
+    virtual bool open(std::shared_ptr<SharedData> shared) = 0;
+    virtual void close() = 0;
+    // Переключает открытое устройство на очередь другого плеера без
+    // закрытия (плейлист); nullptr — тишина
+    virtual void set_source(std::shared_ptr<SharedData> shared) = 0;
+};
+
+// Отдельное устройство SDL на каждый плеер, чтобы в процессе могло
+// играть несколько потоков сразу
+class SdlAudioOutput : public AudioOutput
+{
+public:
+    ~SdlAudioOutput() override;
+
+    bool open(std::shared_ptr<SharedData> shared) override;
+    void close() override;
+    void set_source(std::shared_ptr<SharedData> shared) override;
+
+private:
+    static void callback(void* userdata, uint8_t* stream, int len);
+
+    std::shared_ptr<SharedData> shared_;
+    uint32_t device_ = 0;
+};
+
+// Забирает звук из очереди в реальном темпе и выбрасывает его
+// (для прогонов без звуковой карты)
+class NullAudioOutput : public AudioOutput
+{
+public:
+    ~NullAudioOutput() override;
+
+    bool open(std::shared_ptr<SharedData> shared) override;
+    void close() override;
+    void set_source(std::shared_ptr<SharedData> shared) override;
+
+private:
+    void run();
+
+    std::mutex source_mutex_;
+    std::shared_ptr<SharedData> shared_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+};
+
+std::unique_ptr<AudioOutput> make_audio_output(AudioOutputType type);
+
+#endif
@@ -0,0 +1,175 @@
+#include "bilevel.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+namespace
+{
+    // Отрезки, между которыми меньше стольких одинаковых байтов,
+    // сливаются: заголовок отрезка дороже
+    constexpr int MERGE_GAP = 4;
+    constexpr int MAX_RUN = 0xFFFF;
+
+    void put_u16(std::vector<uint8_t>& out, int value)
+    {
+        out.push_back(static_cast<uint8_t>(value & 0xFF));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+    }
+}
+
+void threshold_pack(const uint8_t* luma, int luma_stride, int width, int height,
+    uint8_t threshold, uint8_t* bits, int row_bytes)
+{
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t* line = luma + static_cast<size_t>(luma_stride) * y;
+        uint8_t* out = bits + static_cast<size_t>(row_bytes) * y;
+        int x = 0;
+
+        // v >= threshold  <=>  max(v, threshold) == v; movemask даёт биты в
+        // том же порядке, что и пиксели (x86 — little-endian)
+#if defined(__AVX2__)
+        const __m256i level32 = _mm256_set1_epi8(static_cast<char>(threshold));
+        for (; x + 32 <= width; x += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + x));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(v, level32), v)));
+            std::memcpy(out + x / 8, &mask, sizeof(mask));
+        }
+#endif
+#if defined(__SSE2__)
+        const __m128i level16 = _mm_set1_epi8(static_cast<char>(threshold));
+        for (; x + 16 <= width; x += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x));
+            uint16_t mask = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, level16), v)));
+            std::memcpy(out + x / 8, &mask, sizeof(mask));
+        }
+#endif
+        for (; x < width; x += 8)
+        {
+            uint8_t byte = 0;
+            int count = std::min(8, width - x);
+            for (int bit = 0; bit < count; bit++)
+            {
+                byte |= static_cast<uint8_t>((line[x + bit] >= threshold) << bit);
+            }
+            out[x / 8] = byte;
+        }
+    }
+}
+
+void expand_bilevel(const uint8_t* data, int byte_offset, int length, int width,
+    uint8_t* row_out, int channels)
+{
+    for (int i = 0; i < length; i++)
+    {
+        int x0 = (byte_offset + i) * 8;
+        int count = std::min(8, width - x0);
+        uint8_t byte = data[i];
+        uint8_t* out = row_out + static_cast<size_t>(x0) * channels;
+        for (int bit = 0; bit < count; bit++)
+        {
+            uint8_t value = (byte >> bit) & 1 ? 255 : 0;
+            for (int c = 0; c < channels; c++)
+            {
+                *out++ = value;
+            }
+        }
+    }
+}
+
+BilevelEncoder::BilevelEncoder(uint8_t threshold)
+    : threshold_(threshold)
+{
+}
+
+const BilevelFrame& BilevelEncoder::encode(const uint8_t* luma, int luma_stride, int width, int height)
+{
+    int row_bytes = (width + 7) / 8;
+    bool key = width != frame_.width || height != frame_.height;
+    if (key)
+    {
+        frame_.width = width;
+        frame_.height = height;
+        frame_.row_bytes = row_bytes;
+        current_.assign(static_cast<size_t>(row_bytes) * height, 0);
+        previous_.assign(current_.size(), 0);
+        row_offsets_.assign(static_cast<size_t>(height) + 1, 0);
+    }
+
+    // Прошлый кадр остаётся в previous_, новый пишется поверх старого буфера
+    current_.swap(previous_);
+    threshold_pack(luma, luma_stride, width, height, threshold_, current_.data(), row_bytes);
+
+    runs_.clear();
+    frame_.first_row = key ? 0 : height;
+    frame_.last_row = key ? height - 1 : -1;
+    if (!key)
+    {
+        for (int row = 0; row < height; row++)
+        {
+            row_offsets_[row] = static_cast<uint32_t>(runs_.size());
+            encode_row(row);
+            if (runs_.size() != row_offsets_[row])
+            {
+                frame_.first_row = std::min(frame_.first_row, row);
+                frame_.last_row = row;
+            }
+        }
+        row_offsets_[height] = static_cast<uint32_t>(runs_.size());
+    }
+
+    frame_.key = key;
+    frame_.bits = current_.data();
+    frame_.row_offsets = row_offsets_.data();
+    frame_.runs = runs_.data();
+    return frame_;
+}
+
+void BilevelEncoder::encode_row(int row)
+{
+    const int row_bytes = frame_.row_bytes;
+    const uint8_t* now = current_.data() + static_cast<size_t>(row_bytes) * row;
+    const uint8_t* before = previous_.data() + static_cast<size_t>(row_bytes) * row;
+    if (std::memcmp(now, before, row_bytes) == 0)
+        return;
+
+    int position = 0;
+    int x = 0;
+    while (x < row_bytes)
+    {
+        if (now[x] == before[x])
+        {
+            x++;
+            continue;
+        }
+
+        // Отрезок до первой серии из MERGE_GAP одинаковых байтов
+        int start = x;
+        int same = 0;
+        int end = x;
+        while (x < row_bytes && same < MERGE_GAP && x - start < MAX_RUN)
+        {
+            same = now[x] == before[x] ? same + 1 : 0;
+            if (same == 0)
+                end = x + 1;
+            x++;
+        }
+
+        put_u16(runs_, start - position);
+        put_u16(runs_, end - start);
+        runs_.insert(runs_.end(), now + start, now + end);
+        position = end;
+        x = end;
+    }
+}
+
+size_t BilevelEncoder::encoded_bytes() const
+{
+    return frame_.key ? current_.size() : runs_.size();
+}
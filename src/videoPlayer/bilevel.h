@@ -0,0 +1,82 @@
+#ifndef BILEVEL_H
+#define BILEVEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Двухцветный кадр: 1 бит на пиксель, бит x % 8 байта x / 8 — пиксель x
+// (младший бит слева), 1 — белый. Строки по row_bytes байт вплотную.
+//
+// Вместе с полным кадром идёт дельта к предыдущему: для каждой строки y
+// в runs[row_offsets[y] .. row_offsets[y + 1]) лежат отрезки
+//     uint16 skip, uint16 length, length байт новых значений,
+// где skip — сколько байтов строки пропустить от конца прошлого отрезка.
+// Неизменённая строка — пустой диапазон. key — дельты нет, всё новое.
+struct BilevelFrame
+{
+    int width = 0;
+    int height = 0;
+    int row_bytes = 0;
+    const uint8_t* bits = nullptr;
+    bool key = true;
+    const uint32_t* row_offsets = nullptr;
+    const uint8_t* runs = nullptr;
+    // Первая и последняя изменённые строки (first_row > last_row — нет изменений)
+    int first_row = 0;
+    int last_row = -1;
+};
+
+// Порог яркости и упаковка 8 пикселей в байт (SSE2/AVX2 на x86)
+void threshold_pack(const uint8_t* luma, int luma_stride, int width, int height,
+    uint8_t threshold, uint8_t* bits, int row_bytes);
+
+// Разворачивает length байт битов, начиная с байта byte_offset строки, в
+// пиксели по channels байт (0 или 255) в строку row_out. Пиксели за
+// шириной отбрасываются
+void expand_bilevel(const uint8_t* data, int byte_offset, int length, int width,
+    uint8_t* row_out, int channels);
+
+// Обходит отрезки дельты одной строки: callback(byte_offset, data, length)
+template <typename Callback>
+void for_each_bilevel_run(const BilevelFrame& frame, int row, Callback&& callback)
+{
+    const uint8_t* run = frame.runs + frame.row_offsets[row];
+    const uint8_t* end = frame.runs + frame.row_offsets[row + 1];
+    int offset = 0;
+    while (run < end)
+    {
+        int skip = run[0] | (run[1] << 8);
+        int length = run[2] | (run[3] << 8);
+        offset += skip;
+        callback(offset, run + 4, length);
+        offset += length;
+        run += 4 + length;
+    }
+}
+
+// Держит прошлый упакованный кадр и строит дельту к нему
+class BilevelEncoder
+{
+public:
+    explicit BilevelEncoder(uint8_t threshold);
+
+    // luma — 8-битная яркость (плоскость Y или GRAY8). Результат
+    // действителен до следующего вызова
+    const BilevelFrame& encode(const uint8_t* luma, int luma_stride, int width, int height);
+
+    // Байтов дельты в последнем кадре (для ключевого — весь кадр)
+    size_t encoded_bytes() const;
+
+private:
+    void encode_row(int row);
+
+    uint8_t threshold_;
+    BilevelFrame frame_;
+    std::vector<uint8_t> current_;
+    std::vector<uint8_t> previous_;
+    std::vector<uint32_t> row_offsets_;
+    std::vector<uint8_t> runs_;
+};
+
+#endif
@@ -1,12 +1,155 @@
 #include "demuxer.h"
+#include "packet_arena.h"
+#include "stage_stats.h"
+#include "trace.h"
+#include <algorithm>
+#include <climits>
 #include <iostream>
 
-void demuxer_thread_func(AVFormatContext* format_ctx, int video_stream_index,
-    int audio_stream_index, AVRational video_time_base,
-    AVRational audio_time_base, std::shared_ptr<SharedData> shared)
+namespace
 {
+    // Нижняя граница запаса байтов перед av_read_frame на потоковом входе
+    constexpr size_t MIN_READ_AHEAD_BYTES = 4096;
+
+    // Длительность пакета в секундах для JitterBuffer. Многие потоковые
+    // форматы её не пишут, тогда берём по частоте кадров или размеру
+    // звукового кадра и сохраняем в пакет, чтобы декодер вычел то же число
+    double packet_seconds(AVPacket* packet, const AVStream* stream)
+    {
+        if (packet->duration <= 0)
+        {
+            const AVCodecParameters* params = stream->codecpar;
+            AVRational rate = stream->avg_frame_rate.num > 0 ? stream->avg_frame_rate : stream->r_frame_rate;
+            
+            if (params->codec_type == AVMEDIA_TYPE_AUDIO && params->frame_size > 0 && params->sample_rate > 0)
+            {
+                packet->duration = av_rescale_q(params->frame_size, AVRational{1, params->sample_rate},
+                    stream->time_base);
+            }
+            else if (params->codec_type == AVMEDIA_TYPE_VIDEO && rate.num > 0 && rate.den > 0)
+            {
+                packet->duration = av_rescale_q(1, av_inv_q(rate), stream->time_base);
+            }
+            else
+            {
+                packet->duration = std::max<int64_t>(1, av_rescale_q(1, AVRational{1, 25}, stream->time_base));
+            }
+        }
+        return packet->duration * av_q2d(stream->time_base);
+    }
+
+    // Повтор по кругу: первый проход складывает пакеты в PacketArena,
+    // следующие берут их оттуда без чтения и разбора файла. Не
+    // уместившийся в loop_cache_bytes файл читается заново после
+    // перемотки. Метки времени каждого прохода сдвигаются на длину файла,
+    // чтобы часы звука и синхронизация видео шли без разрыва
+    struct LoopState
+    {
+        std::shared_ptr<PacketArena> cache;
+        bool replaying = false;
+        size_t replay_index = 0;
+        // Границы первого прохода в AV_TIME_BASE
+        int64_t start_us = INT64_MAX;
+        int64_t end_us = INT64_MIN;
+        int64_t offset_us = 0;
+    };
+    
+    void observe_loop_packet(LoopState& loop, const AVPacket* packet, const AVStream* stream)
+    {
+        if (packet->pts == AV_NOPTS_VALUE)
+            return;
+        
+        int64_t start = av_rescale_q(packet->pts, stream->time_base, AV_TIME_BASE_Q);
+        int64_t end = av_rescale_q(packet->pts + std::max<int64_t>(packet->duration, 0), stream->time_base,
+            AV_TIME_BASE_Q);
+        loop.start_us = std::min(loop.start_us, start);
+        loop.end_us = std::max(loop.end_us, end);
+    }
+    
+    // Следующий проход: из арены, если весь файл в ней, иначе перемоткой
+    bool restart_loop(LoopState& loop, AVFormatContext* format_ctx, SharedData& shared)
+    {
+        int64_t length_us = loop.end_us > loop.start_us ? loop.end_us - loop.start_us : format_ctx->duration;
+        if (length_us <= 0)
+        {
+            std::cerr << "Unknown duration, cannot loop" << std::endl;
+            return false;
+        }
+        
+        if (loop.cache)
+        {
+            loop.replaying = true;
+            loop.replay_index = 0;
+        }
+        else
+        {
+            int64_t start = format_ctx->start_time != AV_NOPTS_VALUE ? format_ctx->start_time : 0;
+            if (av_seek_frame(format_ctx, -1, start, AVSEEK_FLAG_BACKWARD) < 0)
+            {
+                std::cerr << "Seek to start failed, cannot loop" << std::endl;
+                return false;
+            }
+        }
+        
+        loop.offset_us += length_us;
+        shared.metrics.loops_completed++;
+        return true;
+    }
+    
+    void shift_packet(AVPacket* packet, const AVStream* stream, int64_t offset_us)
+    {
+        int64_t offset = av_rescale_q(offset_us, AV_TIME_BASE_Q, stream->time_base);
+        if (packet->pts != AV_NOPTS_VALUE)
+        {
+            packet->pts += offset;
+        }
+        if (packet->dts != AV_NOPTS_VALUE)
+        {
+            packet->dts += offset;
+        }
+    }
+    
+    bool queue_full(const SharedData& shared, size_t size, JitterStream stream)
+    {
+        if (shared.jitter)
+        {
+            return shared.jitter->full(stream);
+        }
+        return size >= shared.MAX_PACKET_QUEUE_SIZE;
+    }
+}
+
+PipelineTask demux_packets(TaskScheduler& scheduler, AVFormatContext* format_ctx,
+    int video_stream_index, int audio_stream_index, std::shared_ptr<SharedData> shared)
+{
+    set_alloc_stage(AllocStage::Demux);
+    shared->metrics.thread_started(PipelineThread::Demuxer);
+    // Скользящее среднее размера пакета: сколько байтов должно лежать в
+    // буфере потока, чтобы av_read_frame не ждал сеть на потоке пула
+    size_t average_packet_bytes = 16 * 1024;
+    
+    // Потоковый вход по кругу не повторить: перемотки нет
+    const bool looping = shared->loop && !shared->stream_source;
+    LoopState loop;
+    if (looping && shared->loop_cache_bytes > 0)
+    {
+        loop.cache = std::make_shared<PacketArena>(shared->loop_cache_bytes);
+    }
+
     while (shared->demuxer_running)
     {
+        if (shared->stream_source)
+        {
+            StreamSource& source = *shared->stream_source;
+            size_t read_ahead = std::max(MIN_READ_AHEAD_BYTES, 2 * average_packet_bytes);
+            std::unique_lock<std::mutex> lock(source.mutex());
+            while (!source.readable_locked(read_ahead) && shared->demuxer_running)
+            {
+                co_await source.data_condition().wait(lock);
+            }
+        }
+        
+        TraceSpan span("demux_packet");
         std::shared_ptr<AVPacket> packet(av_packet_alloc(), [](AVPacket* p)
         {
             av_packet_unref(p);
@@ -19,11 +162,25 @@ void demuxer_thread_func(AVFormatContext* format_ctx, int video_stream_index,
             break;
         }
         
-        int ret = av_read_frame(format_ctx, packet.get());
+        int ret;
+        if (loop.replaying)
+        {
+            ret = loop.replay_index < loop.cache->size() ?
+                (loop.cache->fill(loop.replay_index++, packet.get()) ? 0 : AVERROR(ENOMEM)) : AVERROR_EOF;
+        }
+        else
+        {
+            StageTimer timer(Stage::DemuxRead);
+            ret = av_read_frame(format_ctx, packet.get());
+        }
         if (ret < 0)
         {
-            if (ret == AVERROR_EOF)
+            if (ret == AVERROR_EOF || (ret == AVERROR_EXIT && shared->stream_source))
             {
+                if (shared->jitter)
+                {
+                    shared->jitter->set_eof();
+                }
                 {
                     std::lock_guard<std::mutex> lock(shared->packet_mutex);
                     if (video_stream_index != -1)
@@ -36,43 +193,122 @@ void demuxer_thread_func(AVFormatContext* format_ctx, int video_stream_index,
                     }
                     shared->packet_cv.notify_all();
                 }
+                // Пустые пакеты выше сливают декодеры, после чего они
+                // сбрасываются и принимают следующий проход
+                if (looping && restart_loop(loop, format_ctx, *shared))
+                {
+                    continue;
+                }
                 break;
             }
             continue;
         }
         
+        if (looping && !loop.replaying && packet->stream_index >= 0 &&
+            packet->stream_index < static_cast<int>(format_ctx->nb_streams) &&
+            (packet->stream_index == video_stream_index || packet->stream_index == audio_stream_index))
+        {
+            const AVStream* stream = format_ctx->streams[packet->stream_index];
+            if (loop.offset_us == 0)
+            {
+                observe_loop_packet(loop, packet.get(), stream);
+                if (loop.cache && !loop.cache->append(packet.get()))
+                {
+                    std::cout << "File exceeds the " << (shared->loop_cache_bytes >> 20)
+                        << " MiB loop cache, looping by seeking" << std::endl;
+                    loop.cache.reset();
+                }
+                shared->metrics.loop_cache_bytes = loop.cache ? loop.cache->bytes() : 0;
+            }
+        }
+        if (loop.offset_us > 0 && packet->stream_index >= 0 &&
+            packet->stream_index < static_cast<int>(format_ctx->nb_streams))
+        {
+            shift_packet(packet.get(), format_ctx->streams[packet->stream_index], loop.offset_us);
+        }
+        span.set_pts(packet->pts);
+        shared->metrics.progress(PipelineThread::Demuxer);
+        average_packet_bytes = (average_packet_bytes * 7 + static_cast<size_t>(packet->size)) / 8;
+        
+        double seconds = 0.0;
+        if (shared->jitter && packet->stream_index >= 0 &&
+            packet->stream_index < static_cast<int>(format_ctx->nb_streams))
+        {
+            seconds = packet_seconds(packet.get(), format_ctx->streams[packet->stream_index]);
+        }
+        
+        span.stop();
+        
+        // Пачками: потребитель ждёт batch пакетов, а мы после полной
+        // очереди — пока она не опустеет до refill_mark
+        const size_t batch = shared->packet_batch();
+        const size_t refill_mark = batch > 1 ? shared->MAX_PACKET_QUEUE_SIZE - batch : SIZE_MAX;
         std::unique_lock<std::mutex> lock(shared->packet_mutex);
         
         if (packet->stream_index == video_stream_index && video_stream_index != -1)
         {
-            while (shared->video_packets.size() >= shared->MAX_PACKET_QUEUE_SIZE &&
-                shared->demuxer_running)
+            bool waited = false;
+            while ((queue_full(*shared, shared->video_packets.size(), JitterStream::Video) ||
+                (waited && shared->video_packets.size() > refill_mark)) && shared->demuxer_running)
             {
-                shared->packet_cv.wait(lock);
+                if (!waited && shared->slow_source)
+                {
+                    shared->slow_source->queue_full();
+                }
+                waited = true;
+                co_await shared->packet_cv.wait(lock);
             }
             
             if (!shared->demuxer_running)
                 break;
             
             shared->video_packets.push(packet);
-            shared->packet_cv.notify_all();
+            if (shared->jitter)
+            {
+                shared->jitter->add(JitterStream::Video, seconds);
+            }
+            trace_counter("video_packets", shared->video_packets.size());
+            if (batch == 1 || shared->video_packets.size() == batch)
+            {
+                shared->packet_cv.notify_all();
+            }
         }
         else if (packet->stream_index == audio_stream_index && audio_stream_index != -1)
         {
-            while (shared->audio_packets.size() >= shared->MAX_PACKET_QUEUE_SIZE &&
-                shared->demuxer_running)
+            bool waited = false;
+            while ((queue_full(*shared, shared->audio_packets.size(), JitterStream::Audio) ||
+                (waited && shared->audio_packets.size() > refill_mark)) && shared->demuxer_running)
             {
-                shared->packet_cv.wait(lock);
+                if (!waited && shared->slow_source)
+                {
+                    shared->slow_source->queue_full();
+                }
+                waited = true;
+                co_await shared->packet_cv.wait(lock);
             }
             
             if (!shared->demuxer_running)
                 break;
             
             shared->audio_packets.push(packet);
-            shared->packet_cv.notify_all();
+            if (shared->jitter)
+            {
+                shared->jitter->add(JitterStream::Audio, seconds);
+            }
+            trace_counter("audio_packets", shared->audio_packets.size());
+            if (batch == 1 || shared->audio_packets.size() == batch)
+            {
+                shared->packet_cv.notify_all();
+            }
         }
+        lock.unlock();
+        
+        // Чтение идёт без ожиданий, пока есть место в очереди, поэтому
+        // отдаём поток пула задачам других плееров после каждого пакета
+        co_await scheduler.yield();
     }
     
+    shared->metrics.thread_finished(PipelineThread::Demuxer);
     shared->demuxer_running = false;
     shared->packet_cv.notify_all();
 }
\ No newline at end of file
@@ -8,8 +8,7 @@ extern "C"
 #include <libavformat/avformat.h>
 }
 
-void demuxer_thread_func(AVFormatContext* format_ctx, int video_stream_index,
-    int audio_stream_index, AVRational video_time_base,
-    AVRational audio_time_base, std::shared_ptr<SharedData> shared);
+PipelineTask demux_packets(TaskScheduler& scheduler, AVFormatContext* format_ctx,
+    int video_stream_index, int audio_stream_index, std::shared_ptr<SharedData> shared);
 
 #endif
\ No newline at end of file
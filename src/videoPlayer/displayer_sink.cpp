@@ -0,0 +1,122 @@
+#include "displayer_sink.h"
+#include "stage_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "OpenGLSomethingFrameDisplayerEVO.h"
+
+DisplayerSink::DisplayerSink(OpenGLSomethingFrameDisplayerEVO::OpenGLSomethingFrameDisplayerEVO& displayer)
+    : displayer_(displayer)
+{
+}
+
+void DisplayerSink::set_video_size(int width, int height)
+{
+    displayer_.SetVideoSize(width, height);
+}
+
+void DisplayerSink::wait_ready()
+{
+    displayer_.WaitForGameInit();
+
+    uint8_t*  blackFrame [480*360*3];
+    memset(blackFrame, 255, sizeof(blackFrame));
+    auto temp = &blackFrame;
+    displayer_.DisplayFrame((uint8_t**)&temp);
+    std::this_thread::sleep_for(std::chrono::milliseconds(25555));
+}
+
+void DisplayerSink::display_frame(uint8_t* rgb, int width, int height, double pts)
+{
+    StageTimer timer(Stage::DisplayHandoff);
+    displayer_.DisplayFrame(rgb);
+}
+
+OutputFormatRequest DisplayerSink::output_formats() const
+{
+    return {{PixelFormat::Rgb24, PixelFormat::Gray8}, false};
+}
+
+void DisplayerSink::display_image(const VideoImage& image, double pts)
+{
+    if (image.format != PixelFormat::Gray8)
+    {
+        display_frame(image.data[0], image.width, image.height, pts);
+        return;
+    }
+
+    {
+        StageTimer timer(Stage::VideoScale);
+        // Телевизионный диапазон растягиваем заодно, таблицей
+        uint8_t levels[256];
+        for (int i = 0; i < 256; i++)
+        {
+            int value = image.limited_range ? (i - 16) * 255 / 219 : i;
+            levels[i] = static_cast<uint8_t>(std::clamp(value, 0, 255));
+        }
+
+        expanded_.resize(static_cast<size_t>(image.width) * image.height * 3);
+        uint8_t* out = expanded_.data();
+        for (int y = 0; y < image.height; y++)
+        {
+            const uint8_t* line = image.data[0] + static_cast<size_t>(image.stride[0]) * y;
+            for (int x = 0; x < image.width; x++)
+            {
+                uint8_t value = levels[line[x]];
+                out[0] = value;
+                out[1] = value;
+                out[2] = value;
+                out += 3;
+            }
+        }
+    }
+    display_frame(expanded_.data(), image.width, image.height, pts);
+}
+
+bool DisplayerSink::accepts_bilevel() const
+{
+    return true;
+}
+
+void DisplayerSink::display_bilevel(const BilevelFrame& frame, double pts)
+{
+    size_t row_size = static_cast<size_t>(frame.width) * 3;
+    {
+        StageTimer timer(Stage::VideoScale);
+        if (frame.key)
+        {
+            bilevel_rgb_.resize(row_size * frame.height);
+            for (int y = 0; y < frame.height; y++)
+            {
+                expand_bilevel(frame.bits + static_cast<size_t>(frame.row_bytes) * y, 0, frame.row_bytes,
+                    frame.width, bilevel_rgb_.data() + row_size * y, 3);
+            }
+        }
+        else
+        {
+            if (frame.first_row > frame.last_row)
+                return;
+
+            for (int y = frame.first_row; y <= frame.last_row; y++)
+            {
+                uint8_t* row = bilevel_rgb_.data() + row_size * y;
+                for_each_bilevel_run(frame, y, [&](int offset, const uint8_t* data, int length)
+                {
+                    expand_bilevel(data, offset, length, frame.width, row, 3);
+                });
+            }
+        }
+    }
+    display_frame(bilevel_rgb_.data(), frame.width, frame.height, pts);
+}
+
+void DisplayerSink::display_frame_damage(uint8_t* rgb, int width, int height, double pts,
+    const FrameDamage& damage)
+{
+    if (damage.empty())
+        return;
+    display_frame(rgb, width, height, pts);
+}
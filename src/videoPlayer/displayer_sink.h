@@ -0,0 +1,40 @@
+#ifndef DISPLAYER_SINK_H
+#define DISPLAYER_SINK_H
+
+#include "video_sink.h"
+
+namespace OpenGLSomethingFrameDisplayerEVO
+{
+    class OpenGLSomethingFrameDisplayerEVO;
+}
+
+// Передаёт кадры в окно OpenGLSomethingFrameDisplayerEVO. Дисплеер
+// принадлежит вызывающему коду и должен жить дольше плеера.
+class DisplayerSink : public VideoSink
+{
+public:
+    explicit DisplayerSink(OpenGLSomethingFrameDisplayerEVO::OpenGLSomethingFrameDisplayerEVO& displayer);
+
+    void set_video_size(int width, int height) override;
+    void wait_ready() override;
+    // Дисплееру нужен RGB24; GRAY8 размножается в три канала здесь, что
+    // дешевле полного преобразования цвета в sws_scale
+    OutputFormatRequest output_formats() const override;
+    void display_frame(uint8_t* rgb, int width, int height, double pts) override;
+    void display_image(const VideoImage& image, double pts) override;
+    // Двухцветные кадры: в RGB24 для дисплея разворачиваются только
+    // изменившиеся отрезки, кадр без изменений не передаётся
+    bool accepts_bilevel() const override;
+    void display_bilevel(const BilevelFrame& frame, double pts) override;
+    // Дисплеер принимает только целые кадры, поэтому неизменившийся кадр
+    // ему просто не передаётся: на экране остаётся предыдущий
+    void display_frame_damage(uint8_t* rgb, int width, int height, double pts,
+        const FrameDamage& damage) override;
+
+private:
+    OpenGLSomethingFrameDisplayerEVO::OpenGLSomethingFrameDisplayerEVO& displayer_;
+    std::vector<uint8_t> expanded_;
+    std::vector<uint8_t> bilevel_rgb_;
+};
+
+#endif
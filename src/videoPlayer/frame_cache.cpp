@@ -0,0 +1,146 @@
+#include "frame_cache.h"
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+}
+
+FrameCache::FrameCache(size_t budget_bytes)
+    : budget_bytes_(budget_bytes)
+{
+}
+
+size_t FrameCache::frame_bytes(const VideoFrame& frame)
+{
+    return static_cast<size_t>(frame.width) * frame.height * 3 + sizeof(VideoFrame) + sizeof(Entry);
+}
+
+void FrameCache::insert(std::shared_ptr<VideoFrame> frame, int64_t previous_pts)
+{
+    if (!frame || frame->pts == AV_NOPTS_VALUE)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t pts = frame->pts;
+
+    auto it = entries_.find(pts);
+    if (it != entries_.end())
+    {
+        bytes_ -= frame_bytes(*it->second.frame);
+        it->second.frame = std::move(frame);
+        lru_.splice(lru_.end(), lru_, it->second.lru);
+    }
+    else
+    {
+        lru_.push_back(pts);
+        it = entries_.emplace(pts, Entry{std::move(frame), AV_NOPTS_VALUE, AV_NOPTS_VALUE, std::prev(lru_.end())}).first;
+    }
+    bytes_ += frame_bytes(*it->second.frame);
+    insertions_++;
+
+    // Связи проставляем с обеих сторон, если сосед уже в кэше
+    if (previous_pts != AV_NOPTS_VALUE && previous_pts < pts)
+    {
+        it->second.previous_pts = previous_pts;
+        auto previous = entries_.find(previous_pts);
+        if (previous != entries_.end())
+        {
+            previous->second.next_pts = pts;
+        }
+    }
+    auto following = std::next(it);
+    if (following != entries_.end() && following->second.previous_pts == pts)
+    {
+        it->second.next_pts = following->first;
+    }
+
+    evict_to_budget();
+}
+
+void FrameCache::evict_to_budget()
+{
+    // Только что вставленный кадр не вытесняем, даже если он один больше бюджета
+    while (bytes_ > budget_bytes_ && lru_.size() > 1)
+    {
+        auto it = entries_.find(lru_.front());
+        lru_.pop_front();
+        bytes_ -= frame_bytes(*it->second.frame);
+        entries_.erase(it);
+        evictions_++;
+    }
+}
+
+std::shared_ptr<VideoFrame> FrameCache::hit(Entry& entry)
+{
+    lru_.splice(lru_.end(), lru_, entry.lru);
+    hits_++;
+    return entry.frame;
+}
+
+std::shared_ptr<VideoFrame> FrameCache::lookup(int64_t pts)
+{
+    auto it = pts == AV_NOPTS_VALUE ? entries_.end() : entries_.find(pts);
+    if (it == entries_.end())
+    {
+        misses_++;
+        return nullptr;
+    }
+    return hit(it->second);
+}
+
+std::shared_ptr<VideoFrame> FrameCache::find(int64_t pts)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lookup(pts);
+}
+
+std::shared_ptr<VideoFrame> FrameCache::previous(int64_t pts)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(pts);
+    return lookup(it != entries_.end() ? it->second.previous_pts : AV_NOPTS_VALUE);
+}
+
+std::shared_ptr<VideoFrame> FrameCache::next(int64_t pts)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(pts);
+    return lookup(it != entries_.end() ? it->second.next_pts : AV_NOPTS_VALUE);
+}
+
+std::shared_ptr<VideoFrame> FrameCache::first_at_or_after(int64_t target)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.lower_bound(target);
+    // Без известного предыдущего кадра нельзя утверждать, что между ним
+    // и target нет кадра, которого просто нет в кэше
+    if (it == entries_.end() || (it->first != target &&
+        (it->second.previous_pts == AV_NOPTS_VALUE || it->second.previous_pts >= target)))
+    {
+        misses_++;
+        return nullptr;
+    }
+    return hit(it->second);
+}
+
+void FrameCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+    bytes_ = 0;
+}
+
+FrameCacheStats FrameCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    FrameCacheStats result;
+    result.hits = hits_;
+    result.misses = misses_;
+    result.insertions = insertions_;
+    result.evictions = evictions_;
+    result.entries = entries_.size();
+    result.bytes = bytes_;
+    result.budget_bytes = budget_bytes_;
+    return result;
+}
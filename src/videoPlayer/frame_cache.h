@@ -0,0 +1,80 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include "frame_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+struct FrameCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t insertions = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t budget_bytes = 0;
+
+    double hit_rate() const
+    {
+        uint64_t lookups = hits + misses;
+        return lookups > 0 ? static_cast<double>(hits) / lookups : 0.0;
+    }
+};
+
+// LRU-кэш сконвертированных кадров RGB24 с ключом pts (в time_base
+// видеопотока) и ограничением по памяти. Кроме кадра хранится pts
+// предыдущего декодированного кадра: по этой связи шаг назад и вперёд
+// находит соседа, не зная шага pts, а разрыв (выброшенный или
+// вытесненный кадр) честно даёт промах. Потокобезопасен.
+class FrameCache
+{
+public:
+    explicit FrameCache(size_t budget_bytes);
+
+    // previous_pts — pts кадра, декодированного перед этим (AV_NOPTS_VALUE — неизвестен)
+    void insert(std::shared_ptr<VideoFrame> frame, int64_t previous_pts);
+
+    std::shared_ptr<VideoFrame> find(int64_t pts);
+    std::shared_ptr<VideoFrame> previous(int64_t pts);
+    std::shared_ptr<VideoFrame> next(int64_t pts);
+    // Первый кадр с pts >= target, если в кэше есть и он, и связь с предыдущим
+    std::shared_ptr<VideoFrame> first_at_or_after(int64_t target);
+
+    void clear();
+    FrameCacheStats stats() const;
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<VideoFrame> frame;
+        int64_t previous_pts;
+        int64_t next_pts;
+        std::list<int64_t>::iterator lru;
+    };
+
+    static size_t frame_bytes(const VideoFrame& frame);
+
+    std::shared_ptr<VideoFrame> hit(Entry& entry);
+    std::shared_ptr<VideoFrame> lookup(int64_t pts);
+    void evict_to_budget();
+
+    mutable std::mutex mutex_;
+    // Упорядочено по pts — для поиска ближайшего кадра
+    std::map<int64_t, Entry> entries_;
+    // Начало — самый давно использованный
+    std::list<int64_t> lru_;
+    size_t budget_bytes_;
+    size_t bytes_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t insertions_ = 0;
+    uint64_t evictions_ = 0;
+};
+
+#endif
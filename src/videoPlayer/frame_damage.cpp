@@ -0,0 +1,121 @@
+#include "frame_damage.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
+namespace
+{
+    // Равны ли два отрезка строки; сравнение по 32/16 байт за шаг
+    bool spans_equal(const uint8_t* a, const uint8_t* b, size_t size)
+    {
+        size_t i = 0;
+#if defined(__AVX2__)
+        for (; i + 32 <= size; i += 32)
+        {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            if (static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y))) != 0xFFFFFFFFu)
+                return false;
+        }
+#endif
+#if defined(__SSE2__)
+        for (; i + 16 <= size; i += 16)
+        {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF)
+                return false;
+        }
+#elif defined(__ARM_NEON)
+        for (; i + 16 <= size; i += 16)
+        {
+            uint8x16_t equal = vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+            if (vminvq_u8(equal) != 0xFF)
+                return false;
+        }
+#endif
+        return std::memcmp(a + i, b + i, size - i) == 0;
+    }
+}
+
+DamageTracker::DamageTracker(int tile_size)
+{
+    damage_.tile_size = std::max(8, tile_size);
+}
+
+void DamageTracker::reset()
+{
+    width_ = 0;
+    height_ = 0;
+}
+
+const FrameDamage& DamageTracker::update(const uint8_t* rgb, int width, int height)
+{
+    const int tile = damage_.tile_size;
+    const size_t stride = static_cast<size_t>(width) * 3;
+    damage_.tiles.clear();
+
+    if (width != width_ || height != height_)
+    {
+        width_ = width;
+        height_ = height;
+        damage_.columns = (width + tile - 1) / tile;
+        damage_.rows = (height + tile - 1) / tile;
+        damage_.full = true;
+        previous_.assign(rgb, rgb + stride * height);
+        dirty_.assign(damage_.columns, 0);
+        return damage_;
+    }
+    damage_.full = false;
+
+    for (int row = 0; row < damage_.rows; row++)
+    {
+        int y0 = row * tile;
+        int y1 = std::min(height, y0 + tile);
+        std::fill(dirty_.begin(), dirty_.end(), 0);
+        int remaining = damage_.columns;
+
+        // Строка за строкой, чтобы читать память подряд; плитку, уже
+        // признанную изменённой, дальше не сравниваем
+        for (int y = y0; y < y1 && remaining > 0; y++)
+        {
+            const uint8_t* current_line = rgb + stride * y;
+            const uint8_t* previous_line = previous_.data() + stride * y;
+            for (int column = 0; column < damage_.columns; column++)
+            {
+                if (dirty_[column])
+                    continue;
+
+                size_t x0 = static_cast<size_t>(column) * tile * 3;
+                size_t span = std::min(static_cast<size_t>(tile) * 3, stride - x0);
+                if (!spans_equal(current_line + x0, previous_line + x0, span))
+                {
+                    dirty_[column] = 1;
+                    remaining--;
+                }
+            }
+        }
+
+        for (int column = 0; column < damage_.columns; column++)
+        {
+            if (!dirty_[column])
+                continue;
+
+            damage_.tiles.push_back(static_cast<uint32_t>(row * damage_.columns + column));
+            size_t x0 = static_cast<size_t>(column) * tile * 3;
+            size_t span = std::min(static_cast<size_t>(tile) * 3, stride - x0);
+            for (int y = y0; y < y1; y++)
+            {
+                std::memcpy(previous_.data() + stride * y + x0, rgb + stride * y + x0, span);
+            }
+        }
+    }
+
+    return damage_;
+}
@@ -0,0 +1,51 @@
+#ifndef FRAME_DAMAGE_H
+#define FRAME_DAMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+constexpr int DEFAULT_DAMAGE_TILE_SIZE = 64;
+
+// Какие плитки кадра RGB24 изменились с прошлого кадра. Плитка — квадрат
+// tile_size x tile_size пикселей; последние столбец и строка могут быть
+// неполными. full — изменилось всё (первый кадр, смена размера),
+// тогда tiles не заполняется.
+struct FrameDamage
+{
+    int tile_size = DEFAULT_DAMAGE_TILE_SIZE;
+    int columns = 0;
+    int rows = 0;
+    bool full = true;
+    // Номера плиток row * columns + column по возрастанию
+    std::vector<uint32_t> tiles;
+
+    bool empty() const
+    {
+        return !full && tiles.empty();
+    }
+};
+
+// Сравнивает каждый кадр с предыдущим по плиткам (SIMD) и хранит копию
+// последнего кадра. Копируются только изменившиеся плитки, поэтому на
+// почти статичном содержимом (слайды, запись экрана) проход стоит
+// примерно одного чтения двух кадров.
+class DamageTracker
+{
+public:
+    explicit DamageTracker(int tile_size = DEFAULT_DAMAGE_TILE_SIZE);
+
+    // Результат действителен до следующего вызова
+    const FrameDamage& update(const uint8_t* rgb, int width, int height);
+    // Следующий кадр будет полным
+    void reset();
+
+private:
+    FrameDamage damage_;
+    std::vector<uint8_t> previous_;
+    std::vector<uint8_t> dirty_;
+    int width_ = 0;
+    int height_ = 0;
+};
+
+#endif
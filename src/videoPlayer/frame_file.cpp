@@ -0,0 +1,416 @@
+#include "frame_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef BADPLAYER_HAVE_LZ4
+    #include <lz4.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr const char* FRAME_FILE_EXTENSION = ".bpfc";
+    // Кадры выровнены под копирование и загрузку в текстуру
+    constexpr uint64_t FRAME_ALIGN = 64;
+
+    uint64_t align_up(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    uint64_t fnv1a(const std::string& text)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (unsigned char c : text)
+        {
+            hash ^= c;
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+}
+
+bool stat_frame_file_source(const std::string& path, FrameFileSource& source)
+{
+    std::error_code error;
+    if (!fs::is_regular_file(path, error))
+        return false;
+
+    source.size = fs::file_size(path, error);
+    if (error)
+        return false;
+    auto mtime = fs::last_write_time(path, error);
+    if (error)
+        return false;
+    source.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+    return true;
+}
+
+bool frame_file_compression_available()
+{
+#ifdef BADPLAYER_HAVE_LZ4
+    return true;
+#else
+    return false;
+#endif
+}
+
+FrameFileWriter::FrameFileWriter(std::string path, const FrameFileSource& source, int width, int height,
+    bool compress, uint64_t max_bytes)
+    : path_(std::move(path))
+    , source_(source)
+    , width_(width)
+    , height_(height)
+    , compress_(compress && frame_file_compression_available())
+    , max_bytes_(max_bytes)
+{
+}
+
+FrameFileWriter::~FrameFileWriter()
+{
+    abort();
+}
+
+bool FrameFileWriter::open()
+{
+    if (width_ <= 0 || height_ <= 0)
+        return false;
+
+    temp_path_ = path_ + ".tmp." + std::to_string(getpid()) + "." +
+        std::to_string(reinterpret_cast<uintptr_t>(this));
+    file_ = std::fopen(temp_path_.c_str(), "wb");
+    if (!file_)
+    {
+        std::cerr << "Could not create frame file " << temp_path_ << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Заголовок перезаписывается в finish(), когда известен индекс
+    FrameFileHeader header{};
+    offset_ = 0;
+    index_.clear();
+    if (!write(&header, sizeof(header)))
+    {
+        abort();
+        return false;
+    }
+    return true;
+}
+
+bool FrameFileWriter::write(const void* data, size_t size)
+{
+    if (std::fwrite(data, 1, size, file_) != size)
+    {
+        std::cerr << "Failed to write frame file " << temp_path_ << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    offset_ += size;
+    return true;
+}
+
+bool FrameFileWriter::append(const uint8_t* rgb, double pts)
+{
+    if (!file_)
+        return false;
+
+    const size_t frame_size = static_cast<size_t>(width_) * height_ * 3;
+    const uint8_t* data = rgb;
+    size_t size = frame_size;
+    uint32_t flags = 0;
+
+#ifdef BADPLAYER_HAVE_LZ4
+    if (compress_)
+    {
+        compressed_.resize(LZ4_compressBound(static_cast<int>(frame_size)));
+        int packed = LZ4_compress_default(reinterpret_cast<const char*>(rgb),
+            reinterpret_cast<char*>(compressed_.data()), static_cast<int>(frame_size),
+            static_cast<int>(compressed_.size()));
+        // Несжимаемый кадр хранится как есть и читается без копирования
+        if (packed > 0 && static_cast<size_t>(packed) < frame_size)
+        {
+            data = compressed_.data();
+            size = static_cast<size_t>(packed);
+            flags = FRAME_FILE_LZ4;
+        }
+    }
+#endif
+
+    uint64_t frame_offset = align_up(offset_, FRAME_ALIGN);
+    uint64_t index_bytes = (index_.size() + 1) * sizeof(FrameFileEntry);
+    if (frame_offset + size + index_bytes + FRAME_ALIGN > max_bytes_)
+    {
+        std::cerr << "Frame file exceeds its disk budget, not caching " << path_ << std::endl;
+        abort();
+        return false;
+    }
+
+    static const uint8_t padding[FRAME_ALIGN] = {};
+    if (!write(padding, frame_offset - offset_) || !write(data, size))
+    {
+        abort();
+        return false;
+    }
+    index_.push_back(FrameFileEntry{frame_offset, static_cast<uint32_t>(size), flags, pts});
+    return true;
+}
+
+bool FrameFileWriter::finish()
+{
+    if (!file_)
+        return false;
+    if (index_.empty())
+    {
+        abort();
+        return false;
+    }
+
+    static const uint8_t padding[alignof(FrameFileEntry)] = {};
+    FrameFileHeader header{};
+    header.magic = FRAME_FILE_MAGIC;
+    header.version = FRAME_FILE_VERSION;
+    header.width = static_cast<uint32_t>(width_);
+    header.height = static_cast<uint32_t>(height_);
+    header.source_size = source_.size;
+    header.source_mtime_ns = source_.mtime_ns;
+    header.frame_count = index_.size();
+    header.index_offset = align_up(offset_, alignof(FrameFileEntry));
+
+    bool written = write(padding, header.index_offset - offset_) &&
+        write(index_.data(), index_.size() * sizeof(FrameFileEntry)) &&
+        std::fseek(file_, 0, SEEK_SET) == 0 &&
+        write(&header, sizeof(header)) &&
+        std::fflush(file_) == 0;
+    if (!written)
+    {
+        abort();
+        return false;
+    }
+
+    std::fclose(file_);
+    file_ = nullptr;
+    if (std::rename(temp_path_.c_str(), path_.c_str()) != 0)
+    {
+        std::cerr << "Could not rename frame file to " << path_ << ": " << std::strerror(errno) << std::endl;
+        std::remove(temp_path_.c_str());
+        return false;
+    }
+    std::cout << "Frame file written: " << path_ << " (" << index_.size() << " frames, "
+        << (offset_ >> 20) << " MiB)" << std::endl;
+    return true;
+}
+
+void FrameFileWriter::abort()
+{
+    if (!file_)
+        return;
+
+    std::fclose(file_);
+    file_ = nullptr;
+    std::remove(temp_path_.c_str());
+    index_.clear();
+}
+
+FrameFileReader::~FrameFileReader()
+{
+    close();
+}
+
+bool FrameFileReader::open(const std::string& path, const FrameFileSource& source)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(FrameFileHeader))
+    {
+        // MAP_PRIVATE с записью: получатель может писать в кадр, файл не изменится
+        mapping = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+
+    if (mapping == MAP_FAILED)
+        return false;
+
+    const uint64_t size = static_cast<uint64_t>(info.st_size);
+    auto* header = static_cast<const FrameFileHeader*>(mapping);
+    bool valid = header->magic == FRAME_FILE_MAGIC && header->version == FRAME_FILE_VERSION &&
+        header->width > 0 && header->height > 0 &&
+        header->source_size == source.size && header->source_mtime_ns == source.mtime_ns &&
+        header->index_offset % alignof(FrameFileEntry) == 0 && header->index_offset <= size &&
+        header->frame_count > 0 &&
+        header->frame_count <= (size - header->index_offset) / sizeof(FrameFileEntry);
+    if (!valid)
+    {
+        munmap(mapping, info.st_size);
+        return false;
+    }
+
+    base_ = static_cast<uint8_t*>(mapping);
+    mapping_size_ = static_cast<size_t>(size);
+    header_ = header;
+    index_ = reinterpret_cast<const FrameFileEntry*>(base_ + header->index_offset);
+
+    // Кадры читаются по порядку: ядро может читать вперёд агрессивнее
+    madvise(base_, mapping_size_, MADV_SEQUENTIAL);
+    return true;
+}
+
+void FrameFileReader::close()
+{
+    if (!base_)
+        return;
+
+    munmap(base_, mapping_size_);
+    base_ = nullptr;
+    mapping_size_ = 0;
+    header_ = nullptr;
+    index_ = nullptr;
+}
+
+uint8_t* FrameFileReader::frame(size_t index, std::vector<uint8_t>& scratch) const
+{
+    if (!header_ || index >= header_->frame_count)
+        return nullptr;
+
+    const FrameFileEntry& entry = index_[index];
+    if (entry.offset > header_->index_offset || entry.size > header_->index_offset - entry.offset)
+        return nullptr;
+
+    const size_t frame_size = static_cast<size_t>(header_->width) * header_->height * 3;
+    if (!(entry.flags & FRAME_FILE_LZ4))
+    {
+        return entry.size == frame_size ? base_ + entry.offset : nullptr;
+    }
+
+#ifdef BADPLAYER_HAVE_LZ4
+    scratch.resize(frame_size);
+    int unpacked = LZ4_decompress_safe(reinterpret_cast<const char*>(base_ + entry.offset),
+        reinterpret_cast<char*>(scratch.data()), static_cast<int>(entry.size), static_cast<int>(frame_size));
+    return unpacked == static_cast<int>(frame_size) ? scratch.data() : nullptr;
+#else
+    (void)scratch;
+    return nullptr;
+#endif
+}
+
+FrameFileStore::FrameFileStore(std::string directory, uint64_t budget_bytes, bool compress)
+    : directory_(std::move(directory))
+    , budget_bytes_(budget_bytes)
+    , compress_(compress)
+{
+}
+
+std::string FrameFileStore::path_for(const std::string& source_path) const
+{
+    std::error_code error;
+    fs::path absolute = fs::absolute(source_path, error);
+    std::string key = error ? source_path : absolute.lexically_normal().string();
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(fnv1a(key)));
+    return (fs::path(directory_) / (std::string(name) + FRAME_FILE_EXTENSION)).string();
+}
+
+std::shared_ptr<FrameFileReader> FrameFileStore::open_reader(const std::string& source_path)
+{
+    FrameFileSource source;
+    if (!stat_frame_file_source(source_path, source))
+        return nullptr;
+
+    std::string path = path_for(source_path);
+    std::error_code error;
+    if (!fs::exists(path, error))
+        return nullptr;
+
+    auto reader = std::make_shared<FrameFileReader>();
+    if (!reader->open(path, source))
+    {
+        std::cout << "Frame file for " << source_path << " is stale, removing it" << std::endl;
+        fs::remove(path, error);
+        return nullptr;
+    }
+
+    // mtime файла кадров — время последнего использования для вытеснения
+    fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+    return reader;
+}
+
+std::shared_ptr<FrameFileWriter> FrameFileStore::create_writer(const std::string& source_path, int width, int height)
+{
+    FrameFileSource source;
+    if (budget_bytes_ == 0 || !stat_frame_file_source(source_path, source))
+        return nullptr;
+
+    std::error_code error;
+    fs::create_directories(directory_, error);
+    if (error)
+    {
+        std::cerr << "Could not create frame file directory " << directory_ << ": " << error.message() << std::endl;
+        return nullptr;
+    }
+
+    auto writer = std::make_shared<FrameFileWriter>(path_for(source_path), source, width, height,
+        compress_, budget_bytes_);
+    if (!writer->open())
+        return nullptr;
+    return writer;
+}
+
+void FrameFileStore::enforce_budget()
+{
+    struct Entry
+    {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type used;
+    };
+
+    std::error_code error;
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    for (const auto& item : fs::directory_iterator(directory_, error))
+    {
+        std::error_code item_error;
+        if (!item.is_regular_file(item_error) || item.path().extension() != FRAME_FILE_EXTENSION)
+            continue;
+
+        Entry entry{item.path(), item.file_size(item_error), item.last_write_time(item_error)};
+        if (item_error)
+            continue;
+        total += entry.size;
+        entries.push_back(std::move(entry));
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b)
+    {
+        return a.used < b.used;
+    });
+
+    for (const Entry& entry : entries)
+    {
+        if (total <= budget_bytes_)
+            break;
+        // Отображение уже открытого файла переживает удаление
+        if (fs::remove(entry.path, error))
+        {
+            std::cout << "Evicting frame file " << entry.path.string() << std::endl;
+            total -= entry.size;
+        }
+    }
+}
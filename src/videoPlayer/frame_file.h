@@ -0,0 +1,175 @@
+#ifndef FRAME_FILE_H
+#define FRAME_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Файл уже декодированных кадров RGB24 для повтора без демультиплексора
+// и декодера. Первый проход пишет показанные кадры по порядку, следующие
+// отображают файл через mmap и отдают кадры получателю прямо из
+// отображения (сжатые LZ4 — через распаковку в буфер).
+//
+// Раскладка: FrameFileHeader, кадры подряд, в конце индекс из
+// FrameFileEntry. Файл пишется под временным именем и переименовывается
+// только целиком, поэтому недописанный файл никогда не читается.
+// Устаревшим файл считается, если у источника сменились размер или mtime.
+
+constexpr uint64_t FRAME_FILE_MAGIC = 0x314d524643504231ull; // "1BPCFRM1"
+constexpr uint32_t FRAME_FILE_VERSION = 1;
+
+// FrameFileEntry::flags
+constexpr uint32_t FRAME_FILE_LZ4 = 1;
+
+struct FrameFileHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved;
+    // Источник на момент записи
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+    uint64_t frame_count;
+    uint64_t index_offset;
+};
+
+struct FrameFileEntry
+{
+    uint64_t offset;
+    uint32_t size;
+    uint32_t flags;
+    double pts;
+};
+
+struct FrameFileSource
+{
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+};
+
+bool stat_frame_file_source(const std::string& path, FrameFileSource& source);
+
+// Есть ли в сборке LZ4 (liblz4 найден pkg-config)
+bool frame_file_compression_available();
+
+class FrameFileWriter
+{
+public:
+    FrameFileWriter(std::string path, const FrameFileSource& source, int width, int height,
+        bool compress, uint64_t max_bytes);
+    ~FrameFileWriter();
+
+    FrameFileWriter(const FrameFileWriter&) = delete;
+    FrameFileWriter& operator=(const FrameFileWriter&) = delete;
+
+    bool open();
+    // false — запись прекращена (ошибка, превышен max_bytes или уже
+    // вызван abort); дальнейшие кадры игнорируются
+    bool append(const uint8_t* rgb, double pts);
+    // Дописывает индекс и переименовывает файл в окончательное имя
+    bool finish();
+    void abort();
+
+    bool active() const
+    {
+        return file_ != nullptr;
+    }
+
+    const std::string& path() const
+    {
+        return path_;
+    }
+
+private:
+    bool write(const void* data, size_t size);
+
+    std::string path_;
+    std::string temp_path_;
+    FrameFileSource source_;
+    int width_;
+    int height_;
+    bool compress_;
+    uint64_t max_bytes_;
+
+    std::FILE* file_ = nullptr;
+    uint64_t offset_ = 0;
+    std::vector<FrameFileEntry> index_;
+    std::vector<uint8_t> compressed_;
+};
+
+class FrameFileReader
+{
+public:
+    FrameFileReader() = default;
+    ~FrameFileReader();
+
+    FrameFileReader(const FrameFileReader&) = delete;
+    FrameFileReader& operator=(const FrameFileReader&) = delete;
+
+    // false, если файла нет, он повреждён или записан для другой версии
+    // источника
+    bool open(const std::string& path, const FrameFileSource& source);
+    void close();
+
+    int width() const
+    {
+        return header_ ? static_cast<int>(header_->width) : 0;
+    }
+
+    int height() const
+    {
+        return header_ ? static_cast<int>(header_->height) : 0;
+    }
+
+    size_t frame_count() const
+    {
+        return header_ ? static_cast<size_t>(header_->frame_count) : 0;
+    }
+
+    double pts(size_t index) const
+    {
+        return index_[index].pts;
+    }
+
+    // Кадр index в packed RGB24. Несжатый — указатель в отображение
+    // (MAP_PRIVATE: запись получателя не попадёт в файл), сжатый
+    // распаковывается в scratch. nullptr — кадр повреждён
+    uint8_t* frame(size_t index, std::vector<uint8_t>& scratch) const;
+
+private:
+    uint8_t* base_ = nullptr;
+    size_t mapping_size_ = 0;
+    const FrameFileHeader* header_ = nullptr;
+    const FrameFileEntry* index_ = nullptr;
+};
+
+// Каталог файлов кадров с общим ограничением размера. Имя файла — хэш
+// абсолютного пути источника; при превышении бюджета удаляются файлы,
+// которые дольше всех не читались (mtime обновляется при открытии)
+class FrameFileStore
+{
+public:
+    FrameFileStore(std::string directory, uint64_t budget_bytes, bool compress);
+
+    std::string path_for(const std::string& source_path) const;
+
+    // nullptr, если годного файла нет; устаревший файл удаляется
+    std::shared_ptr<FrameFileReader> open_reader(const std::string& source_path);
+    // nullptr, если источник не обычный файл или каталог недоступен
+    std::shared_ptr<FrameFileWriter> create_writer(const std::string& source_path, int width, int height);
+
+    // Удаляет самые давние файлы, пока каталог не уложится в бюджет
+    void enforce_budget();
+
+private:
+    std::string directory_;
+    uint64_t budget_bytes_;
+    bool compress_;
+};
+
+#endif
@@ -0,0 +1,344 @@
+#include "frame_navigator.h"
+#include "stage_stats.h"
+#include "thread_budget.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+extern "C"
+{
+#include <libavutil/imgutils.h>
+}
+
+namespace
+{
+    // Ближе этого к цели декодируем вперёд без перехода
+    constexpr double FORWARD_DECODE_LIMIT_SECONDS = 2.0;
+}
+
+FrameNavigator::FrameNavigator(std::shared_ptr<FrameCache> cache)
+    : cache_(std::move(cache))
+{
+}
+
+FrameNavigator::~FrameNavigator()
+{
+    close();
+}
+
+bool FrameNavigator::open(const std::string& path)
+{
+    close();
+
+    if (avformat_open_input(&format_ctx_, path.c_str(), nullptr, nullptr) != 0 ||
+        avformat_find_stream_info(format_ctx_, nullptr) < 0)
+    {
+        std::cerr << "Could not open video file: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    const AVCodec* codec = nullptr;
+    stream_index_ = av_find_best_stream(format_ctx_, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (stream_index_ < 0 || !codec)
+    {
+        std::cerr << "Could not find video stream" << std::endl;
+        close();
+        return false;
+    }
+
+    AVStream* stream = format_ctx_->streams[stream_index_];
+    codec_ctx_ = avcodec_alloc_context3(codec);
+    if (!codec_ctx_ || avcodec_parameters_to_context(codec_ctx_, stream->codecpar) < 0)
+    {
+        close();
+        return false;
+    }
+
+    codec_ctx_->thread_count = std::max(1, thread_budget().decode_threads);
+    codec_ctx_->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    if (avcodec_open2(codec_ctx_, codec, nullptr) < 0)
+    {
+        std::cerr << "Could not open video codec" << std::endl;
+        close();
+        return false;
+    }
+
+    time_base_ = stream->time_base;
+    start_pts_ = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    frame_ = av_frame_alloc();
+    packet_ = av_packet_alloc();
+    if (!frame_ || !packet_)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void FrameNavigator::close()
+{
+    current_.reset();
+    sws_freeContext(sws_ctx_);
+    sws_ctx_ = nullptr;
+    av_frame_free(&frame_);
+    av_packet_free(&packet_);
+    avcodec_free_context(&codec_ctx_);
+    avformat_close_input(&format_ctx_);
+    stream_index_ = -1;
+    decoded_pts_ = AV_NOPTS_VALUE;
+    eof_ = false;
+}
+
+int FrameNavigator::width() const
+{
+    return codec_ctx_ ? codec_ctx_->width : 0;
+}
+
+int FrameNavigator::height() const
+{
+    return codec_ctx_ ? codec_ctx_->height : 0;
+}
+
+double FrameNavigator::duration() const
+{
+    if (!format_ctx_ || format_ctx_->duration == AV_NOPTS_VALUE)
+        return 0.0;
+    return static_cast<double>(format_ctx_->duration) / AV_TIME_BASE;
+}
+
+double FrameNavigator::frame_interval() const
+{
+    if (!format_ctx_)
+        return 0.0;
+
+    AVRational rate = format_ctx_->streams[stream_index_]->avg_frame_rate;
+    return rate.num > 0 && rate.den > 0 ? av_q2d(av_inv_q(rate)) : 1.0 / 25.0;
+}
+
+std::shared_ptr<VideoFrame> FrameNavigator::convert(AVFrame* frame)
+{
+    int width = frame->width;
+    int height = frame->height;
+
+    sws_ctx_ = sws_getCachedContext(sws_ctx_, width, height, static_cast<AVPixelFormat>(frame->format),
+        width, height, AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws_ctx_)
+    {
+        std::cerr << "Failed to create sws context" << std::endl;
+        return nullptr;
+    }
+
+    auto result = std::make_shared<VideoFrame>();
+    result->data = static_cast<uint8_t*>(av_malloc(av_image_get_buffer_size(AV_PIX_FMT_RGB24, width, height, 1)));
+    if (!result->data)
+        return nullptr;
+
+    uint8_t* dst_data[4];
+    int dst_linesize[4];
+    av_image_fill_arrays(dst_data, dst_linesize, result->data, AV_PIX_FMT_RGB24, width, height, 1);
+    {
+        StageTimer timer(Stage::VideoScale);
+        sws_scale(sws_ctx_, frame->data, frame->linesize, 0, height, dst_data, dst_linesize);
+    }
+
+    result->width = width;
+    result->height = height;
+    result->pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    result->display_time = result->pts * av_q2d(time_base_);
+    return result;
+}
+
+std::shared_ptr<VideoFrame> FrameNavigator::decode_next()
+{
+    while (!eof_)
+    {
+        int ret = avcodec_receive_frame(codec_ctx_, frame_);
+        if (ret == 0)
+        {
+            auto converted = convert(frame_);
+            av_frame_unref(frame_);
+            if (!converted)
+                return nullptr;
+
+            cache_->insert(converted, decoded_pts_);
+            decoded_pts_ = converted->pts;
+            return converted;
+        }
+        if (ret != AVERROR(EAGAIN))
+        {
+            eof_ = true;
+            break;
+        }
+
+        if (av_read_frame(format_ctx_, packet_) < 0)
+        {
+            // Вытаскиваем задержанные в декодере кадры
+            avcodec_send_packet(codec_ctx_, nullptr);
+            continue;
+        }
+
+        if (packet_->stream_index == stream_index_)
+        {
+            avcodec_send_packet(codec_ctx_, packet_);
+        }
+        av_packet_unref(packet_);
+    }
+    return nullptr;
+}
+
+void FrameNavigator::reposition(int64_t pts)
+{
+    if (av_seek_frame(format_ctx_, stream_index_, pts, AVSEEK_FLAG_BACKWARD) < 0)
+    {
+        // Без индекса переход может не удаться; тогда читаем с начала
+        av_seek_frame(format_ctx_, stream_index_, start_pts_, AVSEEK_FLAG_BACKWARD);
+    }
+    avcodec_flush_buffers(codec_ctx_);
+    decoded_pts_ = AV_NOPTS_VALUE;
+    eof_ = false;
+}
+
+std::shared_ptr<VideoFrame> FrameNavigator::seek(double seconds)
+{
+    if (!format_ctx_)
+        return nullptr;
+
+    int64_t target = start_pts_ + static_cast<int64_t>(std::llround(seconds / av_q2d(time_base_)));
+    if (auto cached = cache_->first_at_or_after(target))
+    {
+        current_ = cached;
+        return current_;
+    }
+
+    bool close_ahead = decoded_pts_ != AV_NOPTS_VALUE && !eof_ && decoded_pts_ < target &&
+        (target - decoded_pts_) * av_q2d(time_base_) <= FORWARD_DECODE_LIMIT_SECONDS;
+    if (!close_ahead)
+    {
+        reposition(target);
+    }
+
+    std::shared_ptr<VideoFrame> last;
+    while (auto frame = decode_next())
+    {
+        last = frame;
+        if (frame->pts >= target)
+            break;
+    }
+    if (last)
+    {
+        current_ = last;
+    }
+    return last;
+}
+
+std::shared_ptr<VideoFrame> FrameNavigator::step_forward()
+{
+    if (!current_)
+        return seek(0.0);
+
+    if (auto cached = cache_->next(current_->pts))
+    {
+        current_ = cached;
+        return current_;
+    }
+
+    // Декодер стоит не на текущем кадре — возвращаемся к нему
+    if (decoded_pts_ == AV_NOPTS_VALUE || decoded_pts_ > current_->pts)
+    {
+        reposition(current_->pts);
+    }
+
+    while (auto frame = decode_next())
+    {
+        if (frame->pts > current_->pts)
+        {
+            current_ = frame;
+            return current_;
+        }
+    }
+    return nullptr;
+}
+
+void FrameNavigator::backfill_before(int64_t pts)
+{
+    // Ключевой кадр строго раньше pts: если pts сам ключевой, это
+    // начало предыдущего GOP, иначе — начало текущего
+    reposition(pts - 1);
+    while (auto frame = decode_next())
+    {
+        // Кадр pts тоже перекладываем: так у него появится связь с предыдущим
+        if (frame->pts >= pts)
+            break;
+    }
+}
+
+std::shared_ptr<VideoFrame> FrameNavigator::step_backward()
+{
+    if (!current_)
+        return nullptr;
+
+    if (auto cached = cache_->previous(current_->pts))
+    {
+        current_ = cached;
+        return current_;
+    }
+
+    backfill_before(current_->pts);
+    if (auto cached = cache_->previous(current_->pts))
+    {
+        current_ = cached;
+        return current_;
+    }
+    // Первый кадр файла
+    return nullptr;
+}
+
+uint64_t play_reverse(FrameNavigator& navigator, VideoSink& sink, const std::atomic<bool>& running)
+{
+    sink.set_video_size(navigator.width(), navigator.height());
+    sink.wait_ready();
+    if (!sink.start())
+    {
+        std::cerr << "Failed to start video sink" << std::endl;
+        return 0;
+    }
+
+    double interval = navigator.frame_interval();
+    auto frame = navigator.seek(navigator.duration());
+    auto deadline = std::chrono::steady_clock::now();
+    uint64_t shown = 0;
+
+    while (running && frame)
+    {
+        sink.display_frame(frame->data, frame->width, frame->height, frame->display_time);
+        shown++;
+
+        auto previous = navigator.step_backward();
+        if (!previous)
+            break;
+
+        double delay = frame->display_time - previous->display_time;
+        if (delay <= 0.0 || delay > 0.5)
+        {
+            delay = interval;
+        }
+        deadline += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(delay));
+
+        // Если догружали GOP дольше кадра, не показываем накопившееся залпом
+        auto now = std::chrono::steady_clock::now();
+        if (deadline < now)
+        {
+            deadline = now;
+        }
+        std::this_thread::sleep_until(deadline);
+        frame = previous;
+    }
+
+    sink.stop();
+    return shown;
+}
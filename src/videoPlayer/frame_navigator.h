@@ -0,0 +1,83 @@
+#ifndef FRAME_NAVIGATOR_H
+#define FRAME_NAVIGATOR_H
+
+#include "frame_cache.h"
+#include "video_sink.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+// Произвольный доступ к кадрам файла: переход к моменту, шаг на кадр
+// вперёд и назад. Кадры берутся из FrameCache (его может заполнять и
+// MediaPlayer при обычном воспроизведении); при промахе назад
+// декодируется целиком GOP перед текущим кадром — от ключевого кадра до
+// текущего, — и все его кадры попадают в кэш, так что следующие шаги
+// назад внутри этого GOP бесплатны, пока GOP помещается в бюджет кэша.
+class FrameNavigator
+{
+public:
+    explicit FrameNavigator(std::shared_ptr<FrameCache> cache);
+    ~FrameNavigator();
+
+    FrameNavigator(const FrameNavigator&) = delete;
+    FrameNavigator& operator=(const FrameNavigator&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    int width() const;
+    int height() const;
+    double duration() const;
+    // Средний интервал между кадрами, секунды
+    double frame_interval() const;
+
+    // Первый кадр с временем >= seconds (или последний кадр файла)
+    std::shared_ptr<VideoFrame> seek(double seconds);
+    // nullptr — дальше кадров нет; текущим остаётся прежний кадр
+    std::shared_ptr<VideoFrame> step_forward();
+    std::shared_ptr<VideoFrame> step_backward();
+
+    std::shared_ptr<VideoFrame> current() const
+    {
+        return current_;
+    }
+
+private:
+    // Декодирует следующий кадр в порядке показа и кладёт его в кэш
+    std::shared_ptr<VideoFrame> decode_next();
+    // Переход к ключевому кадру не позже pts; декодер сбрасывается
+    void reposition(int64_t pts);
+    // Декодирует GOP, заканчивающийся перед кадром pts, целиком в кэш
+    void backfill_before(int64_t pts);
+    std::shared_ptr<VideoFrame> convert(AVFrame* frame);
+
+    std::shared_ptr<FrameCache> cache_;
+    std::shared_ptr<VideoFrame> current_;
+
+    AVFormatContext* format_ctx_ = nullptr;
+    AVCodecContext* codec_ctx_ = nullptr;
+    SwsContext* sws_ctx_ = nullptr;
+    AVFrame* frame_ = nullptr;
+    AVPacket* packet_ = nullptr;
+    int stream_index_ = -1;
+    AVRational time_base_{0, 1};
+    int64_t start_pts_ = 0;
+
+    // pts последнего кадра, выданного декодером (AV_NOPTS_VALUE — после перехода)
+    int64_t decoded_pts_ = AV_NOPTS_VALUE;
+    bool eof_ = false;
+};
+
+// Обратное воспроизведение с конца файла в sink в темпе исходной частоты
+// кадров, пока running == true. Возвращает число показанных кадров.
+uint64_t play_reverse(FrameNavigator& navigator, VideoSink& sink, const std::atomic<bool>& running);
+
+#endif
@@ -0,0 +1,340 @@
+#include "frame_ring.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+#endif
+
+namespace
+{
+    constexpr size_t PAGE_ALIGN = 4096;
+    constexpr size_t SLOT_ALIGN = 64;
+
+    size_t align_up(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // Без FUTEX_PRIVATE_FLAG: слово лежит в памяти, общей для процессов
+    void futex_wait(std::atomic<uint32_t>& word, uint32_t expected, int timeout_ms)
+    {
+#ifdef __linux__
+        timespec timeout{timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected,
+            timeout_ms >= 0 ? &timeout : nullptr, nullptr, 0);
+#else
+        // Без futex — короткий опрос
+        if (word.load(std::memory_order_acquire) == expected)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms >= 0 ? std::min(timeout_ms, 1) : 1));
+        }
+#endif
+    }
+
+    void futex_wake_all(std::atomic<uint32_t>& word)
+    {
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+    }
+}
+
+FrameRingWriter::~FrameRingWriter()
+{
+    close();
+}
+
+bool FrameRingWriter::create(const std::string& name, int width, int height, int slot_count)
+{
+    close();
+
+    if (width <= 0 || height <= 0)
+        return false;
+    slot_count = std::clamp(slot_count, 2, static_cast<int>(FRAME_RING_MAX_SLOTS));
+
+    uint64_t frame_size = static_cast<uint64_t>(width) * height * 3;
+    size_t slots_offset = align_up(sizeof(FrameRingHeader), PAGE_ALIGN);
+    size_t slot_stride = align_up(frame_size, SLOT_ALIGN);
+    size_t mapping_size = slots_offset + slot_stride * slot_count;
+
+    // Остатки от упавшего плеера с тем же именем
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        std::cerr << "shm_open(" << name << ") failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    void* mapping = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(mapping_size)) == 0)
+    {
+        mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Failed to map frame ring " << name << ": " << std::strerror(errno) << std::endl;
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    name_ = name;
+    base_ = static_cast<uint8_t*>(mapping);
+    mapping_size_ = mapping_size;
+    header_ = new (mapping) FrameRingHeader{};
+    sequence_ = 0;
+
+    header_->version = FRAME_RING_VERSION;
+    header_->slot_count = static_cast<uint32_t>(slot_count);
+    header_->width = static_cast<uint32_t>(width);
+    header_->height = static_cast<uint32_t>(height);
+    header_->stride = static_cast<uint32_t>(width * 3);
+    header_->frame_size = frame_size;
+    header_->slots_offset = slots_offset;
+    header_->slot_stride = slot_stride;
+    // Последним: читатель проверяет magic перед остальными полями
+    std::atomic_ref<uint32_t>(header_->magic).store(FRAME_RING_MAGIC, std::memory_order_release);
+    return true;
+}
+
+void FrameRingWriter::close()
+{
+    if (!header_)
+        return;
+
+    header_->closed.store(1, std::memory_order_release);
+    header_->frame_counter.fetch_add(1, std::memory_order_seq_cst);
+    futex_wake_all(header_->frame_counter);
+
+    // Уже подключённые читатели держат своё отображение, пока не отключатся
+    munmap(base_, mapping_size_);
+    shm_unlink(name_.c_str());
+    header_ = nullptr;
+    base_ = nullptr;
+    mapping_size_ = 0;
+}
+
+int FrameRingWriter::pick_slot()
+{
+    int latest_slot = sequence_ > 0 ? static_cast<int>(header_->latest.load(std::memory_order_relaxed) & 0xFF) : -1;
+    uint64_t excluded = 0;
+
+    for (uint32_t attempt = 0; attempt < header_->slot_count; attempt++)
+    {
+        // Самый старый слот, который сейчас никто не читает
+        int best = -1;
+        uint64_t best_sequence = 0;
+        for (uint32_t i = 0; i < header_->slot_count; i++)
+        {
+            FrameRingSlot& slot = header_->slots[i];
+            if (static_cast<int>(i) == latest_slot || (excluded & (1ull << i)) ||
+                slot.readers.load(std::memory_order_relaxed) != 0)
+                continue;
+
+            uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+            if (best < 0 || sequence < best_sequence)
+            {
+                best = static_cast<int>(i);
+                best_sequence = sequence;
+            }
+        }
+        if (best < 0)
+            return -1;
+
+        // Пара с FrameRingReader::try_pin: либо мы видим закрепление,
+        // либо читатель видит BUSY и отступает
+        FrameRingSlot& slot = header_->slots[best];
+        slot.sequence.store(FRAME_RING_BUSY, std::memory_order_seq_cst);
+        if (slot.readers.load(std::memory_order_seq_cst) == 0)
+            return best;
+
+        slot.sequence.store(best_sequence, std::memory_order_release);
+        excluded |= 1ull << best;
+    }
+    return -1;
+}
+
+bool FrameRingWriter::publish(const uint8_t* rgb, int width, int height, double pts)
+{
+    if (!header_)
+        return false;
+
+    if (static_cast<uint32_t>(width) != header_->width || static_cast<uint32_t>(height) != header_->height)
+    {
+        header_->dropped_frames.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    int index = pick_slot();
+    if (index < 0)
+    {
+        header_->dropped_frames.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    FrameRingSlot& slot = header_->slots[index];
+    std::memcpy(base_ + header_->slots_offset + header_->slot_stride * index, rgb, header_->frame_size);
+    slot.pts = pts;
+
+    sequence_++;
+    slot.sequence.store(sequence_, std::memory_order_release);
+    header_->latest.store((sequence_ << 8) | static_cast<uint64_t>(index), std::memory_order_release);
+
+    header_->frame_counter.fetch_add(1, std::memory_order_seq_cst);
+    // Системный вызов только если кто-то действительно спит
+    if (header_->waiters.load(std::memory_order_seq_cst) > 0)
+    {
+        futex_wake_all(header_->frame_counter);
+    }
+    return true;
+}
+
+FrameRingReader::~FrameRingReader()
+{
+    detach();
+}
+
+bool FrameRingReader::attach(const std::string& name)
+{
+    detach();
+
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+        std::cerr << "shm_open(" << name << ") failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(FrameRingHeader))
+    {
+        mapping = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Failed to map frame ring " << name << std::endl;
+        return false;
+    }
+
+    auto* header = static_cast<FrameRingHeader*>(mapping);
+    uint32_t magic = std::atomic_ref<uint32_t>(header->magic).load(std::memory_order_acquire);
+    bool valid = magic == FRAME_RING_MAGIC && header->version == FRAME_RING_VERSION &&
+        header->slot_count <= FRAME_RING_MAX_SLOTS &&
+        header->slots_offset + header->slot_stride * header->slot_count <= static_cast<uint64_t>(info.st_size);
+    if (!valid)
+    {
+        std::cerr << "Not a compatible frame ring: " << name << std::endl;
+        munmap(mapping, info.st_size);
+        return false;
+    }
+
+    header_ = header;
+    base_ = static_cast<uint8_t*>(mapping);
+    mapping_size_ = static_cast<size_t>(info.st_size);
+    last_sequence_ = 0;
+    header_->attached.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void FrameRingReader::detach()
+{
+    if (!header_)
+        return;
+
+    header_->attached.fetch_sub(1, std::memory_order_relaxed);
+    munmap(base_, mapping_size_);
+    header_ = nullptr;
+    base_ = nullptr;
+    mapping_size_ = 0;
+}
+
+bool FrameRingReader::try_pin(FrameView& view)
+{
+    while (true)
+    {
+        uint64_t latest = header_->latest.load(std::memory_order_acquire);
+        uint64_t sequence = latest >> 8;
+        if (sequence == 0 || sequence <= last_sequence_)
+            return false;
+
+        int index = static_cast<int>(latest & 0xFF);
+        FrameRingSlot& slot = header_->slots[index];
+        slot.readers.fetch_add(1, std::memory_order_seq_cst);
+        if (slot.sequence.load(std::memory_order_seq_cst) == sequence)
+        {
+            view.rgb = base_ + header_->slots_offset + header_->slot_stride * index;
+            view.width = static_cast<int>(header_->width);
+            view.height = static_cast<int>(header_->height);
+            view.stride = static_cast<int>(header_->stride);
+            view.pts = slot.pts;
+            view.sequence = sequence;
+            view.skipped = last_sequence_ > 0 ? sequence - last_sequence_ - 1 : 0;
+            view.slot = index;
+            last_sequence_ = sequence;
+            return true;
+        }
+
+        // Писатель уже занял слот под новый кадр — значит, есть кадр новее
+        slot.readers.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+FrameRingStatus FrameRingReader::acquire(FrameView& view, int timeout_ms)
+{
+    if (!header_)
+        return FrameRingStatus::Closed;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    while (true)
+    {
+        uint32_t counter = header_->frame_counter.load(std::memory_order_acquire);
+        if (try_pin(view))
+            return FrameRingStatus::Frame;
+        if (header_->closed.load(std::memory_order_acquire))
+            return FrameRingStatus::Closed;
+
+        int wait_ms = -1;
+        if (timeout_ms >= 0)
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (remaining <= 0)
+                return FrameRingStatus::Timeout;
+            wait_ms = static_cast<int>(remaining);
+        }
+
+        // Если кадр опубликуют между чтением counter и сном, futex сразу вернётся
+        header_->waiters.fetch_add(1, std::memory_order_seq_cst);
+        futex_wait(header_->frame_counter, counter, wait_ms);
+        header_->waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void FrameRingReader::release(FrameView& view)
+{
+    if (!header_ || view.slot < 0)
+        return;
+
+    header_->slots[view.slot].readers.fetch_sub(1, std::memory_order_release);
+    view.slot = -1;
+    view.rgb = nullptr;
+}
@@ -0,0 +1,147 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Кольцо кадров RGB24 в разделяемой памяти POSIX (shm_open). Плеер —
+// единственный писатель, читателей из других процессов сколько угодно.
+//
+// Читатель не копирует кадр: он закрепляет слот (счётчик readers),
+// читает пиксели прямо из отображения и снимает закрепление. Писатель
+// никогда не ждёт читателей: он пишет в самый старый незакреплённый
+// слот, а если закреплены все — выбрасывает кадр. Медленный читатель
+// всегда берёт последний опубликованный кадр и пропускает промежуточные.
+// О новом кадре читатели узнают через futex на frame_counter.
+
+constexpr uint32_t FRAME_RING_MAGIC = 0x42504652; // "BPFR"
+constexpr uint32_t FRAME_RING_VERSION = 1;
+constexpr uint32_t FRAME_RING_MAX_SLOTS = 64;
+
+struct FrameRingSlot
+{
+    // 0 — пусто, FRAME_RING_BUSY — пишется, иначе номер кадра (с 1)
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint32_t> readers;
+    uint32_t reserved;
+    double pts;
+};
+
+struct FrameRingHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t width;
+    uint32_t height;
+    // Байт на строку в слоте (width * 3, без выравнивания)
+    uint32_t stride;
+    uint64_t frame_size;
+    // Смещения от начала отображения; данные слота i — slots_offset + i * slot_stride
+    uint64_t slots_offset;
+    uint64_t slot_stride;
+
+    // (номер кадра << 8) | слот последнего опубликованного кадра
+    std::atomic<uint64_t> latest;
+    // Слово futex: меняется при каждой публикации и при закрытии
+    std::atomic<uint32_t> frame_counter;
+    std::atomic<uint32_t> waiters;
+    std::atomic<uint32_t> closed;
+    std::atomic<uint32_t> attached;
+    std::atomic<uint64_t> dropped_frames;
+
+    FrameRingSlot slots[FRAME_RING_MAX_SLOTS];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+    "frame ring atomics must be address-free to work across processes");
+
+constexpr uint64_t FRAME_RING_BUSY = ~0ull;
+
+class FrameRingWriter
+{
+public:
+    FrameRingWriter() = default;
+    ~FrameRingWriter();
+
+    FrameRingWriter(const FrameRingWriter&) = delete;
+    FrameRingWriter& operator=(const FrameRingWriter&) = delete;
+
+    // name — имя объекта shm ("/badplayer"); существующий объект пересоздаётся
+    bool create(const std::string& name, int width, int height, int slot_count);
+    // Помечает кольцо закрытым, будит читателей и удаляет имя
+    void close();
+
+    // Копирует кадр в свободный слот и публикует его; false — кадр
+    // выброшен (все слоты закреплены читателями или размер не тот)
+    bool publish(const uint8_t* rgb, int width, int height, double pts);
+
+    uint64_t published() const
+    {
+        return sequence_;
+    }
+
+private:
+    int pick_slot();
+
+    std::string name_;
+    FrameRingHeader* header_ = nullptr;
+    uint8_t* base_ = nullptr;
+    size_t mapping_size_ = 0;
+    uint64_t sequence_ = 0;
+};
+
+// Закреплённый читателем кадр; пиксели действительны до release()
+struct FrameView
+{
+    const uint8_t* rgb = nullptr;
+    int width = 0;
+    int height = 0;
+    int stride = 0;
+    double pts = 0.0;
+    uint64_t sequence = 0;
+    // Сколько кадров пропущено с предыдущего acquire
+    uint64_t skipped = 0;
+    int slot = -1;
+};
+
+enum class FrameRingStatus
+{
+    Frame,
+    Timeout,
+    Closed
+};
+
+class FrameRingReader
+{
+public:
+    FrameRingReader() = default;
+    ~FrameRingReader();
+
+    FrameRingReader(const FrameRingReader&) = delete;
+    FrameRingReader& operator=(const FrameRingReader&) = delete;
+
+    bool attach(const std::string& name);
+    void detach();
+
+    // Ждёт кадр новее предыдущего не дольше timeout_ms (< 0 — без ограничения)
+    FrameRingStatus acquire(FrameView& view, int timeout_ms);
+    void release(FrameView& view);
+
+    const FrameRingHeader* header() const
+    {
+        return header_;
+    }
+
+private:
+    bool try_pin(FrameView& view);
+
+    FrameRingHeader* header_ = nullptr;
+    uint8_t* base_ = nullptr;
+    size_t mapping_size_ = 0;
+    uint64_t last_sequence_ = 0;
+};
+
+#endif
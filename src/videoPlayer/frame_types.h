@@ -15,6 +15,9 @@ struct AudioFrame
     int64_t pts;
     int sample_rate;
     int samples;
+    // Темп, с которым сэмплы растянуты (TimeStretch); часы переходят на
+    // него, когда кадр начинает звучать
+    double speed;
     
     AudioFrame()
         : data(nullptr)
@@ -22,6 +25,7 @@ struct AudioFrame
         , pts(0)
         , sample_rate(0)
         , samples(0)
+        , speed(1.0)
     {
     }
     
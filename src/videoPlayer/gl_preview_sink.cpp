@@ -0,0 +1,386 @@
+#include "gl_preview_sink.h"
+#include "stage_stats.h"
+
+#include <algorithm>
+#include <iostream>
+
+const char* vertex_shader_src = R"(
+#version 330 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+out vec2 TexCoord;
+void main()
+{
+    gl_Position = vec4(aPos.x, aPos.y, 0.0, 1.0);
+    TexCoord = aTexCoord;
+}
+)";
+
+const char* fragment_shader_src = R"(
+#version 330 core
+in vec2 TexCoord;
+out vec4 FragColor;
+uniform sampler2D ourTexture;
+uniform float levelScale = 1.0;
+uniform float levelOffset = 0.0;
+void main()
+{
+    vec4 color = texture(ourTexture, TexCoord);
+    FragColor = vec4(clamp(color.rgb * levelScale + levelOffset, 0.0, 1.0), color.a);
+}
+)";
+
+GLuint create_shader_program();
+
+void GlPreviewSink::set_video_size(int width, int height)
+{
+    width_ = width;
+    height_ = height;
+}
+
+bool GlPreviewSink::start()
+{
+    if (!glfwInit())
+    {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return false;
+    }
+
+    window_ = glfwCreateWindow(width_, height_, "ergtrshsegfa", nullptr, nullptr);
+
+    if (!window_)
+    {
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent(window_);
+
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK)
+    {
+        std::cerr << "Failed to initialize GLEW" << std::endl;
+        glfwDestroyWindow(window_);
+        window_ = nullptr;
+        glfwTerminate();
+        return false;
+    }
+
+    shader_program_ = create_shader_program();
+    level_scale_location_ = glGetUniformLocation(shader_program_, "levelScale");
+    level_offset_location_ = glGetUniformLocation(shader_program_, "levelOffset");
+
+    float vertices[] = {1.0f,  1.0f,  1.0f, 0.0f, 1.0f,  -1.0f, 1.0f, 1.0f,
+                       -1.0f, -1.0f, 0.0f, 1.0f, -1.0f, 1.0f,  0.0f, 0.0f};
+
+    unsigned int indices[] = {0, 1, 3, 1, 2, 3};
+
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &vbo_);
+    glGenBuffers(1, &ebo_);
+
+    glBindVertexArray(vao_);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float),
+        (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    glGenTextures(1, &texture_);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Строки RGB24 без выравнивания (см. VideoSink)
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    gray_texture_ = false;
+    limited_range_ = false;
+    texture_width_ = 0;
+    texture_height_ = 0;
+
+    glfwMakeContextCurrent(nullptr);
+    return true;
+}
+
+void GlPreviewSink::display_frame(uint8_t* rgb, int width, int height, double pts)
+{
+    glfwMakeContextCurrent(window_);
+    {
+        StageTimer timer(Stage::GlUpload);
+        glBindTexture(GL_TEXTURE_2D, texture_);
+        set_gray(false);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+        texture_width_ = width;
+        texture_height_ = height;
+    }
+    present();
+}
+
+OutputFormatRequest GlPreviewSink::output_formats() const
+{
+    return {{PixelFormat::Bgra, PixelFormat::Rgba, PixelFormat::Rgb24, PixelFormat::Gray8}, true};
+}
+
+void GlPreviewSink::display_image(const VideoImage& image, double pts)
+{
+    GLenum format = GL_RGB;
+    GLenum internal_format = GL_RGBA;
+    int bytes_per_pixel = 3;
+    switch (image.format)
+    {
+    case PixelFormat::Gray8:
+        format = GL_RED;
+        internal_format = GL_R8;
+        bytes_per_pixel = 1;
+        break;
+    case PixelFormat::Bgra:
+        format = GL_BGRA;
+        bytes_per_pixel = 4;
+        break;
+    case PixelFormat::Rgba:
+        format = GL_RGBA;
+        bytes_per_pixel = 4;
+        break;
+    case PixelFormat::Rgb24:
+        break;
+    default:
+        std::cerr << "GL preview cannot show " << pixel_format_name(image.format) << std::endl;
+        return;
+    }
+
+    glfwMakeContextCurrent(window_);
+    {
+        StageTimer timer(Stage::GlUpload);
+        glBindTexture(GL_TEXTURE_2D, texture_);
+        set_gray(image.format == PixelFormat::Gray8, image.limited_range);
+        if (image.stride[0] % bytes_per_pixel == 0)
+        {
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, image.stride[0] / bytes_per_pixel);
+            glTexImage2D(GL_TEXTURE_2D, 0, internal_format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE,
+                image.data[0]);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        }
+        else
+        {
+            // Шаг RGB24 не кратен пикселю: построчно
+            glTexImage2D(GL_TEXTURE_2D, 0, internal_format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE,
+                nullptr);
+            for (int y = 0; y < image.height; y++)
+            {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, image.width, 1, format, GL_UNSIGNED_BYTE,
+                    image.data[0] + static_cast<size_t>(image.stride[0]) * y);
+            }
+        }
+        // Частичная догрузка display_frame_damage требует текстуру GL_RGB
+        texture_width_ = 0;
+        texture_height_ = 0;
+    }
+    present();
+}
+
+void GlPreviewSink::display_frame_damage(uint8_t* rgb, int width, int height, double pts,
+    const FrameDamage& damage)
+{
+    if (damage.full || width != texture_width_ || height != texture_height_)
+    {
+        display_frame(rgb, width, height, pts);
+        return;
+    }
+
+    glfwMakeContextCurrent(window_);
+    {
+        StageTimer timer(Stage::GlUpload);
+        glBindTexture(GL_TEXTURE_2D, texture_);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+
+        const uint32_t columns = static_cast<uint32_t>(damage.columns);
+        const int tile = damage.tile_size;
+        for (size_t i = 0; i < damage.tiles.size(); i++)
+        {
+            // Соседние плитки одного ряда — одним прямоугольником
+            uint32_t first = damage.tiles[i];
+            uint32_t last = first;
+            while (i + 1 < damage.tiles.size() && damage.tiles[i + 1] == last + 1 && (last + 1) % columns != 0)
+            {
+                last = damage.tiles[++i];
+            }
+
+            int x = static_cast<int>(first % columns) * tile;
+            int y = static_cast<int>(first / columns) * tile;
+            int x_end = std::min(width, static_cast<int>(last % columns + 1) * tile);
+            int y_end = std::min(height, y + tile);
+
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, x);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, y);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, x_end - x, y_end - y, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+        }
+
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+    present();
+}
+
+bool GlPreviewSink::accepts_bilevel() const
+{
+    return true;
+}
+
+void GlPreviewSink::display_bilevel(const BilevelFrame& frame, double pts)
+{
+    const size_t width = static_cast<size_t>(frame.width);
+    if (frame.key)
+    {
+        bilevel_gray_.resize(width * frame.height);
+        for (int y = 0; y < frame.height; y++)
+        {
+            expand_bilevel(frame.bits + static_cast<size_t>(frame.row_bytes) * y, 0, frame.row_bytes,
+                frame.width, bilevel_gray_.data() + width * y, 1);
+        }
+    }
+    else
+    {
+        for (int y = frame.first_row; y <= frame.last_row; y++)
+        {
+            uint8_t* row = bilevel_gray_.data() + width * y;
+            for_each_bilevel_run(frame, y, [&](int offset, const uint8_t* data, int length)
+            {
+                expand_bilevel(data, offset, length, frame.width, row, 1);
+            });
+        }
+    }
+
+    glfwMakeContextCurrent(window_);
+    {
+        StageTimer timer(Stage::GlUpload);
+        glBindTexture(GL_TEXTURE_2D, texture_);
+        set_gray(true);
+        if (frame.key)
+        {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, frame.width, frame.height, 0, GL_RED, GL_UNSIGNED_BYTE,
+                bilevel_gray_.data());
+        }
+        else if (frame.first_row <= frame.last_row)
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, frame.first_row, frame.width,
+                frame.last_row - frame.first_row + 1, GL_RED, GL_UNSIGNED_BYTE,
+                bilevel_gray_.data() + width * frame.first_row);
+        }
+        texture_width_ = 0;
+        texture_height_ = 0;
+    }
+    present();
+}
+
+void GlPreviewSink::set_gray(bool gray, bool limited_range)
+{
+    // Яркость 16..235 растягивается на весь диапазон, как в DisplayerSink
+    bool limited = gray && limited_range;
+    if (limited != limited_range_)
+    {
+        glUseProgram(shader_program_);
+        glUniform1f(level_scale_location_, limited ? 255.0f / 219.0f : 1.0f);
+        glUniform1f(level_offset_location_, limited ? -16.0f / 219.0f : 0.0f);
+        limited_range_ = limited;
+    }
+
+    if (gray == gray_texture_)
+        return;
+
+    // Одноканальная текстура: красный канал размножается в три
+    static const GLint gray_swizzle[] = {GL_RED, GL_RED, GL_RED, GL_ONE};
+    static const GLint rgba_swizzle[] = {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA};
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, gray ? gray_swizzle : rgba_swizzle);
+    gray_texture_ = gray;
+}
+
+void GlPreviewSink::present()
+{
+    glClear(GL_COLOR_BUFFER_BIT);
+    glUseProgram(shader_program_);
+    glBindVertexArray(vao_);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+    {
+        StageTimer timer(Stage::GlSwap);
+        glfwSwapBuffers(window_);
+    }
+    glfwPollEvents();
+    glfwMakeContextCurrent(nullptr);
+}
+
+void GlPreviewSink::stop()
+{
+    if (!window_)
+        return;
+
+    glfwMakeContextCurrent(window_);
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteBuffers(1, &vbo_);
+    glDeleteBuffers(1, &ebo_);
+    glDeleteTextures(1, &texture_);
+    glDeleteProgram(shader_program_);
+
+    glfwDestroyWindow(window_);
+    window_ = nullptr;
+    glfwTerminate();
+}
+
+GLuint create_shader_program()
+{
+    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex_shader, 1, &vertex_shader_src, nullptr);
+    glCompileShader(vertex_shader);
+
+    GLint success;
+    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        char info_log[512];
+        glGetShaderInfoLog(vertex_shader, 512, nullptr, info_log);
+        std::cerr << "Vertex shader compilation failed: " << info_log << std::endl;
+    }
+
+    GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment_shader, 1, &fragment_shader_src, nullptr);
+    glCompileShader(fragment_shader);
+
+    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        char info_log[512];
+        glGetShaderInfoLog(fragment_shader, 512, nullptr, info_log);
+        std::cerr << "Fragment shader compilation failed: " << info_log
+            << std::endl;
+    }
+
+    GLuint shader_program = glCreateProgram();
+    glAttachShader(shader_program, vertex_shader);
+    glAttachShader(shader_program, fragment_shader);
+    glLinkProgram(shader_program);
+
+    glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        char info_log[512];
+        glGetProgramInfoLog(shader_program, 512, nullptr, info_log);
+        std::cerr << "Shader program linking failed: " << info_log << std::endl;
+    }
+
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    return shader_program;
+}
@@ -0,0 +1,55 @@
+#ifndef GL_PREVIEW_SINK_H
+#define GL_PREVIEW_SINK_H
+
+#include "video_sink.h"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+// Окно GLFW, в которое кадр выводится текстурой поверх полноэкранного квада.
+// Задача декодирования видео переходит между потоками пула, поэтому
+// GL-контекст делается текущим на время каждого вызова и затем отпускается.
+class GlPreviewSink : public VideoSink
+{
+public:
+    void set_video_size(int width, int height) override;
+    bool start() override;
+    // BGRA/RGBA с выровненными строками: 4-байтовые пиксели драйвер
+    // загружает без перепаковки
+    OutputFormatRequest output_formats() const override;
+    void display_frame(uint8_t* rgb, int width, int height, double pts) override;
+    void display_image(const VideoImage& image, double pts) override;
+    // Двухцветные кадры в одноканальной текстуре: догружаются только
+    // строки между первой и последней изменённой
+    bool accepts_bilevel() const override;
+    void display_bilevel(const BilevelFrame& frame, double pts) override;
+    // Догружает в текстуру только изменившиеся плитки
+    void display_frame_damage(uint8_t* rgb, int width, int height, double pts,
+        const FrameDamage& damage) override;
+    void stop() override;
+
+private:
+    void present();
+    // limited_range — яркость Gray8 в телевизионном диапазоне 16..235
+    void set_gray(bool gray, bool limited_range = false);
+
+    int width_ = 0;
+    int height_ = 0;
+    // Размер, под который выделена текстура (0 — ещё не выделена)
+    int texture_width_ = 0;
+    int texture_height_ = 0;
+    bool gray_texture_ = false;
+    bool limited_range_ = false;
+    std::vector<uint8_t> bilevel_gray_;
+
+    GLFWwindow* window_ = nullptr;
+    GLuint shader_program_ = 0;
+    GLint level_scale_location_ = -1;
+    GLint level_offset_location_ = -1;
+    GLuint vao_ = 0;
+    GLuint vbo_ = 0;
+    GLuint ebo_ = 0;
+    GLuint texture_ = 0;
+};
+
+#endif
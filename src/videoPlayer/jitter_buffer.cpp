@@ -0,0 +1,132 @@
+#include "jitter_buffer.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    // После стольких секунд игры без догрузок high снижается на 10%
+    constexpr double CALM_PERIOD_SECONDS = 30.0;
+    constexpr double GROWTH_FACTOR = 1.5;
+    constexpr double DECAY_FACTOR = 0.9;
+}
+
+JitterBuffer::JitterBuffer(const StreamingOptions& options, AudioClock& clock, bool has_video, bool has_audio)
+    : options_(options)
+    , clock_(clock)
+    , active_{has_video, has_audio}
+    , high_watermark_(options.high_watermark_seconds)
+    , state_since_(Clock::now())
+{
+    options_.low_watermark_seconds = std::max(0.0, options_.low_watermark_seconds);
+    options_.high_watermark_seconds = std::max(options_.low_watermark_seconds, options_.high_watermark_seconds);
+    options_.max_watermark_seconds = std::max(options_.high_watermark_seconds, options_.max_watermark_seconds);
+    high_watermark_ = options_.high_watermark_seconds;
+    clock_.set_paused(true);
+}
+
+double JitterBuffer::level_locked() const
+{
+    double level = -1.0;
+    for (size_t i = 0; i < static_cast<size_t>(JitterStream::Count); i++)
+    {
+        if (active_[i] && (level < 0.0 || queued_[i] < level))
+        {
+            level = queued_[i];
+        }
+    }
+    return std::max(0.0, level);
+}
+
+void JitterBuffer::set_buffering_locked(bool buffering)
+{
+    auto now = Clock::now();
+    if (buffering)
+    {
+        rebuffers_++;
+        high_watermark_ = std::min(options_.max_watermark_seconds, high_watermark_ * GROWTH_FACTOR);
+        std::cout << "Rebuffering, target " << high_watermark_ << " s" << std::endl;
+    }
+    else if (started_)
+    {
+        rebuffer_time_ += now - state_since_;
+    }
+    started_ = started_ || !buffering;
+    state_since_ = now;
+
+    clock_.set_paused(buffering);
+    buffering_.store(buffering, std::memory_order_release);
+}
+
+void JitterBuffer::add(JitterStream stream, double seconds)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_[static_cast<size_t>(stream)] += seconds;
+
+    if (buffering_)
+    {
+        // Одна очередь упёрлась в потолок, а другая почти пуста (редкие
+        // пакеты одного потока) — ждать дальше бессмысленно
+        bool overflow = queued_[static_cast<size_t>(stream)] >= 2.0 * options_.max_watermark_seconds;
+        if (level_locked() >= high_watermark_ || overflow)
+        {
+            set_buffering_locked(false);
+        }
+        return;
+    }
+
+    auto calm = std::chrono::duration<double>(Clock::now() - state_since_).count();
+    if (calm >= CALM_PERIOD_SECONDS && high_watermark_ > options_.high_watermark_seconds)
+    {
+        high_watermark_ = std::max(options_.high_watermark_seconds, high_watermark_ * DECAY_FACTOR);
+        state_since_ = Clock::now();
+    }
+}
+
+void JitterBuffer::remove(JitterStream stream, double seconds)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    double& queued = queued_[static_cast<size_t>(stream)];
+    queued = std::max(0.0, queued - seconds);
+
+    if (!buffering_ && !eof_ && level_locked() <= options_.low_watermark_seconds)
+    {
+        set_buffering_locked(true);
+    }
+}
+
+void JitterBuffer::set_eof()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    eof_ = true;
+    if (buffering_)
+    {
+        set_buffering_locked(false);
+    }
+}
+
+bool JitterBuffer::full(JitterStream stream) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Во время догрузки очередь может вырасти до потолка, иначе один
+    // поток заблокировал бы демультиплексор, пока другой не набран
+    double capacity = buffering_ ? 2.0 * options_.max_watermark_seconds : 2.0 * high_watermark_;
+    return queued_[static_cast<size_t>(stream)] >= capacity;
+}
+
+JitterStats JitterBuffer::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    JitterStats result;
+    result.buffering = buffering_;
+    result.level_seconds = level_locked();
+    result.high_watermark_seconds = high_watermark_;
+    result.rebuffers = rebuffers_;
+    auto rebuffer_time = rebuffer_time_;
+    if (buffering_ && started_)
+    {
+        rebuffer_time += Clock::now() - state_since_;
+    }
+    result.rebuffer_seconds = std::chrono::duration<double>(rebuffer_time).count();
+    return result;
+}
@@ -0,0 +1,88 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include "audio_clock.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+struct StreamingOptions
+{
+    // Ниже low во время игры — пауза и догрузка, до high — снова игра
+    double low_watermark_seconds = 0.25;
+    double high_watermark_seconds = 1.0;
+    // Потолок, до которого high растёт после каждой догрузки
+    double max_watermark_seconds = 8.0;
+    // Кольцевой буфер байтов между потоком ввода и демультиплексором
+    size_t io_buffer_bytes = 8 * 1024 * 1024;
+};
+
+enum class JitterStream
+{
+    Video,
+    Audio,
+    Count
+};
+
+struct JitterStats
+{
+    bool buffering = false;
+    double level_seconds = 0.0;
+    double high_watermark_seconds = 0.0;
+    uint64_t rebuffers = 0;
+    double rebuffer_seconds = 0.0;
+};
+
+// Буфер против неровной доставки для потоковых источников. Уровень —
+// сколько секунд пакетов лежит в очередях (минимум по видео и звуку).
+// Игра начинается, когда уровень дошёл до high; если во время игры он
+// упал до low, часы останавливаются, звук молчит, видео ждёт, пока
+// уровень снова не дойдёт до high, так что синхронизация не теряется.
+// Каждая догрузка поднимает high в полтора раза (до max), долгая
+// ровная игра понемногу возвращает его к исходному.
+class JitterBuffer
+{
+public:
+    JitterBuffer(const StreamingOptions& options, AudioClock& clock, bool has_video, bool has_audio);
+
+    // Демультиплексор положил пакет / декодер забрал пакет
+    void add(JitterStream stream, double seconds);
+    void remove(JitterStream stream, double seconds);
+    // Источник кончился: доигрываем всё без догрузок
+    void set_eof();
+
+    bool buffering() const
+    {
+        return buffering_.load(std::memory_order_acquire);
+    }
+
+    // Очередь потока заполнена — демультиплексору пора ждать
+    bool full(JitterStream stream) const;
+
+    JitterStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    double level_locked() const;
+    void set_buffering_locked(bool buffering);
+
+    StreamingOptions options_;
+    AudioClock& clock_;
+    bool active_[static_cast<size_t>(JitterStream::Count)];
+
+    mutable std::mutex mutex_;
+    double queued_[static_cast<size_t>(JitterStream::Count)] = {};
+    double high_watermark_;
+    bool eof_ = false;
+    bool started_ = false;
+    uint64_t rebuffers_ = 0;
+    Clock::duration rebuffer_time_{};
+    Clock::time_point state_since_;
+    std::atomic<bool> buffering_{true};
+};
+
+#endif
@@ -0,0 +1,438 @@
+#include "media_library.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <thread>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const char INDEX_MAGIC[] = "badplayer-media-index";
+    constexpr int INDEX_VERSION = 1;
+    constexpr size_t INDEX_FIELDS = 14;
+
+    // Один проход libavformat. probesize = 0 — настройки по умолчанию.
+    // complete — нашлось всё, ради чего полный разбор не нужен
+    bool probe_once(const std::string& path, int64_t probesize, int64_t analyze_us,
+        MediaInfo& info, bool& complete)
+    {
+        complete = false;
+        AVFormatContext* format_ctx = avformat_alloc_context();
+        if (!format_ctx)
+            return false;
+        if (probesize > 0)
+        {
+            format_ctx->probesize = probesize;
+            format_ctx->max_analyze_duration = analyze_us;
+        }
+        // При ошибке освобождает format_ctx сам
+        if (avformat_open_input(&format_ctx, path.c_str(), nullptr, nullptr) != 0)
+            return false;
+
+        bool found = avformat_find_stream_info(format_ctx, nullptr) >= 0;
+        info.container = format_ctx->iformat && format_ctx->iformat->name ? format_ctx->iformat->name : "";
+        info.duration_seconds = 0.0;
+        if (format_ctx->duration != AV_NOPTS_VALUE && format_ctx->duration > 0)
+        {
+            info.duration_seconds = static_cast<double>(format_ctx->duration) / AV_TIME_BASE;
+        }
+
+        const AVCodecParameters* video = nullptr;
+        const AVCodecParameters* audio = nullptr;
+        info.fps = 0.0;
+        for (unsigned int i = 0; i < format_ctx->nb_streams; i++)
+        {
+            const AVStream* stream = format_ctx->streams[i];
+            const AVCodecParameters* params = stream->codecpar;
+            if (info.duration_seconds <= 0.0 && stream->duration != AV_NOPTS_VALUE && stream->duration > 0)
+            {
+                info.duration_seconds = stream->duration * av_q2d(stream->time_base);
+            }
+
+            if (params->codec_type == AVMEDIA_TYPE_VIDEO && !video)
+            {
+                video = params;
+                AVRational rate = stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0 ?
+                    stream->avg_frame_rate : stream->r_frame_rate;
+                info.fps = rate.num > 0 && rate.den > 0 ? av_q2d(rate) : 0.0;
+            }
+            else if (params->codec_type == AVMEDIA_TYPE_AUDIO && !audio)
+            {
+                audio = params;
+            }
+        }
+
+        info.video_codec = video ? avcodec_get_name(video->codec_id) : "";
+        info.width = video ? video->width : 0;
+        info.height = video ? video->height : 0;
+        info.audio_codec = audio ? avcodec_get_name(audio->codec_id) : "";
+        info.audio_channels = audio ? audio->ch_layout.nb_channels : 0;
+        info.sample_rate = audio ? audio->sample_rate : 0;
+
+        complete = found && (video || audio) && info.duration_seconds > 0.0 &&
+            (!video || (video->codec_id != AV_CODEC_ID_NONE && info.width > 0 && info.height > 0)) &&
+            (!audio || (audio->codec_id != AV_CODEC_ID_NONE && info.sample_rate > 0 && info.audio_channels > 0));
+        avformat_close_input(&format_ctx);
+        return true;
+    }
+
+    bool wanted_extension(const fs::path& path, const std::vector<std::string>& extensions)
+    {
+        if (extensions.empty())
+            return true;
+
+        std::string extension = path.extension().string();
+        if (extension.size() < 2)
+            return false;
+        extension.erase(0, 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return std::find(extensions.begin(), extensions.end(), extension) != extensions.end();
+    }
+
+    // Табуляция и перевод строки в путях разделяли бы поля индекса
+    std::string escape_field(const std::string& text)
+    {
+        std::string result;
+        result.reserve(text.size());
+        for (char c : text)
+        {
+            switch (c)
+            {
+            case '\\': result += "\\\\"; break;
+            case '\t': result += "\\t"; break;
+            case '\n': result += "\\n"; break;
+            default: result += c; break;
+            }
+        }
+        return result;
+    }
+
+    std::string unescape_field(const std::string& text)
+    {
+        std::string result;
+        result.reserve(text.size());
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            if (text[i] == '\\' && i + 1 < text.size())
+            {
+                char c = text[++i];
+                result += c == 't' ? '\t' : c == 'n' ? '\n' : c;
+            }
+            else
+            {
+                result += text[i];
+            }
+        }
+        return result;
+    }
+
+    bool parse_entry(const std::string& line, MediaInfo& info)
+    {
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, '\t'))
+        {
+            fields.push_back(field);
+        }
+        if (!line.empty() && line.back() == '\t')
+        {
+            fields.emplace_back();
+        }
+        if (fields.size() != INDEX_FIELDS)
+            return false;
+
+        try
+        {
+            info.path = unescape_field(fields[0]);
+            info.size = std::stoull(fields[1]);
+            info.mtime_ns = std::stoll(fields[2]);
+            info.valid = fields[3] == "1";
+            info.full_probe = fields[4] == "1";
+            info.duration_seconds = std::stod(fields[5]);
+            info.container = fields[6];
+            info.video_codec = fields[7];
+            info.width = std::stoi(fields[8]);
+            info.height = std::stoi(fields[9]);
+            info.fps = std::stod(fields[10]);
+            info.audio_codec = fields[11];
+            info.audio_channels = std::stoi(fields[12]);
+            info.sample_rate = std::stoi(fields[13]);
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+        return !info.path.empty();
+    }
+}
+
+bool probe_media(const std::string& path, const LibraryScanOptions& options, MediaInfo& info)
+{
+    bool complete = false;
+    info.full_probe = false;
+    info.valid = probe_once(path, options.quick_probesize, options.quick_analyze_us, info, complete);
+    if (!complete)
+    {
+        // Малый probesize мог не узнать даже формат, поэтому и после
+        // неудачного открытия пробуем ещё раз полностью
+        MediaInfo full = info;
+        if (probe_once(path, 0, 0, full, complete))
+        {
+            info = std::move(full);
+            info.valid = true;
+            info.full_probe = true;
+        }
+    }
+    return info.valid;
+}
+
+MediaLibrary::MediaLibrary(std::string index_path)
+    : index_path_(std::move(index_path))
+{
+}
+
+bool MediaLibrary::load()
+{
+    entries_.clear();
+    std::ifstream in(index_path_);
+    if (!in)
+        return true;
+
+    std::string line;
+    std::string magic;
+    int version = 0;
+    if (!std::getline(in, line) || !(std::istringstream(line) >> magic >> version) ||
+        magic != INDEX_MAGIC || version != INDEX_VERSION)
+    {
+        std::cerr << "Ignoring media index of another format: " << index_path_ << std::endl;
+        return false;
+    }
+
+    size_t skipped = 0;
+    while (std::getline(in, line))
+    {
+        MediaInfo info;
+        if (parse_entry(line, info))
+        {
+            entries_[info.path] = std::move(info);
+        }
+        else
+        {
+            skipped++;
+        }
+    }
+    if (skipped > 0)
+    {
+        std::cerr << "Skipped " << skipped << " damaged lines of " << index_path_ << std::endl;
+    }
+    return true;
+}
+
+bool MediaLibrary::save() const
+{
+    std::string temp_path = index_path_ + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        if (!out)
+        {
+            std::cerr << "Could not write media index " << temp_path << std::endl;
+            return false;
+        }
+
+        out.precision(17);
+        out << INDEX_MAGIC << '\t' << INDEX_VERSION << '\n';
+        for (const auto& [path, info] : entries_)
+        {
+            out << escape_field(info.path) << '\t' << info.size << '\t' << info.mtime_ns << '\t'
+                << (info.valid ? 1 : 0) << '\t' << (info.full_probe ? 1 : 0) << '\t'
+                << info.duration_seconds << '\t' << info.container << '\t'
+                << info.video_codec << '\t' << info.width << '\t' << info.height << '\t' << info.fps << '\t'
+                << info.audio_codec << '\t' << info.audio_channels << '\t' << info.sample_rate << '\n';
+        }
+        if (!out.flush())
+        {
+            std::cerr << "Could not write media index " << temp_path << std::endl;
+            return false;
+        }
+    }
+
+    if (std::rename(temp_path.c_str(), index_path_.c_str()) != 0)
+    {
+        std::cerr << "Could not rename media index to " << index_path_ << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+LibraryScanStats MediaLibrary::scan(const std::string& root, const LibraryScanOptions& options)
+{
+    auto start = std::chrono::steady_clock::now();
+    LibraryScanStats stats;
+
+    std::error_code error;
+    fs::path base = fs::absolute(root, error).lexically_normal();
+    std::string prefix = base.string();
+    if (!prefix.empty() && prefix.back() != fs::path::preferred_separator)
+    {
+        prefix += fs::path::preferred_separator;
+    }
+
+    // Обход каталогов — в одном потоке: на нём только stat, разбор дороже
+    std::vector<MediaInfo> pending;
+    std::set<std::string> seen;
+    // Каталоги, в которые не удалось войти: их записи в индексе остаются
+    std::vector<std::string> unreadable;
+    bool walk_complete = true;
+    fs::recursive_directory_iterator it(base, fs::directory_options::skip_permission_denied, error);
+    if (error)
+    {
+        std::cerr << "Could not scan " << base.string() << ": " << error.message() << std::endl;
+        return stats;
+    }
+    for (; it != fs::recursive_directory_iterator(); it.increment(error))
+    {
+        if (error)
+        {
+            std::cerr << "Scan error under " << base.string() << ": " << error.message() << std::endl;
+            walk_complete = false;
+            break;
+        }
+
+        const fs::directory_entry& entry = *it;
+        std::error_code entry_error;
+        if (entry.is_directory(entry_error) && !entry.is_symlink(entry_error))
+        {
+            // skip_permission_denied пропустил бы такой каталог молча
+            fs::directory_iterator probe(entry.path(), entry_error);
+            if (entry_error)
+            {
+                std::cerr << "Could not enter " << entry.path().string() << ": " << entry_error.message() << std::endl;
+                unreadable.push_back(entry.path().lexically_normal().string() + fs::path::preferred_separator);
+                it.disable_recursion_pending();
+            }
+            continue;
+        }
+        if (!entry.is_regular_file(entry_error) || !wanted_extension(entry.path(), options.extensions))
+            continue;
+
+        MediaInfo info;
+        info.path = entry.path().lexically_normal().string();
+        info.size = entry.file_size(entry_error);
+        auto mtime = entry.last_write_time(entry_error);
+        if (entry_error)
+        {
+            // Файл есть, но stat не удался: прежнюю запись не трогаем
+            seen.insert(info.path);
+            continue;
+        }
+        info.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+
+        stats.files++;
+        seen.insert(info.path);
+        auto known = entries_.find(info.path);
+        if (known != entries_.end() && known->second.size == info.size && known->second.mtime_ns == info.mtime_ns)
+        {
+            stats.unchanged++;
+            continue;
+        }
+        pending.push_back(std::move(info));
+    }
+
+    // Неполный обход ничего не доказывает об исчезнувших файлах
+    auto under_unreadable = [&unreadable](const std::string& path)
+    {
+        return std::any_of(unreadable.begin(), unreadable.end(), [&path](const std::string& dir)
+        {
+            return path.compare(0, dir.size(), dir) == 0;
+        });
+    };
+    for (auto entry = entries_.lower_bound(prefix); walk_complete && entry != entries_.end() &&
+        entry->first.compare(0, prefix.size(), prefix) == 0;)
+    {
+        if (seen.count(entry->first) == 0 && !under_unreadable(entry->first))
+        {
+            entry = entries_.erase(entry);
+            stats.removed++;
+        }
+        else
+        {
+            ++entry;
+        }
+    }
+
+    int workers = options.workers > 0 ? options.workers
+                                      : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    workers = static_cast<int>(std::min<size_t>(workers, std::max<size_t>(pending.size(), 1)));
+    stats.workers = workers;
+
+    // Каждый поток берёт следующий файл и пишет только в свою запись
+    std::atomic<size_t> next{0};
+    auto worker = [&]()
+    {
+        size_t index;
+        while ((index = next.fetch_add(1)) < pending.size())
+        {
+            MediaInfo& info = pending[index];
+            probe_media(info.path, options, info);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workers; i++)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (MediaInfo& info : pending)
+    {
+        stats.probed++;
+        stats.full_probes += info.full_probe ? 1 : 0;
+        stats.failed += info.valid ? 0 : 1;
+        std::string path = info.path;
+        entries_[path] = std::move(info);
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+const MediaInfo* MediaLibrary::find(const std::string& path) const
+{
+    auto entry = entries_.find(path);
+    return entry != entries_.end() ? &entry->second : nullptr;
+}
+
+std::vector<MediaInfo> MediaLibrary::entries() const
+{
+    std::vector<MediaInfo> result;
+    result.reserve(entries_.size());
+    for (const auto& [path, info] : entries_)
+    {
+        result.push_back(info);
+    }
+    return result;
+}
@@ -0,0 +1,95 @@
+#ifndef MEDIA_LIBRARY_H
+#define MEDIA_LIBRARY_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Сведения о файле из avformat_find_stream_info
+struct MediaInfo
+{
+    std::string path;
+    // По размеру и времени изменения решаем, разбирать ли файл заново
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    // false — libavformat файл не открыл; такие тоже хранятся, чтобы не
+    // пробовать их снова, пока файл не изменится
+    bool valid = false;
+    // Быстрого разбора не хватило, понадобился полный
+    bool full_probe = false;
+    double duration_seconds = 0.0;
+    std::string container;
+    std::string video_codec;
+    int width = 0;
+    int height = 0;
+    double fps = 0.0;
+    std::string audio_codec;
+    int audio_channels = 0;
+    int sample_rate = 0;
+};
+
+struct LibraryScanOptions
+{
+    // Рабочие потоки разбора; 0 — по числу логических CPU
+    int workers = 0;
+    // Быстрый разбор читает не больше quick_probesize байтов и
+    // quick_analyze_us микросекунд потока. Полный, с настройками
+    // libavformat по умолчанию, — только если быстрый не нашёл
+    // длительность, размер кадра или параметры звука
+    int64_t quick_probesize = 256 * 1024;
+    int64_t quick_analyze_us = 500000;
+    // Разбираются только файлы с этими расширениями (без точки, в нижнем
+    // регистре); пусто — все файлы
+    std::vector<std::string> extensions = {"mp4", "m4v", "mkv", "webm", "mov", "avi", "wmv", "flv",
+        "mpg", "mpeg", "ts", "m2ts", "3gp", "ogv", "ogg", "mp3", "m4a", "aac", "flac", "wav", "opus"};
+};
+
+struct LibraryScanStats
+{
+    // Найдено файлов, из них разобрано заново и взято из индекса
+    size_t files = 0;
+    size_t probed = 0;
+    size_t unchanged = 0;
+    size_t full_probes = 0;
+    size_t failed = 0;
+    // Записи индекса под корнем обхода, файлов которых больше нет
+    size_t removed = 0;
+    int workers = 0;
+    double seconds = 0.0;
+
+    double files_per_second() const
+    {
+        return seconds > 0.0 ? files / seconds : 0.0;
+    }
+};
+
+// Разбирает один файл: сначала быстро, при нехватке сведений — полностью
+bool probe_media(const std::string& path, const LibraryScanOptions& options, MediaInfo& info);
+
+// Индекс метаданных медиатеки в текстовом файле. scan() обходит дерево
+// каталогов и разбирает на пуле из options.workers потоков только новые
+// и изменившиеся (по размеру и mtime) файлы; остальное берётся из
+// индекса. Записи вне корня обхода не трогаются, так что один индекс
+// может покрывать несколько каталогов
+class MediaLibrary
+{
+public:
+    explicit MediaLibrary(std::string index_path);
+
+    // Отсутствующий индекс — не ошибка: библиотека просто пуста
+    bool load();
+    // Через временный файл и rename, чтобы прерванная запись не портила индекс
+    bool save() const;
+
+    LibraryScanStats scan(const std::string& root, const LibraryScanOptions& options = {});
+
+    const MediaInfo* find(const std::string& path) const;
+    std::vector<MediaInfo> entries() const;
+
+private:
+    std::string index_path_;
+    std::map<std::string, MediaInfo> entries_;
+};
+
+#endif
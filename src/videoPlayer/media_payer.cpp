@@ -4,7 +4,12 @@
 #include "demuxer.h"
 #include "audio_decoder.h"
 #include "video_decoder.h"
+#include "metrics_server.h"
+#include "gl_preview_sink.h"
+#include "thread_budget.h"
+#include "time_stretch.h"
 
+#include <algorithm>
 #include <iostream>
 #include <thread>
 
@@ -14,8 +19,6 @@ extern "C"
 #include <libavcodec/avcodec.h>
 }
 
-#include <Globals.h>
-
 struct MediaPlayer::Impl
 {
     AVFormatContext* format_ctx = nullptr;
@@ -29,12 +32,26 @@ struct MediaPlayer::Impl
     AVRational audio_time_base;
     
     std::shared_ptr<SharedData> shared_data;
+    PlayerConfig config;
+    std::string video_path;
+    // Готовый файл кадров: видео показывается из него без декодера
+    std::shared_ptr<FrameFileReader> frame_file;
+    MetricsServer metrics_server;
+    std::shared_ptr<VideoSink> video_sink;
+    std::unique_ptr<AudioOutput> audio_output;
+    
+    std::shared_ptr<TaskScheduler> scheduler;
+    TaskGroup video_task;
+    TaskGroup other_tasks;
     
-    std::thread demuxer_thread;
-    std::thread video_thread;
-    std::thread audio_thread;
+    // Замеры процесса на start() и в конце wait()
+    CpuUsage usage_start;
+    CpuUsage usage_end;
     
     bool audio_initialized = false;
+    bool audio_decoding = false;
+    bool prerolled = false;
+    bool started = false;
 };
 
 MediaPlayer::MediaPlayer()
@@ -50,8 +67,70 @@ MediaPlayer::~MediaPlayer()
     avformat_network_deinit();
 }
 
-bool MediaPlayer::initialize(const std::string& video_path)
+bool MediaPlayer::initialize(const std::string& video_path, const PlayerConfig& config)
 {
+    impl_->config = config;
+    impl_->video_path = video_path;
+    impl_->shared_data->frame_cache = config.frame_cache;
+    impl_->shared_data->damage_tile_size = config.damage_tile_size;
+    impl_->shared_data->monochrome = config.monochrome;
+    impl_->shared_data->bilevel_threshold = config.bilevel_threshold;
+    impl_->shared_data->loop = config.loop;
+    impl_->shared_data->loop_cache_bytes = config.loop_cache_bytes;
+    impl_->shared_data->power_save = config.power_save;
+    // Не меньше двух пачек режима экономии: иначе refill_mark уходит в минус
+    impl_->shared_data->MAX_PACKET_QUEUE_SIZE = std::max(config.packet_queue_size,
+        2 * impl_->shared_data->POWER_SAVE_PACKET_BATCH);
+    if (config.power_save)
+    {
+        // До создания пула и устройства звука: их потоки наследуют допуск
+        set_timer_slack(POWER_SAVE_TIMER_SLACK);
+    }
+    impl_->scheduler = config.scheduler;
+    if (!impl_->scheduler)
+    {
+        impl_->scheduler = std::make_shared<TaskScheduler>(DEFAULT_PIPELINE_THREADS);
+    }
+    
+    bool streaming = config.streaming == StreamingMode::On ||
+        (config.streaming == StreamingMode::Auto && StreamSource::is_stream_url(video_path));
+    if (streaming)
+    {
+        auto source = std::make_shared<StreamSource>(config.stream_options.io_buffer_bytes);
+        if (!source->open(video_path))
+        {
+            return false;
+        }
+        
+        impl_->format_ctx = avformat_alloc_context();
+        if (!impl_->format_ctx)
+        {
+            std::cerr << "Could not allocate format context" << std::endl;
+            return false;
+        }
+        impl_->format_ctx->pb = source->avio();
+        impl_->format_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+        impl_->shared_data->stream_source = source;
+    }
+    else if (config.slow_io.enabled())
+    {
+        auto source = std::make_shared<SlowSource>(config.slow_io);
+        if (!source->open(video_path))
+        {
+            return false;
+        }
+        
+        impl_->format_ctx = avformat_alloc_context();
+        if (!impl_->format_ctx)
+        {
+            std::cerr << "Could not allocate format context" << std::endl;
+            return false;
+        }
+        impl_->format_ctx->pb = source->avio();
+        impl_->format_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+        impl_->shared_data->slow_source = source;
+    }
+    
     if (avformat_open_input(&impl_->format_ctx, video_path.c_str(), nullptr, nullptr) != 0)
     {
         std::cerr << "Could not open video file: " << video_path << std::endl;
@@ -74,7 +153,8 @@ bool MediaPlayer::initialize(const std::string& video_path)
         {
             impl_->video_stream_index = i;
         }
-        else if (codec_params->codec_type == AVMEDIA_TYPE_AUDIO && impl_->audio_stream_index == -1)
+        else if (codec_params->codec_type == AVMEDIA_TYPE_AUDIO && impl_->audio_stream_index == -1 &&
+            !config.video_only)
         {
             impl_->audio_stream_index = i;
         }
@@ -87,6 +167,39 @@ bool MediaPlayer::initialize(const std::string& video_path)
         return false;
     }
     
+    // Часы ещё не идут: сразу в начальном темпе, не дожидаясь звука
+    impl_->shared_data->external_clock = config.clock;
+    set_speed(config.speed);
+    impl_->shared_data->audio_clock.set_speed(config.speed);
+    if (config.clock && impl_->format_ctx->start_time != AV_NOPTS_VALUE)
+    {
+        impl_->shared_data->external_clock_offset = impl_->format_ctx->start_time / static_cast<double>(AV_TIME_BASE);
+    }
+    
+    if (config.frame_files && !streaming && !config.loop)
+    {
+        impl_->frame_file = config.frame_files->open_reader(video_path);
+    }
+    
+    if (impl_->frame_file)
+    {
+        std::cout << "Replaying decoded frames from " << config.frame_files->path_for(video_path) << std::endl;
+        // Демультиплексор, если он нужен звуку, не читает видео вовсе
+        impl_->format_ctx->streams[impl_->video_stream_index]->discard = AVDISCARD_ALL;
+        if (impl_->audio_stream_index != -1)
+        {
+            impl_->audio_time_base = impl_->format_ctx->streams[impl_->audio_stream_index]->time_base;
+        }
+        
+        impl_->video_sink = config.video_sink;
+        if (!impl_->video_sink)
+        {
+            impl_->video_sink = std::make_shared<GlPreviewSink>();
+        }
+        impl_->video_sink->set_video_size(impl_->frame_file->width(), impl_->frame_file->height());
+        return true;
+    }
+    
     AVCodecParameters* video_codec_params = impl_->format_ctx->streams[impl_->video_stream_index]->codecpar;
     const AVCodec* video_codec = avcodec_find_decoder(video_codec_params->codec_id);
     
@@ -114,6 +227,9 @@ bool MediaPlayer::initialize(const std::string& video_path)
         return false;
     }
     
+    impl_->video_codec_ctx->thread_count = std::max(1, config.decode_threads);
+    impl_->video_codec_ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    
     if (avcodec_open2(impl_->video_codec_ctx, video_codec, nullptr) < 0)
     {
         std::cerr << "Could not open video codec" << std::endl;
@@ -129,47 +245,125 @@ bool MediaPlayer::initialize(const std::string& video_path)
         impl_->audio_time_base = impl_->format_ctx->streams[impl_->audio_stream_index]->time_base;
     }
     
-    GLobal::frameDisplayer->SetVideoSize(impl_->video_codec_ctx->width, impl_->video_codec_ctx->height);
+    if (impl_->shared_data->stream_source)
+    {
+        impl_->shared_data->jitter = std::make_shared<JitterBuffer>(config.stream_options,
+            impl_->shared_data->audio_clock, true, impl_->audio_stream_index != -1);
+    }
+    
+    impl_->video_sink = config.video_sink;
+    if (!impl_->video_sink)
+    {
+        impl_->video_sink = std::make_shared<GlPreviewSink>();
+    }
+    
+    impl_->video_sink->set_video_size(impl_->video_codec_ctx->width, impl_->video_codec_ctx->height);
     return true;
 }
 
 void MediaPlayer::run()
 {
-    GLobal::frameDisplayer->WaitForGameInit();
+    start();
+    wait();
+}
 
+void MediaPlayer::preroll()
+{
+    if (impl_->prerolled || impl_->started)
+        return;
     
-    uint8_t*  blackFrame [480*360*3];
-    memset(blackFrame, 255, sizeof(blackFrame)); 
-    auto temp = &blackFrame;
-    GLobal::frameDisplayer->DisplayFrame((uint8_t**)&temp);   
-    std::this_thread::sleep_for(std::chrono::milliseconds(25555));
+    TaskScheduler& scheduler = *impl_->scheduler;
     
-    impl_->demuxer_thread = std::thread(demuxer_thread_func, impl_->format_ctx,
-        impl_->video_stream_index, impl_->audio_stream_index,
-        impl_->video_time_base, impl_->audio_time_base, impl_->shared_data);
+    // Повтору из файла кадров без звука демультиплексор не нужен
+    if (!impl_->frame_file || impl_->audio_stream_index != -1)
+    {
+        scheduler.spawn(demux_packets(scheduler, impl_->format_ctx,
+            impl_->frame_file ? -1 : impl_->video_stream_index,
+            impl_->audio_stream_index, impl_->shared_data), impl_->other_tasks);
+    }
     
-    if (impl_->audio_stream_index != -1)
+    if (impl_->audio_stream_index != -1 &&
+        initialize_audio(impl_->format_ctx, impl_->audio_stream_index, impl_->audio_codec_ctx))
+    {
+        scheduler.spawn(decode_audio(impl_->audio_codec_ctx, impl_->audio_time_base,
+            impl_->shared_data), impl_->other_tasks);
+        impl_->audio_decoding = true;
+    }
+    impl_->prerolled = true;
+}
+
+void MediaPlayer::start()
+{
+    impl_->video_sink->wait_ready();
+    impl_->usage_start = sample_cpu_usage();
+    
+    if (impl_->config.metrics_port > 0 || impl_->config.stall_timeout_ms > 0)
     {
-        impl_->audio_initialized = initialize_audio(impl_->format_ctx, impl_->audio_stream_index,
-            impl_->audio_codec_ctx, impl_->shared_data);
+        impl_->metrics_server.start(impl_->config.metrics_port, impl_->config.stall_timeout_ms,
+            impl_->shared_data);
+    }
+    
+    // Очереди предварительно заполненного плеера уже полны, ждать не нужно
+    bool warm = impl_->prerolled;
+    preroll();
+    
+    if (impl_->audio_decoding)
+    {
+        if (impl_->config.audio_device)
+        {
+            impl_->config.audio_device->set_source(impl_->shared_data);
+            impl_->audio_initialized = true;
+        }
+        else
+        {
+            impl_->audio_output = make_audio_output(impl_->config.audio_output);
+            impl_->audio_initialized = impl_->audio_output->open(impl_->shared_data);
+            if (!impl_->audio_initialized)
+            {
+                impl_->audio_output.reset();
+            }
+        }
         
-        if (impl_->audio_initialized)
+        if (!impl_->audio_initialized)
+        {
+            // Без устройства звук не нужен: останавливаем его декодер
+            std::lock_guard<std::mutex> lock(impl_->shared_data->audio_mutex);
+            impl_->shared_data->audio_running = false;
+            impl_->shared_data->audio_cv.notify_all();
+        }
+        else if (!warm)
         {
-            impl_->audio_thread = std::thread(decode_audio, impl_->audio_codec_ctx,
-                impl_->audio_time_base, impl_->shared_data);
-            
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
     }
     
-    impl_->video_thread = std::thread(decode_video, impl_->video_codec_ctx,
-        impl_->video_time_base, impl_->shared_data);
-    
-    impl_->video_thread.join();
+    TaskScheduler& scheduler = *impl_->scheduler;
+    if (impl_->frame_file)
+    {
+        scheduler.spawn(replay_frame_file(scheduler, impl_->frame_file,
+            impl_->audio_initialized || impl_->shared_data->external_clock,
+            impl_->shared_data, impl_->video_sink), impl_->video_task);
+    }
+    else
+    {
+        if (impl_->config.frame_files && !impl_->shared_data->stream_source && !impl_->config.loop)
+        {
+            impl_->shared_data->frame_file_writer = impl_->config.frame_files->create_writer(impl_->video_path,
+                impl_->video_codec_ctx->width, impl_->video_codec_ctx->height);
+        }
+        scheduler.spawn(decode_video(scheduler, impl_->video_codec_ctx, impl_->video_time_base,
+            impl_->shared_data, impl_->video_sink), impl_->video_task);
+    }
+    impl_->started = true;
+}
+
+void MediaPlayer::wait()
+{
+    if (!impl_->started && !impl_->prerolled)
+        return;
     
-    impl_->shared_data->video_running = false;
-    impl_->shared_data->audio_running = false;
-    impl_->shared_data->demuxer_running = false;
+    impl_->video_task.wait();
+    stop();
     
     {
         std::lock_guard<std::mutex> lock(impl_->shared_data->packet_mutex);
@@ -184,32 +378,106 @@ void MediaPlayer::run()
         impl_->shared_data->packet_cv.notify_all();
     }
     
-    if (impl_->audio_thread.joinable())
+    impl_->other_tasks.wait();
+    
     {
-        impl_->audio_thread.join();
+        std::lock_guard<std::mutex> lock(impl_->shared_data->audio_mutex);
+        while (!impl_->shared_data->audio_queue.empty())
+        {
+            impl_->shared_data->audio_queue.pop();
+        }
     }
     
-    if (impl_->demuxer_thread.joinable())
+    if (impl_->shared_data->frame_file_writer)
     {
-        impl_->demuxer_thread.join();
+        impl_->shared_data->frame_file_writer.reset();
+        impl_->config.frame_files->enforce_budget();
     }
     
+    if (impl_->started)
     {
-        std::lock_guard<std::mutex> lock(impl_->shared_data->audio_mutex);
-        while (!impl_->shared_data->audio_queue.empty())
+        impl_->usage_end = sample_cpu_usage();
+        PlaybackStats result = stats();
+        std::cout << "CPU " << result.cpu_percent << "%, " << result.wakeups_per_second << " wakeups/s"
+            << (impl_->config.power_save ? " (power save)" : "") << std::endl;
+        if (impl_->shared_data->slow_source)
         {
-            impl_->shared_data->audio_queue.pop();
+            const SlowSourceStats& io = result.slow_io;
+            std::cout << "Slow I/O: " << io.reads << " reads, " << io.stalls << " stalls, "
+                << io.injected_seconds << " s injected, max read " << io.max_read_seconds * 1000.0
+                << " ms; queue refilled after " << io.recoveries << " stalls, mean "
+                << io.mean_recovery_seconds * 1000.0 << " ms, max " << io.max_recovery_seconds * 1000.0 << " ms"
+                << (io.recovering ? ", not refilled after the last one" : "") << std::endl;
         }
     }
+    
+    impl_->metrics_server.stop();
+    impl_->started = false;
+    impl_->prerolled = false;
+}
+
+void MediaPlayer::stop()
+{
+    SharedData& shared = *impl_->shared_data;
+    shared.video_running = false;
+    shared.audio_running = false;
+    shared.demuxer_running = false;
+    
+    // Будит поток чтения и демультиплексор, ждущий данных из сети
+    if (shared.stream_source)
+    {
+        shared.stream_source->interrupt();
+    }
+    if (shared.slow_source)
+    {
+        shared.slow_source->interrupt();
+    }
+    
+    // Под мьютексами, чтобы задача не проверила условие до смены флагов,
+    // а уснула уже после notify
+    {
+        std::lock_guard<std::mutex> lock(shared.packet_mutex);
+        shared.packet_cv.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lock(shared.audio_mutex);
+        shared.audio_cv.notify_all();
+    }
+}
+
+void MediaPlayer::set_speed(double speed)
+{
+    SharedData& shared = *impl_->shared_data;
+    speed = std::clamp(speed, TimeStretch::MIN_SPEED, TimeStretch::MAX_SPEED);
+    shared.playback_speed = speed;
+    // Кадры идут по общим часам: темп меняется у них для всех плееров
+    if (shared.external_clock)
+    {
+        shared.external_clock->set_speed(speed);
+    }
+    // Без звука растягивать нечего: темп сразу у часов
+    else if (impl_->audio_stream_index == -1)
+    {
+        shared.audio_clock.set_speed(speed);
+    }
 }
 
 void MediaPlayer::cleanup()
 {
-    if (impl_->audio_initialized)
+    if (impl_->started || impl_->prerolled)
     {
-        cleanup_audio();
+        stop();
+        wait();
     }
     
+    if (impl_->audio_output)
+    {
+        impl_->audio_output->close();
+        impl_->audio_output.reset();
+    }
+    impl_->audio_initialized = false;
+    impl_->audio_decoding = false;
+    
     if (impl_->audio_codec_ctx)
     {
         avcodec_free_context(&impl_->audio_codec_ctx);
@@ -224,4 +492,37 @@ void MediaPlayer::cleanup()
     {
         avformat_close_input(&impl_->format_ctx);
     }
+    
+    impl_->frame_file.reset();
+    
+    // После format_ctx: его pb принадлежит источнику
+    impl_->shared_data->jitter.reset();
+    impl_->shared_data->stream_source.reset();
+    impl_->shared_data->slow_source.reset();
+}
+
+PlaybackStats MediaPlayer::stats() const
+{
+    const PipelineMetrics& metrics = impl_->shared_data->metrics;
+    
+    PlaybackStats result;
+    result.frames_decoded = metrics.frames_decoded;
+    result.frames_displayed = metrics.frames_displayed;
+    result.frames_dropped = metrics.frames_dropped;
+    result.audio_underruns = metrics.audio_underruns;
+    result.max_abs_drift_seconds = metrics.av_drift_max_abs_seconds;
+    if (impl_->shared_data->slow_source)
+    {
+        result.slow_io = impl_->shared_data->slow_source->stats();
+    }
+    
+    // До конца wait() — по текущий момент
+    CpuUsage end = impl_->started ? sample_cpu_usage() : impl_->usage_end;
+    double seconds = std::chrono::duration<double>(end.time - impl_->usage_start.time).count();
+    if (seconds > 0.0)
+    {
+        result.cpu_percent = 100.0 * (end.cpu_seconds - impl_->usage_start.cpu_seconds) / seconds;
+        result.wakeups_per_second = (end.wakeups - impl_->usage_start.wakeups) / seconds;
+    }
+    return result;
 }
\ No newline at end of file
@@ -1,18 +1,157 @@
 #ifndef MEDIA_PLAYER_H
 #define MEDIA_PLAYER_H
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
 
+#include "audio_clock.h"
+#include "audio_output.h"
+#include "frame_cache.h"
+#include "frame_file.h"
+#include "jitter_buffer.h"
+#include "monochrome.h"
+#include "slow_source.h"
+#include "task_scheduler.h"
+#include "video_sink.h"
+
+// Столько потоков раньше занимал каждый плеер: демультиплексор и два декодера
+constexpr int DEFAULT_PIPELINE_THREADS = 3;
+// Допуск таймеров в режиме экономии (PlayerConfig::power_save): кадр
+// длится 16-40 мс, сдвиг пробуждения на 4 мс незаметен
+constexpr auto POWER_SAVE_TIMER_SLACK = std::chrono::milliseconds(4);
+
+enum class StreamingMode
+{
+    // По адресу: http://, tcp://, pipe:, "-" (stdin), именованный канал
+    Auto,
+    Off,
+    On
+};
+
+struct PlayerConfig
+{
+    // Порт HTTP с метриками Prometheus на 127.0.0.1 (0 — выключено)
+    int metrics_port = 0;
+    // Порог, после которого watchdog считает поток зависшим (0 — выключено)
+    int stall_timeout_ms = 0;
+    // thread_count видеодекодера libavcodec (см. plan_thread_budget)
+    int decode_threads = 1;
+    
+    // Куда выводить кадры; nullptr — окно превью GLFW
+    std::shared_ptr<VideoSink> video_sink;
+    AudioOutputType audio_output = AudioOutputType::Sdl;
+    // Уже открытое устройство, общее для нескольких плееров подряд
+    // (плейлист): плеер только переключает его на себя и не закрывает.
+    // nullptr — своё устройство типа audio_output
+    std::shared_ptr<AudioOutput> audio_device;
+    
+    // Не открывать звук файла вовсе (плитки видеостены)
+    bool video_only = false;
+    // Общие часы нескольких плееров: кадры каждого файла идут по ним от
+    // его начала. nullptr — по часам своего звука
+    std::shared_ptr<AudioClock> clock;
+    
+    // Темп воспроизведения 0.5..2.0; звук растягивается без изменения
+    // высоты тона (TimeStretch). Меняется на ходу через set_speed
+    double speed = 1.0;
+    
+    // Пул, на котором идут демультиплексор и декодеры. Один пул можно
+    // отдать многим плеерам; nullptr — свой пул на DEFAULT_PIPELINE_THREADS
+    std::shared_ptr<TaskScheduler> scheduler;
+    
+    // Сюда складываются показанные кадры для шага назад и повтора через
+    // FrameNavigator; nullptr — без кэша
+    std::shared_ptr<FrameCache> frame_cache;
+    
+    // Каталог файлов уже декодированных кадров. Первое воспроизведение
+    // файла записывает кадры, следующие показывают их из файла без
+    // демультиплексора (если нет звука) и видеодекодера. nullptr — выключено
+    std::shared_ptr<FrameFileStore> frame_files;
+    
+    // Повтор файла по кругу без остановки конвейера. Пакеты файла до
+    // loop_cache_bytes хранятся в памяти после первого прохода, больший
+    // файл повторяется перемоткой. Файл кадров (frame_files) при этом
+    // не используется
+    bool loop = false;
+    size_t loop_cache_bytes = 64 * 1024 * 1024;
+    
+    // Экономия энергии для безвентиляторных систем: пакеты идут декодерам
+    // пачками, звук доливается крупными порциями в буфер устройства
+    // двойного размера, а таймеры потоков плеера получают допуск, чтобы
+    // ядро объединяло пробуждения. Допуск наследуют только потоки,
+    // созданные после initialize: общий scheduler PlaylistPlayer и
+    // VideoWall создают уже с допуском, переданный сюда — настраивается
+    // отдельно
+    bool power_save = false;
+    
+    // Сравнивать каждый кадр с предыдущим плитками такого размера и
+    // передавать получателю список изменившихся (display_frame_damage).
+    // 0 — выключено: на обычном видео меняется почти всё
+    int damage_tile_size = 0;
+    
+    // Чёрно-белый источник показывается одной плоскостью яркости (GRAY8)
+    // без преобразования цвета, если получатель её принимает
+    MonochromeMode monochrome = MonochromeMode::Auto;
+    
+    // Порог яркости (1..255) для двухцветного режима: 1 бит на пиксель с
+    // дельтой к прошлому кадру через VideoSink::display_bilevel.
+    // 0 — выключено
+    int bilevel_threshold = 0;
+    
+    // Потоковый вход: байты читает отдельный поток, а воспроизведение
+    // ждёт запаса в JitterBuffer и останавливается на догрузку
+    StreamingMode streaming = StreamingMode::Auto;
+    StreamingOptions stream_options;
+    
+    // Лимит очередей пакетов демультиплексора для обычных файлов
+    size_t packet_queue_size = 100;
+    // Обычный файл читается с задержками, пределом скорости и
+    // остановками (SlowSource), чтобы подбирать packet_queue_size под
+    // медленный диск. Выключено, пока !slow_io.enabled()
+    SlowSourceOptions slow_io;
+};
+
+struct PlaybackStats
+{
+    uint64_t frames_decoded = 0;
+    uint64_t frames_displayed = 0;
+    uint64_t frames_dropped = 0;
+    uint64_t audio_underruns = 0;
+    double max_abs_drift_seconds = 0.0;
+    // По процессу целиком за время воспроизведения
+    double cpu_percent = 0.0;
+    double wakeups_per_second = 0.0;
+    // Только с PlayerConfig::slow_io
+    SlowSourceStats slow_io;
+};
+
 class MediaPlayer
 {
 public:
     MediaPlayer();
     ~MediaPlayer();
     
-    bool initialize(const std::string& video_path);
+    bool initialize(const std::string& video_path, const PlayerConfig& config = {});
+    
+    // run() = start() + wait(). start() запускает задачи и сразу возвращается,
+    // wait() ждёт конца видео и останавливает остальные стадии
     void run();
+    // Необязательный шаг перед start(): запускает демультиплексор и
+    // декодер звука, которые заполняют очереди до лимита, пока играет
+    // предыдущий файл. wait()/cleanup() без start() их останавливают
+    void preroll();
+    void start();
+    void wait();
+    // Можно вызывать из любого потока, в том числе до start()
+    void stop();
+    // Темп 0.5..2.0 на ходу, из любого потока. Звук в очереди доигрывает
+    // в прежнем темпе, часы переходят на новый вместе со звуком
+    void set_speed(double speed);
     void cleanup();
+    
+    PlaybackStats stats() const;
 
 private:
     struct Impl;
@@ -0,0 +1,337 @@
+#include "metrics_server.h"
+#include "stage_stats.h"
+
+#include <iostream>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+    const char* const thread_names[] = {
+        "demuxer",
+        "video_decode",
+        "audio_decode",
+        "audio_callback",
+    };
+
+    static_assert(sizeof(thread_names) / sizeof(thread_names[0]) == static_cast<size_t>(PipelineThread::Count),
+        "thread_names must match PipelineThread");
+
+    constexpr int POLL_INTERVAL_MS = 100;
+}
+
+const char* pipeline_thread_name(PipelineThread thread)
+{
+    return thread_names[static_cast<size_t>(thread)];
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+bool MetricsServer::start(int port, int stall_timeout_ms, std::shared_ptr<SharedData> shared)
+{
+    if (running_)
+        return true;
+
+    shared_ = std::move(shared);
+    stall_timeout_ns_ = static_cast<int64_t>(stall_timeout_ms) * 1000000;
+
+    if (port > 0)
+    {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd_ < 0)
+        {
+            std::cerr << "Could not create metrics socket" << std::endl;
+            return false;
+        }
+
+        int reuse = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            listen(listen_fd_, 8) < 0)
+        {
+            std::cerr << "Could not listen for metrics on 127.0.0.1:" << port << std::endl;
+            close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+
+        std::cout << "Metrics available at http://127.0.0.1:" << port << "/metrics" << std::endl;
+    }
+
+    running_ = true;
+    thread_ = std::thread(&MetricsServer::serve, this);
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    if (!running_)
+        return;
+
+    running_ = false;
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+
+    if (listen_fd_ >= 0)
+    {
+        close(listen_fd_);
+        listen_fd_ = -1;
+    }
+}
+
+void MetricsServer::serve()
+{
+    while (running_)
+    {
+        if (listen_fd_ >= 0)
+        {
+            pollfd pfd{listen_fd_, POLLIN, 0};
+            if (poll(&pfd, 1, POLL_INTERVAL_MS) > 0 && (pfd.revents & POLLIN))
+            {
+                int client_fd = accept(listen_fd_, nullptr, nullptr);
+                if (client_fd >= 0)
+                {
+                    handle_client(client_fd);
+                    close(client_fd);
+                }
+            }
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+        }
+
+        if (stall_timeout_ns_ > 0)
+        {
+            check_stalls();
+        }
+    }
+}
+
+void MetricsServer::handle_client(int client_fd)
+{
+    // Запрос не разбираем: на любой путь отдаём метрики. Ждём немного,
+    // чтобы клиент успел прислать заголовки, иначе curl увидит сброс соединения.
+    pollfd pfd{client_fd, POLLIN, 0};
+    if (poll(&pfd, 1, 500) > 0)
+    {
+        char request[1024];
+        (void)recv(client_fd, request, sizeof(request), 0);
+    }
+
+    std::string body = render();
+    std::ostringstream response;
+    response << "HTTP/1.0 200 OK\r\n"
+             << "Content-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << body;
+
+    std::string data = response.str();
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = send(client_fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            break;
+        sent += static_cast<size_t>(n);
+    }
+}
+
+void MetricsServer::check_stalls()
+{
+    PipelineMetrics& metrics = shared_->metrics;
+    int64_t now = PipelineMetrics::now_ns();
+    // Пока поток догружается, декодеры и звук ждут намеренно; следим
+    // только за демультиплексором
+    bool buffering = shared_->jitter && shared_->jitter->buffering();
+
+    for (size_t i = 0; i < static_cast<size_t>(PipelineThread::Count); i++)
+    {
+        ThreadHeartbeat& hb = metrics.heartbeats[i];
+        if (buffering && static_cast<PipelineThread>(i) != PipelineThread::Demuxer)
+        {
+            hb.last_progress_ns.store(now, std::memory_order_relaxed);
+        }
+        bool active = hb.active.load(std::memory_order_acquire);
+        int64_t idle_ns = now - hb.last_progress_ns.load(std::memory_order_relaxed);
+        bool stalled = active && idle_ns > stall_timeout_ns_;
+
+        if (stalled && !hb.stalled)
+        {
+            hb.stalls++;
+            std::cerr << "Watchdog: " << thread_names[i] << " made no progress for "
+                << idle_ns / 1000000 << " ms" << std::endl;
+        }
+        else if (!stalled && hb.stalled && active)
+        {
+            std::cerr << "Watchdog: " << thread_names[i] << " recovered" << std::endl;
+        }
+        hb.stalled = stalled;
+    }
+}
+
+std::string MetricsServer::render() const
+{
+    PipelineMetrics& metrics = shared_->metrics;
+
+    size_t video_packets = 0;
+    size_t audio_packets = 0;
+    size_t audio_queue = 0;
+    {
+        std::lock_guard<std::mutex> lock(shared_->packet_mutex);
+        video_packets = shared_->video_packets.size();
+        audio_packets = shared_->audio_packets.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(shared_->audio_mutex);
+        audio_queue = shared_->audio_queue.size();
+    }
+
+    std::ostringstream out;
+
+    out << "# TYPE badplayer_queue_depth gauge\n"
+        << "badplayer_queue_depth{queue=\"video_packets\"} " << video_packets << "\n"
+        << "badplayer_queue_depth{queue=\"audio_packets\"} " << audio_packets << "\n"
+        << "badplayer_queue_depth{queue=\"audio_queue\"} " << audio_queue << "\n";
+
+    out << "# TYPE badplayer_frames_decoded_total counter\n"
+        << "badplayer_frames_decoded_total " << metrics.frames_decoded.load() << "\n"
+        << "# TYPE badplayer_frames_displayed_total counter\n"
+        << "badplayer_frames_displayed_total " << metrics.frames_displayed.load() << "\n"
+        << "# TYPE badplayer_frames_dropped_total counter\n"
+        << "badplayer_frames_dropped_total " << metrics.frames_dropped.load() << "\n"
+        << "# TYPE badplayer_audio_underruns_total counter\n"
+        << "badplayer_audio_underruns_total " << metrics.audio_underruns.load() << "\n"
+        << "# TYPE badplayer_av_drift_seconds gauge\n"
+        << "badplayer_av_drift_seconds " << metrics.av_drift_seconds.load() << "\n"
+        << "# TYPE badplayer_video_fps gauge\n"
+        << "badplayer_video_fps " << metrics.video_fps.load() << "\n";
+
+    int64_t now = PipelineMetrics::now_ns();
+    out << "# TYPE badplayer_thread_active gauge\n";
+    for (size_t i = 0; i < static_cast<size_t>(PipelineThread::Count); i++)
+    {
+        out << "badplayer_thread_active{thread=\"" << thread_names[i] << "\"} "
+            << (metrics.heartbeats[i].active ? 1 : 0) << "\n";
+    }
+    out << "# TYPE badplayer_thread_idle_seconds gauge\n";
+    for (size_t i = 0; i < static_cast<size_t>(PipelineThread::Count); i++)
+    {
+        const ThreadHeartbeat& hb = metrics.heartbeats[i];
+        double idle = hb.active ? (now - hb.last_progress_ns.load()) / 1e9 : 0.0;
+        out << "badplayer_thread_idle_seconds{thread=\"" << thread_names[i] << "\"} " << idle << "\n";
+    }
+    out << "# TYPE badplayer_thread_stalled gauge\n";
+    for (size_t i = 0; i < static_cast<size_t>(PipelineThread::Count); i++)
+    {
+        out << "badplayer_thread_stalled{thread=\"" << thread_names[i] << "\"} "
+            << (metrics.heartbeats[i].stalled ? 1 : 0) << "\n";
+    }
+    out << "# TYPE badplayer_thread_stalls_total counter\n";
+    for (size_t i = 0; i < static_cast<size_t>(PipelineThread::Count); i++)
+    {
+        out << "badplayer_thread_stalls_total{thread=\"" << thread_names[i] << "\"} "
+            << metrics.heartbeats[i].stalls.load() << "\n";
+    }
+
+    if (shared_->damage_tile_size > 0)
+    {
+        out << "# TYPE badplayer_damage_tiles_total counter\n"
+            << "badplayer_damage_tiles_total " << metrics.damage_tiles_total.load() << "\n"
+            << "# TYPE badplayer_damage_tiles_dirty_total counter\n"
+            << "badplayer_damage_tiles_dirty_total " << metrics.damage_tiles_dirty.load() << "\n"
+            << "# TYPE badplayer_frames_unchanged_total counter\n"
+            << "badplayer_frames_unchanged_total " << metrics.frames_unchanged.load() << "\n";
+    }
+
+    if (shared_->bilevel_threshold > 0)
+    {
+        out << "# TYPE badplayer_bilevel_bytes_total counter\n"
+            << "badplayer_bilevel_bytes_total " << metrics.bilevel_bytes.load() << "\n";
+    }
+
+    if (shared_->loop)
+    {
+        out << "# TYPE badplayer_loops_completed_total counter\n"
+            << "badplayer_loops_completed_total " << metrics.loops_completed.load() << "\n"
+            << "# TYPE badplayer_loop_cache_bytes gauge\n"
+            << "badplayer_loop_cache_bytes " << metrics.loop_cache_bytes.load() << "\n";
+    }
+
+    if (shared_->frame_cache)
+    {
+        FrameCacheStats cache = shared_->frame_cache->stats();
+        out << "# TYPE badplayer_frame_cache_hits_total counter\n"
+            << "badplayer_frame_cache_hits_total " << cache.hits << "\n"
+            << "# TYPE badplayer_frame_cache_misses_total counter\n"
+            << "badplayer_frame_cache_misses_total " << cache.misses << "\n"
+            << "# TYPE badplayer_frame_cache_evictions_total counter\n"
+            << "badplayer_frame_cache_evictions_total " << cache.evictions << "\n"
+            << "# TYPE badplayer_frame_cache_entries gauge\n"
+            << "badplayer_frame_cache_entries " << cache.entries << "\n"
+            << "# TYPE badplayer_frame_cache_bytes gauge\n"
+            << "badplayer_frame_cache_bytes " << cache.bytes << "\n"
+            << "# TYPE badplayer_frame_cache_budget_bytes gauge\n"
+            << "badplayer_frame_cache_budget_bytes " << cache.budget_bytes << "\n";
+    }
+
+    if (shared_->jitter)
+    {
+        JitterStats jitter = shared_->jitter->stats();
+        out << "# TYPE badplayer_jitter_buffering gauge\n"
+            << "badplayer_jitter_buffering " << (jitter.buffering ? 1 : 0) << "\n"
+            << "# TYPE badplayer_jitter_level_seconds gauge\n"
+            << "badplayer_jitter_level_seconds " << jitter.level_seconds << "\n"
+            << "# TYPE badplayer_jitter_high_watermark_seconds gauge\n"
+            << "badplayer_jitter_high_watermark_seconds " << jitter.high_watermark_seconds << "\n"
+            << "# TYPE badplayer_rebuffers_total counter\n"
+            << "badplayer_rebuffers_total " << jitter.rebuffers << "\n"
+            << "# TYPE badplayer_rebuffer_seconds_total counter\n"
+            << "badplayer_rebuffer_seconds_total " << jitter.rebuffer_seconds << "\n";
+    }
+
+    if (shared_->stream_source)
+    {
+        StreamSourceStats source = shared_->stream_source->stats();
+        out << "# TYPE badplayer_stream_received_bytes_total counter\n"
+            << "badplayer_stream_received_bytes_total " << source.bytes_received << "\n"
+            << "# TYPE badplayer_stream_buffered_bytes gauge\n"
+            << "badplayer_stream_buffered_bytes " << source.bytes_buffered << "\n"
+            << "# TYPE badplayer_stream_read_stalls_total counter\n"
+            << "badplayer_stream_read_stalls_total " << source.read_stalls << "\n";
+    }
+
+    out << "# TYPE badplayer_stage_latency_seconds summary\n";
+    for (size_t i = 0; i < static_cast<size_t>(Stage::Count); i++)
+    {
+        Stage stage = static_cast<Stage>(i);
+        StageSummary s = stage_summary(stage);
+        if (s.count == 0)
+            continue;
+
+        const char* name = stage_name(stage);
+        out << "badplayer_stage_latency_seconds{stage=\"" << name << "\",quantile=\"0.5\"} " << s.p50_ns / 1e9 << "\n"
+            << "badplayer_stage_latency_seconds{stage=\"" << name << "\",quantile=\"0.99\"} " << s.p99_ns / 1e9 << "\n"
+            << "badplayer_stage_latency_seconds{stage=\"" << name << "\",quantile=\"1\"} " << s.max_ns / 1e9 << "\n"
+            << "badplayer_stage_latency_seconds_count{stage=\"" << name << "\"} " << s.count << "\n";
+    }
+
+    return out.str();
+}
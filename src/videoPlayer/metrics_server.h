@@ -0,0 +1,38 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include "shared_data.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+// HTTP на 127.0.0.1 с метриками в текстовом формате Prometheus
+// (curl http://127.0.0.1:<port>/metrics) и watchdog, который сообщает
+// о потоках конвейера, не продвигавшихся дольше stall_timeout_ms.
+class MetricsServer
+{
+public:
+    MetricsServer() = default;
+    ~MetricsServer();
+
+    // port == 0 — только watchdog, без HTTP
+    bool start(int port, int stall_timeout_ms, std::shared_ptr<SharedData> shared);
+    void stop();
+
+    std::string render() const;
+
+private:
+    void serve();
+    void check_stalls();
+    void handle_client(int client_fd);
+
+    std::shared_ptr<SharedData> shared_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    int listen_fd_ = -1;
+    int64_t stall_timeout_ns_ = 0;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "monochrome.h"
+
+#include <cstdlib>
+#include <iostream>
+
+extern "C"
+{
+#include <libavutil/pixdesc.h>
+}
+
+namespace
+{
+    // Столько чёрно-белых кадров подряд нужно, чтобы перейти на яркость
+    constexpr int PROBE_FRAMES = 5;
+    // После перехода цветность проверяется на каждом таком кадре
+    constexpr int RECHECK_INTERVAL = 30;
+    constexpr int CHROMA_TOLERANCE = 3;
+    constexpr int SAMPLE_STEP = 4;
+}
+
+bool has_luma_plane(AVPixelFormat format)
+{
+    switch (format)
+    {
+    case AV_PIX_FMT_GRAY8:
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_YUV422P:
+    case AV_PIX_FMT_YUVJ422P:
+    case AV_PIX_FMT_YUV444P:
+    case AV_PIX_FMT_YUVJ444P:
+    case AV_PIX_FMT_NV12:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool chroma_is_neutral(const AVFrame* frame, int tolerance)
+{
+    AVPixelFormat format = static_cast<AVPixelFormat>(frame->format);
+    if (format == AV_PIX_FMT_GRAY8)
+        return true;
+
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+    if (!desc || !has_luma_plane(format))
+        return false;
+
+    int chroma_width = (frame->width + (1 << desc->log2_chroma_w) - 1) >> desc->log2_chroma_w;
+    int chroma_height = (frame->height + (1 << desc->log2_chroma_h) - 1) >> desc->log2_chroma_h;
+    // NV12: U и V чередуются в одной плоскости
+    bool interleaved = desc->comp[1].plane == desc->comp[2].plane;
+    int planes = interleaved ? 1 : 2;
+    int row_bytes = interleaved ? chroma_width * 2 : chroma_width;
+    // В чередующейся плоскости шаг должен быть нечётным, иначе смотрим только U
+    int step = interleaved ? SAMPLE_STEP + 1 : SAMPLE_STEP;
+
+    for (int plane = 1; plane <= planes; plane++)
+    {
+        for (int y = 0; y < chroma_height; y += SAMPLE_STEP)
+        {
+            const uint8_t* line = frame->data[plane] + static_cast<size_t>(frame->linesize[plane]) * y;
+            for (int x = 0; x < row_bytes; x += step)
+            {
+                if (std::abs(static_cast<int>(line[x]) - 128) > tolerance)
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+MonochromeDetector::MonochromeDetector(MonochromeMode mode, AVPixelFormat format)
+    : mode_(mode)
+    , gray_source_(format == AV_PIX_FMT_GRAY8)
+{
+    if (!has_luma_plane(format))
+    {
+        mode_ = MonochromeMode::Off;
+    }
+    active_ = mode_ == MonochromeMode::On || (mode_ == MonochromeMode::Auto && gray_source_);
+}
+
+bool MonochromeDetector::observe(const AVFrame* frame)
+{
+    if (mode_ != MonochromeMode::Auto || gray_source_ || gave_up_)
+        return active_;
+
+    if (active_)
+    {
+        if (++frames_since_check_ < RECHECK_INTERVAL)
+            return true;
+        frames_since_check_ = 0;
+    }
+
+    if (chroma_is_neutral(frame, CHROMA_TOLERANCE))
+    {
+        if (!active_ && ++neutral_frames_ >= PROBE_FRAMES)
+        {
+            active_ = true;
+            std::cout << "Monochrome source detected, showing luma only" << std::endl;
+        }
+        return active_;
+    }
+
+    if (active_)
+    {
+        std::cout << "Colour appeared, back to full conversion" << std::endl;
+    }
+    active_ = false;
+    gave_up_ = true;
+    return false;
+}
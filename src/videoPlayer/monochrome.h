@@ -0,0 +1,51 @@
+#ifndef MONOCHROME_H
+#define MONOCHROME_H
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+enum class MonochromeMode
+{
+    // По цветности первых кадров
+    Auto,
+    Off,
+    // Всегда только яркость, даже если в источнике есть цвет
+    On
+};
+
+// Формат декодера, у которого яркость лежит отдельной 8-битной
+// плоскостью data[0] (серый, планарный YUV, NV12)
+bool has_luma_plane(AVPixelFormat format);
+
+// Вся ли цветность кадра около нейтральной (128 ± tolerance). Смотрится
+// каждый 4-й отсчёт каждой 4-й строки
+bool chroma_is_neutral(const AVFrame* frame, int tolerance);
+
+// Решает, выдавать ли кадры одной плоскостью яркости. В режиме Auto
+// включается после нескольких подряд чёрно-белых кадров и затем изредка
+// перепроверяет: если цвет появился, выключается до конца файла.
+class MonochromeDetector
+{
+public:
+    MonochromeDetector(MonochromeMode mode, AVPixelFormat format);
+
+    bool observe(const AVFrame* frame);
+
+    bool active() const
+    {
+        return active_;
+    }
+
+private:
+    MonochromeMode mode_;
+    bool gray_source_;
+    bool active_ = false;
+    bool gave_up_ = false;
+    int neutral_frames_ = 0;
+    int frames_since_check_ = 0;
+};
+
+#endif
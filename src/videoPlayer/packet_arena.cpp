@@ -0,0 +1,82 @@
+#include "packet_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+extern "C"
+{
+#include <libavutil/buffer.h>
+}
+
+namespace
+{
+    constexpr size_t ARENA_BLOCK_SIZE = 4 * 1024 * 1024;
+
+    void release_arena(void* opaque, uint8_t*)
+    {
+        delete static_cast<std::shared_ptr<PacketArena>*>(opaque);
+    }
+}
+
+PacketArena::PacketArena(size_t limit_bytes)
+    : limit_bytes_(limit_bytes)
+{
+}
+
+uint8_t* PacketArena::allocate(size_t size)
+{
+    if (blocks_.empty() || block_size_ - block_used_ < size)
+    {
+        // Пакет крупнее блока получает блок по своему размеру
+        block_size_ = std::max(ARENA_BLOCK_SIZE, size);
+        blocks_.push_back(std::make_unique<uint8_t[]>(block_size_));
+        block_used_ = 0;
+    }
+
+    uint8_t* data = blocks_.back().get() + block_used_;
+    // Выравнивание под SIMD-чтение битового потока
+    block_used_ += (size + 63) & ~static_cast<size_t>(63);
+    block_used_ = std::min(block_used_, block_size_);
+    return data;
+}
+
+bool PacketArena::append(const AVPacket* packet)
+{
+    size_t size = static_cast<size_t>(packet->size) + AV_INPUT_BUFFER_PADDING_SIZE;
+    if (used_bytes_ + size > limit_bytes_)
+        return false;
+
+    uint8_t* data = allocate(size);
+    std::memcpy(data, packet->data, packet->size);
+    std::memset(data + packet->size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    used_bytes_ += size;
+
+    entries_.push_back(Entry{data, packet->size, packet->stream_index, packet->flags,
+        packet->pts, packet->dts, packet->duration});
+    return true;
+}
+
+bool PacketArena::fill(size_t index, AVPacket* packet)
+{
+    if (index >= entries_.size())
+        return false;
+
+    const Entry& entry = entries_[index];
+    auto* owner = new std::shared_ptr<PacketArena>(shared_from_this());
+    packet->buf = av_buffer_create(entry.data, static_cast<size_t>(entry.size) + AV_INPUT_BUFFER_PADDING_SIZE,
+        release_arena, owner, AV_BUFFER_FLAG_READONLY);
+    if (!packet->buf)
+    {
+        delete owner;
+        return false;
+    }
+
+    packet->data = entry.data;
+    packet->size = entry.size;
+    packet->stream_index = entry.stream_index;
+    packet->flags = entry.flags;
+    packet->pts = entry.pts;
+    packet->dts = entry.dts;
+    packet->duration = entry.duration;
+    return true;
+}
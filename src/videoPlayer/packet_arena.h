@@ -0,0 +1,67 @@
+#ifndef PACKET_ARENA_H
+#define PACKET_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+// Сжатые пакеты короткого файла в памяти для повтора по кругу. Данные
+// лежат подряд в крупных блоках (с нулевым хвостом
+// AV_INPUT_BUFFER_PADDING_SIZE, которого ждут декодеры), а пакеты при
+// повторе ссылаются на них через AVBufferRef без копирования.
+//
+// Побочные данные пакетов не сохраняются: новые параметры кодека
+// посреди короткого файла на практике не встречаются.
+class PacketArena : public std::enable_shared_from_this<PacketArena>
+{
+public:
+    explicit PacketArena(size_t limit_bytes);
+
+    PacketArena(const PacketArena&) = delete;
+    PacketArena& operator=(const PacketArena&) = delete;
+
+    // false — пакет не поместился в limit_bytes; арена тогда бесполезна
+    bool append(const AVPacket* packet);
+    // Пакет index в packet (предварительно пустой). Буфер держит арену,
+    // пока декодер не отпустит пакет
+    bool fill(size_t index, AVPacket* packet);
+
+    size_t size() const
+    {
+        return entries_.size();
+    }
+
+    size_t bytes() const
+    {
+        return used_bytes_;
+    }
+
+private:
+    struct Entry
+    {
+        uint8_t* data;
+        int size;
+        int stream_index;
+        int flags;
+        int64_t pts;
+        int64_t dts;
+        int64_t duration;
+    };
+
+    uint8_t* allocate(size_t size);
+
+    size_t limit_bytes_;
+    size_t used_bytes_ = 0;
+    std::vector<std::unique_ptr<uint8_t[]>> blocks_;
+    size_t block_used_ = 0;
+    size_t block_size_ = 0;
+    std::vector<Entry> entries_;
+};
+
+#endif
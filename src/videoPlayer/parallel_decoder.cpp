@@ -0,0 +1,414 @@
+#include "parallel_decoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+
+namespace
+{
+    // Диапазон набирается из целых GOP, пока в нём меньше стольких
+    // пакетов: короткие GOP иначе тратили бы время на переходы
+    constexpr size_t MIN_RANGE_PACKETS = 48;
+
+    struct GopRange
+    {
+        // Ключевой кадр, с которого начинается диапазон
+        int64_t start_pts;
+        int64_t start_dts;
+        // pts ключевого кадра следующего диапазона (INT64_MAX у последнего)
+        int64_t end_pts;
+    };
+
+    int64_t packet_time(const AVPacket* packet)
+    {
+        return packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    }
+
+    bool open_video(const std::string& path, AVFormatContext*& format_ctx, int& stream_index,
+        const AVCodec** codec)
+    {
+        if (avformat_open_input(&format_ctx, path.c_str(), nullptr, nullptr) != 0 ||
+            avformat_find_stream_info(format_ctx, nullptr) < 0)
+        {
+            std::cerr << "Could not open video file: " << path << std::endl;
+            return false;
+        }
+
+        stream_index = av_find_best_stream(format_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, codec, 0);
+        if (stream_index < 0 || !*codec)
+        {
+            std::cerr << "Could not find video stream" << std::endl;
+            return false;
+        }
+
+        // Остальные потоки демультиплексор пропускает, не разбирая
+        for (unsigned int i = 0; i < format_ctx->nb_streams; i++)
+        {
+            if (static_cast<int>(i) != stream_index)
+            {
+                format_ctx->streams[i]->discard = AVDISCARD_ALL;
+            }
+        }
+        return true;
+    }
+
+    // Один проход демультиплексора без декодирования: ключевые кадры и
+    // число пакетов между ними
+    bool scan_ranges(const std::string& path, std::vector<GopRange>& ranges)
+    {
+        AVFormatContext* format_ctx = nullptr;
+        int stream_index = -1;
+        const AVCodec* codec = nullptr;
+        if (!open_video(path, format_ctx, stream_index, &codec))
+        {
+            avformat_close_input(&format_ctx);
+            return false;
+        }
+
+        AVPacket* packet = av_packet_alloc();
+        size_t range_packets = 0;
+        while (packet && av_read_frame(format_ctx, packet) >= 0)
+        {
+            if (packet->stream_index == stream_index)
+            {
+                int64_t time = packet_time(packet);
+                bool starts_range = (packet->flags & AV_PKT_FLAG_KEY) && time != AV_NOPTS_VALUE &&
+                    (ranges.empty() || (range_packets >= MIN_RANGE_PACKETS && time > ranges.back().start_pts));
+                if (starts_range)
+                {
+                    if (!ranges.empty())
+                    {
+                        ranges.back().end_pts = time;
+                    }
+                    ranges.push_back(GopRange{time, packet->dts, INT64_MAX});
+                    range_packets = 0;
+                }
+                range_packets++;
+            }
+            av_packet_unref(packet);
+        }
+
+        av_packet_free(&packet);
+        avformat_close_input(&format_ctx);
+        return !ranges.empty();
+    }
+
+    // Готовые кадры диапазонов. Кадры головного диапазона (head) сразу
+    // уходят вызывающему, остальные копятся в пределах бюджета памяти
+    struct RangeQueue
+    {
+        struct Output
+        {
+            std::deque<DecodedFrame> frames;
+            bool done = false;
+        };
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<Output> outputs;
+        size_t next_range = 0;
+        size_t head = 0;
+        size_t buffered_bytes = 0;
+        size_t budget_bytes = 0;
+
+        // false — диапазоны кончились
+        bool claim(size_t& range)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (next_range >= outputs.size())
+                return false;
+            range = next_range++;
+            return true;
+        }
+
+        void push(size_t range, DecodedFrame frame)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // Головной диапазон не ждёт никогда, иначе выдача встанет
+            cv.wait(lock, [&]
+            {
+                return range == head || buffered_bytes < budget_bytes;
+            });
+            buffered_bytes += frame.rgb.size();
+            outputs[range].frames.push_back(std::move(frame));
+            cv.notify_all();
+        }
+
+        void finish(size_t range)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            outputs[range].done = true;
+            cv.notify_all();
+        }
+
+        // false — все диапазоны выданы
+        bool pop(DecodedFrame& frame)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (head < outputs.size())
+            {
+                Output& output = outputs[head];
+                cv.wait(lock, [&]
+                {
+                    return !output.frames.empty() || output.done;
+                });
+
+                if (!output.frames.empty())
+                {
+                    frame = std::move(output.frames.front());
+                    output.frames.pop_front();
+                    buffered_bytes -= frame.rgb.size();
+                    cv.notify_all();
+                    return true;
+                }
+                head++;
+                cv.notify_all();
+            }
+            return false;
+        }
+    };
+
+    class RangeDecoder
+    {
+    public:
+        ~RangeDecoder()
+        {
+            sws_freeContext(sws_ctx_);
+            av_frame_free(&frame_);
+            av_packet_free(&packet_);
+            avcodec_free_context(&codec_ctx_);
+            avformat_close_input(&format_ctx_);
+        }
+
+        bool open(const std::string& path)
+        {
+            const AVCodec* codec = nullptr;
+            if (!open_video(path, format_ctx_, stream_index_, &codec))
+                return false;
+
+            AVStream* stream = format_ctx_->streams[stream_index_];
+            codec_ctx_ = avcodec_alloc_context3(codec);
+            if (!codec_ctx_ || avcodec_parameters_to_context(codec_ctx_, stream->codecpar) < 0)
+                return false;
+
+            // Параллельность даёт число рабочих, а не потоки декодера
+            codec_ctx_->thread_count = 1;
+            if (avcodec_open2(codec_ctx_, codec, nullptr) < 0)
+            {
+                std::cerr << "Could not open video codec" << std::endl;
+                return false;
+            }
+
+            time_base_ = av_q2d(stream->time_base);
+            start_pts_ = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+            frame_ = av_frame_alloc();
+            packet_ = av_packet_alloc();
+            return frame_ && packet_;
+        }
+
+        bool decode(const GopRange& range, const ParallelDecodeOptions& options, size_t index, RangeQueue& queue)
+        {
+            int64_t seek_target = range.start_dts != AV_NOPTS_VALUE ? range.start_dts : range.start_pts;
+            if (av_seek_frame(format_ctx_, stream_index_, seek_target, AVSEEK_FLAG_BACKWARD) < 0)
+            {
+                std::cerr << "Seek to " << range.start_pts << " failed" << std::endl;
+                return false;
+            }
+            avcodec_flush_buffers(codec_ctx_);
+
+            // После ключевого кадра следующего диапазона читаем только
+            // ведущие кадры открытого GOP (pts меньше его pts)
+            bool past_end = false;
+            while (av_read_frame(format_ctx_, packet_) >= 0)
+            {
+                if (packet_->stream_index != stream_index_)
+                {
+                    av_packet_unref(packet_);
+                    continue;
+                }
+
+                int64_t time = packet_time(packet_);
+                if (past_end && time != AV_NOPTS_VALUE && time >= range.end_pts)
+                {
+                    av_packet_unref(packet_);
+                    break;
+                }
+                if ((packet_->flags & AV_PKT_FLAG_KEY) && time != AV_NOPTS_VALUE && time >= range.end_pts)
+                {
+                    past_end = true;
+                }
+
+                int ret = avcodec_send_packet(codec_ctx_, packet_);
+                av_packet_unref(packet_);
+                if (ret < 0 && ret != AVERROR(EAGAIN))
+                    continue;
+                if (!receive_frames(range, options, index, queue))
+                    return false;
+            }
+
+            avcodec_send_packet(codec_ctx_, nullptr);
+            return receive_frames(range, options, index, queue);
+        }
+
+    private:
+        bool receive_frames(const GopRange& range, const ParallelDecodeOptions& options, size_t index,
+            RangeQueue& queue)
+        {
+            while (avcodec_receive_frame(codec_ctx_, frame_) == 0)
+            {
+                int64_t pts = frame_->best_effort_timestamp != AV_NOPTS_VALUE ?
+                    frame_->best_effort_timestamp : frame_->pts;
+                // Кадры до начала — хвост прошлого диапазона после перехода
+                if (pts == AV_NOPTS_VALUE || pts < range.start_pts || pts >= range.end_pts)
+                {
+                    av_frame_unref(frame_);
+                    continue;
+                }
+
+                DecodedFrame decoded;
+                decoded.seconds = (pts - start_pts_) * time_base_;
+                bool scaled = scale(options, decoded);
+                av_frame_unref(frame_);
+                if (!scaled)
+                    return false;
+                queue.push(index, std::move(decoded));
+            }
+            return true;
+        }
+
+        bool scale(const ParallelDecodeOptions& options, DecodedFrame& decoded)
+        {
+            int src_w = frame_->width;
+            int src_h = frame_->height;
+            int dst_w = options.width;
+            int dst_h = options.height;
+            if (dst_w <= 0 && dst_h <= 0)
+            {
+                dst_w = src_w;
+                dst_h = src_h;
+            }
+            else if (dst_h <= 0)
+            {
+                dst_h = std::max(2, static_cast<int>(std::lround(static_cast<double>(dst_w) * src_h / src_w)) & ~1);
+            }
+            else if (dst_w <= 0)
+            {
+                dst_w = std::max(2, static_cast<int>(std::lround(static_cast<double>(dst_h) * src_w / src_h)) & ~1);
+            }
+
+            sws_ctx_ = sws_getCachedContext(sws_ctx_, src_w, src_h,
+                static_cast<AVPixelFormat>(frame_->format), dst_w, dst_h, AV_PIX_FMT_RGB24,
+                SWS_BILINEAR, nullptr, nullptr, nullptr);
+            if (!sws_ctx_)
+            {
+                std::cerr << "Failed to create sws context" << std::endl;
+                return false;
+            }
+
+            decoded.width = dst_w;
+            decoded.height = dst_h;
+            decoded.rgb.resize(static_cast<size_t>(dst_w) * dst_h * 3);
+
+            uint8_t* dst_data[4] = {decoded.rgb.data(), nullptr, nullptr, nullptr};
+            int dst_linesize[4] = {dst_w * 3, 0, 0, 0};
+            sws_scale(sws_ctx_, frame_->data, frame_->linesize, 0, src_h, dst_data, dst_linesize);
+            return true;
+        }
+
+        AVFormatContext* format_ctx_ = nullptr;
+        AVCodecContext* codec_ctx_ = nullptr;
+        SwsContext* sws_ctx_ = nullptr;
+        AVFrame* frame_ = nullptr;
+        AVPacket* packet_ = nullptr;
+        int stream_index_ = -1;
+        double time_base_ = 0.0;
+        int64_t start_pts_ = 0;
+    };
+}
+
+bool decode_parallel(const std::string& path, const ParallelDecodeOptions& options,
+    const DecodedFrameCallback& on_frame, ParallelDecodeStats* stats)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<GopRange> ranges;
+    if (!scan_ranges(path, ranges))
+        return false;
+    double scan_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int workers = options.workers > 0 ? options.workers
+                                      : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    workers = static_cast<int>(std::min<size_t>(workers, ranges.size()));
+
+    RangeQueue queue;
+    queue.outputs.resize(ranges.size());
+    queue.budget_bytes = options.memory_budget_bytes;
+    std::atomic<int> failed_ranges{0};
+
+    auto worker = [&]()
+    {
+        RangeDecoder decoder;
+        bool opened = decoder.open(path);
+
+        size_t range;
+        while (queue.claim(range))
+        {
+            // Диапазон отмечается готовым и при ошибке, иначе выдача встанет
+            if (!opened || !decoder.decode(ranges[range], options, range, queue))
+            {
+                failed_ranges++;
+            }
+            queue.finish(range);
+        }
+    };
+
+    // Вызывающий поток занят выдачей кадров по порядку
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; i++)
+    {
+        threads.emplace_back(worker);
+    }
+
+    uint64_t frames = 0;
+    DecodedFrame frame;
+    while (queue.pop(frame))
+    {
+        frame.index = frames++;
+        on_frame(frame);
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (stats)
+    {
+        stats->frames = frames;
+        stats->ranges = ranges.size();
+        stats->workers = workers;
+        stats->scan_seconds = scan_seconds;
+        stats->total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    if (failed_ranges > 0)
+    {
+        std::cerr << failed_ranges.load() << " of " << ranges.size() << " ranges failed to decode" << std::endl;
+        return false;
+    }
+    return true;
+}
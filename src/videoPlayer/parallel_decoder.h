@@ -0,0 +1,56 @@
+#ifndef PARALLEL_DECODER_H
+#define PARALLEL_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct ParallelDecodeOptions
+{
+    // 0 — по числу логических CPU
+    int workers = 0;
+    // Размер на выходе, как в ThumbnailOptions; оба 0 — исходный
+    int width = 0;
+    int height = 0;
+    // Сколько байт готовых кадров могут ждать своей очереди. Рабочий,
+    // чей диапазон ещё не выдаётся, при превышении ждёт
+    size_t memory_budget_bytes = 512 * 1024 * 1024;
+};
+
+struct DecodedFrame
+{
+    // Порядковый номер в выдаче (по pts)
+    uint64_t index = 0;
+    double seconds = 0.0;
+    int width = 0;
+    int height = 0;
+    // RGB24 без выравнивания строк (stride = width * 3)
+    std::vector<uint8_t> rgb;
+};
+
+struct ParallelDecodeStats
+{
+    uint64_t frames = 0;
+    size_t ranges = 0;
+    int workers = 0;
+    // Разбор файла в поисках ключевых кадров и всё вместе
+    double scan_seconds = 0.0;
+    double total_seconds = 0.0;
+};
+
+// Вызывается в потоке decode_parallel, строго по возрастанию pts.
+// Кадр можно забрать (std::move(frame.rgb))
+using DecodedFrameCallback = std::function<void(DecodedFrame& frame)>;
+
+// Офлайн-декодирование всего видеопотока на нескольких ядрах. Файл
+// разбивается по ключевым кадрам на диапазоны из нескольких GOP, каждый
+// рабочий поток декодирует свои диапазоны своим AVFormatContext и
+// декодером, а кадры выдаются по порядку. Диапазон дочитывается за
+// следующий ключевой кадр, пока идут кадры открытого GOP с меньшим pts.
+// false — файл не открылся или часть диапазонов не декодировалась
+bool decode_parallel(const std::string& path, const ParallelDecodeOptions& options,
+    const DecodedFrameCallback& on_frame, ParallelDecodeStats* stats = nullptr);
+
+#endif
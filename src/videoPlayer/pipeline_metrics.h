@@ -0,0 +1,83 @@
+#ifndef PIPELINE_METRICS_H
+#define PIPELINE_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+enum class PipelineThread
+{
+    Demuxer,
+    VideoDecode,
+    AudioDecode,
+    AudioCallback,
+    Count
+};
+
+const char* pipeline_thread_name(PipelineThread thread);
+
+// Отметка о том, что поток конвейера жив и продвигается.
+// Неактивные потоки (ещё не запущены или уже завершились) watchdog не проверяет.
+struct ThreadHeartbeat
+{
+    std::atomic<bool> active{false};
+    std::atomic<int64_t> last_progress_ns{0};
+    std::atomic<bool> stalled{false};
+    std::atomic<uint64_t> stalls{0};
+};
+
+// Счётчики, которые потоки конвейера обновляют без блокировок, а
+// MetricsServer читает при каждом запросе
+struct PipelineMetrics
+{
+    std::atomic<uint64_t> frames_decoded{0};
+    std::atomic<uint64_t> frames_displayed{0};
+    std::atomic<uint64_t> frames_dropped{0};
+    std::atomic<uint64_t> audio_underruns{0};
+    std::atomic<double> av_drift_seconds{0.0};
+    std::atomic<double> av_drift_max_abs_seconds{0.0};
+    std::atomic<double> video_fps{0.0};
+    // Отслеживание изменившихся плиток (PlayerConfig::damage_tile_size)
+    std::atomic<uint64_t> damage_tiles_total{0};
+    std::atomic<uint64_t> damage_tiles_dirty{0};
+    std::atomic<uint64_t> frames_unchanged{0};
+    // Байты двухцветных кадров после дельты (PlayerConfig::bilevel_threshold)
+    std::atomic<uint64_t> bilevel_bytes{0};
+    // Повтор по кругу (PlayerConfig::loop): пройденные круги и память
+    // кэша пакетов (0 — круги идут перемоткой)
+    std::atomic<uint64_t> loops_completed{0};
+    std::atomic<uint64_t> loop_cache_bytes{0};
+
+    std::array<ThreadHeartbeat, static_cast<size_t>(PipelineThread::Count)> heartbeats;
+
+    static int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    ThreadHeartbeat& heartbeat(PipelineThread thread)
+    {
+        return heartbeats[static_cast<size_t>(thread)];
+    }
+
+    void thread_started(PipelineThread thread)
+    {
+        ThreadHeartbeat& hb = heartbeat(thread);
+        hb.last_progress_ns.store(now_ns(), std::memory_order_relaxed);
+        hb.active.store(true, std::memory_order_release);
+    }
+
+    void thread_finished(PipelineThread thread)
+    {
+        heartbeat(thread).active.store(false, std::memory_order_release);
+    }
+
+    void progress(PipelineThread thread)
+    {
+        heartbeat(thread).last_progress_ns.store(now_ns(), std::memory_order_relaxed);
+    }
+};
+
+#endif
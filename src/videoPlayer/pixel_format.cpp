@@ -0,0 +1,107 @@
+#include "pixel_format.h"
+
+#include <algorithm>
+
+AVPixelFormat to_av_pixel_format(PixelFormat format)
+{
+    switch (format)
+    {
+    case PixelFormat::Rgb24:
+        return AV_PIX_FMT_RGB24;
+    case PixelFormat::Rgba:
+        return AV_PIX_FMT_RGBA;
+    case PixelFormat::Bgra:
+        return AV_PIX_FMT_BGRA;
+    case PixelFormat::Nv12:
+        return AV_PIX_FMT_NV12;
+    case PixelFormat::Yuv420p:
+        return AV_PIX_FMT_YUV420P;
+    case PixelFormat::Gray8:
+        return AV_PIX_FMT_GRAY8;
+    }
+    return AV_PIX_FMT_RGB24;
+}
+
+namespace
+{
+    struct NamedFormat
+    {
+        PixelFormat format;
+        const char* name;
+    };
+
+    const NamedFormat format_names[] = {
+        {PixelFormat::Rgb24, "rgb24"},
+        {PixelFormat::Rgba, "rgba"},
+        {PixelFormat::Bgra, "bgra"},
+        {PixelFormat::Nv12, "nv12"},
+        {PixelFormat::Yuv420p, "yuv420p"},
+        {PixelFormat::Gray8, "gray8"},
+    };
+}
+
+const char* pixel_format_name(PixelFormat format)
+{
+    for (const NamedFormat& entry : format_names)
+    {
+        if (entry.format == format)
+            return entry.name;
+    }
+    return "unknown";
+}
+
+bool parse_pixel_format(const std::string& name, PixelFormat& format)
+{
+    for (const NamedFormat& entry : format_names)
+    {
+        if (name == entry.name)
+        {
+            format = entry.format;
+            return true;
+        }
+    }
+    return false;
+}
+
+OutputFormat negotiate_output_format(const OutputFormatRequest& request)
+{
+    OutputFormat result;
+    if (!request.formats.empty())
+    {
+        result.format = request.formats.front();
+    }
+    result.row_align = request.strided ? OUTPUT_ROW_ALIGN : 1;
+    return result;
+}
+
+OutputFormatRequest intersect_output_formats(const std::vector<OutputFormatRequest>& requests)
+{
+    OutputFormatRequest result;
+    if (requests.empty())
+        return result;
+
+    result.formats.clear();
+    result.strided = true;
+    for (const OutputFormatRequest& request : requests)
+    {
+        result.strided = result.strided && request.strided;
+    }
+
+    for (PixelFormat format : requests.front().formats)
+    {
+        bool everyone = std::all_of(requests.begin(), requests.end(), [format](const OutputFormatRequest& request)
+        {
+            return std::find(request.formats.begin(), request.formats.end(), format) != request.formats.end();
+        });
+        if (everyone)
+        {
+            result.formats.push_back(format);
+        }
+    }
+
+    if (result.formats.empty())
+    {
+        result.formats.push_back(PixelFormat::Rgb24);
+    }
+    return result;
+}
@@ -0,0 +1,67 @@
+#ifndef PIXEL_FORMAT_H
+#define PIXEL_FORMAT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C"
+{
+#include <libavutil/pixfmt.h>
+}
+
+// Форматы, в которых decode_video может отдавать кадры получателям
+enum class PixelFormat
+{
+    Rgb24,
+    Rgba,
+    Bgra,
+    Nv12,
+    Yuv420p,
+    Gray8
+};
+
+// Выравнивание строк и плоскостей для получателей, понимающих шаг строки
+constexpr int OUTPUT_ROW_ALIGN = 64;
+
+AVPixelFormat to_av_pixel_format(PixelFormat format);
+const char* pixel_format_name(PixelFormat format);
+bool parse_pixel_format(const std::string& name, PixelFormat& format);
+
+// Кадр в согласованном формате: до трёх плоскостей, у каждой свой шаг
+// строки в байтах. Память принадлежит вызывающему и действительна
+// только на время вызова display_image.
+struct VideoImage
+{
+    PixelFormat format = PixelFormat::Rgb24;
+    int width = 0;
+    int height = 0;
+    uint8_t* data[4] = {};
+    int stride[4] = {};
+    // Яркость в телевизионном диапазоне 16..235 (Gray8 прямо из плоскости
+    // Y декодера), иначе 0..255
+    bool limited_range = false;
+};
+
+// Что получатель готов принимать
+struct OutputFormatRequest
+{
+    // По убыванию предпочтения; пусто — Rgb24
+    std::vector<PixelFormat> formats{PixelFormat::Rgb24};
+    // Понимает шаг строки больше ширины. Иначе строки идут вплотную
+    // (выравнивание 1), как раньше
+    bool strided = false;
+};
+
+struct OutputFormat
+{
+    PixelFormat format = PixelFormat::Rgb24;
+    int row_align = 1;
+};
+
+OutputFormat negotiate_output_format(const OutputFormatRequest& request);
+// Общее для нескольких получателей: порядок первого, только форматы,
+// которые понимают все; если таких нет — Rgb24
+OutputFormatRequest intersect_output_formats(const std::vector<OutputFormatRequest>& requests);
+
+#endif
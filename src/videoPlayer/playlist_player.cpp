@@ -0,0 +1,169 @@
+#include "playlist_player.h"
+#include "gl_preview_sink.h"
+#include "thread_budget.h"
+
+#include <fstream>
+#include <future>
+#include <iostream>
+
+PlaylistPlayer::~PlaylistPlayer()
+{
+    stop();
+}
+
+std::unique_ptr<MediaPlayer> PlaylistPlayer::prepare(const std::string& path, const PlayerConfig& config)
+{
+    auto player = std::make_unique<MediaPlayer>();
+    if (!player->initialize(path, config))
+    {
+        std::cerr << "Skipping playlist item: " << path << std::endl;
+        return nullptr;
+    }
+    player->preroll();
+    return player;
+}
+
+size_t PlaylistPlayer::play(const std::vector<std::string>& paths, const PlayerConfig& config)
+{
+    PlayerConfig shared_config = config;
+    if (config.power_save)
+    {
+        // До общего пула и устройства звука: их потоки наследуют допуск,
+        // а initialize следующих файлов идёт уже в других потоках
+        set_timer_slack(POWER_SAVE_TIMER_SLACK);
+    }
+    if (!shared_config.scheduler)
+    {
+        shared_config.scheduler = std::make_shared<TaskScheduler>(DEFAULT_PIPELINE_THREADS);
+    }
+    auto sink = std::make_shared<PersistentVideoSink>(
+        config.video_sink ? config.video_sink : std::make_shared<GlPreviewSink>());
+    shared_config.video_sink = sink;
+
+    // Устройство открывается один раз; каждый плеер при старте переключает его на себя
+    if (!paths.empty() && !shared_config.audio_device)
+    {
+        std::shared_ptr<AudioOutput> device = make_audio_output(config.audio_output);
+        if (device->open(nullptr))
+        {
+            shared_config.audio_device = std::move(device);
+        }
+    }
+
+    size_t index = 0;
+    std::unique_ptr<MediaPlayer> current;
+    while (!current && index < paths.size())
+    {
+        current = prepare(paths[index++], shared_config);
+    }
+
+    size_t played = 0;
+    if (current)
+    {
+        current->start();
+    }
+
+    while (current)
+    {
+        // Следующий файл готовится, пока играет текущий
+        std::future<std::unique_ptr<MediaPlayer>> next;
+        if (index < paths.size())
+        {
+            next = std::async(std::launch::async, [this, &paths, &shared_config, &index]()
+            {
+                std::unique_ptr<MediaPlayer> player;
+                while (!player && index < paths.size() && !stopped_)
+                {
+                    player = prepare(paths[index++], shared_config);
+                }
+                return player;
+            });
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            current_ = current.get();
+        }
+        // stop() мог прийти, пока current_ указывал на другой плеер
+        if (stopped_)
+        {
+            current->stop();
+        }
+        current->wait();
+        played++;
+
+        std::unique_ptr<MediaPlayer> following = next.valid() ? next.get() : nullptr;
+        if (following && !stopped_)
+        {
+            // pts разных файлов пересекаются
+            if (shared_config.frame_cache)
+            {
+                shared_config.frame_cache->clear();
+            }
+            // Размер следующего файла — только теперь, когда декодер
+            // предыдущего уже не пишет в получатель
+            sink->apply_video_size();
+            // Следующий файл стартует до того, как закрываются кодеки предыдущего
+            following->start();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            current_ = following.get();
+        }
+        current->cleanup();
+        current = std::move(following);
+
+        if (stopped_)
+            break;
+    }
+
+    if (current)
+    {
+        current->cleanup();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        current_ = nullptr;
+    }
+
+    sink->finish();
+    if (shared_config.audio_device && !config.audio_device)
+    {
+        shared_config.audio_device->close();
+    }
+    return played;
+}
+
+void PlaylistPlayer::stop()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+    if (current_)
+    {
+        current_->stop();
+    }
+}
+
+std::vector<std::string> read_playlist(const std::string& path)
+{
+    std::vector<std::string> items;
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::cerr << "Could not open playlist: " << path << std::endl;
+        return items;
+    }
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#')
+            continue;
+        items.push_back(line);
+    }
+    return items;
+}
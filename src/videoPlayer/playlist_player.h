@@ -0,0 +1,42 @@
+#ifndef PLAYLIST_PLAYER_H
+#define PLAYLIST_PLAYER_H
+
+#include "media_player.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Воспроизведение нескольких файлов подряд без пауз между ними. Пока
+// играет текущий файл, следующий в фоне открывается (форматы, кодеки)
+// и заполняет очереди пакетов и звука (MediaPlayer::preroll). Звуковое
+// устройство, пул задач и получатели кадров общие для всех файлов и
+// живут до конца плейлиста, так что окно и звук не пересоздаются.
+class PlaylistPlayer
+{
+public:
+    PlaylistPlayer() = default;
+    ~PlaylistPlayer();
+
+    // Играет файлы по порядку; те, что не открылись, пропускает.
+    // Возвращает число сыгранных файлов
+    size_t play(const std::vector<std::string>& paths, const PlayerConfig& config);
+
+    // Можно вызывать из любого потока
+    void stop();
+
+private:
+    std::unique_ptr<MediaPlayer> prepare(const std::string& path, const PlayerConfig& config);
+
+    std::mutex mutex_;
+    MediaPlayer* current_ = nullptr;
+    std::atomic<bool> stopped_{false};
+};
+
+// Пути из файла плейлиста: по одному в строке, пустые строки и
+// строки с # (комментарии M3U) пропускаются
+std::vector<std::string> read_playlist(const std::string& path);
+
+#endif
@@ -2,7 +2,15 @@
 #define SHARED_DATA_H
 
 #include "audio_clock.h"
+#include "frame_cache.h"
+#include "frame_file.h"
 #include "frame_types.h"
+#include "jitter_buffer.h"
+#include "monochrome.h"
+#include "pipeline_metrics.h"
+#include "slow_source.h"
+#include "stream_source.h"
+#include "task_scheduler.h"
 
 #include <atomic>
 #include <condition_variable>
@@ -19,13 +27,21 @@ struct SharedData
 {
     std::mutex audio_mutex;
     std::queue<std::shared_ptr<AudioFrame>> audio_queue;
-    std::condition_variable audio_cv;
+    AsyncCondition audio_cv;
     
     std::mutex video_mutex;
     std::queue<std::shared_ptr<VideoFrame>> video_queue;
     std::condition_variable video_cv;
     
     AudioClock audio_clock;
+    // Общие часы нескольких плееров (PlayerConfig::clock) и начало файла
+    // на них; nullptr — кадры идут по audio_clock
+    std::shared_ptr<AudioClock> external_clock;
+    double external_clock_offset = 0.0;
+    double clock_time()
+    {
+        return external_clock ? external_clock->get_time() + external_clock_offset : audio_clock.get_time();
+    }
     
     std::atomic<bool> audio_running{true};
     std::atomic<bool> video_running{true};
@@ -34,13 +50,54 @@ struct SharedData
     std::mutex packet_mutex;
     std::queue<std::shared_ptr<AVPacket>> video_packets;
     std::queue<std::shared_ptr<AVPacket>> audio_packets;
-    std::condition_variable packet_cv;
+    AsyncCondition packet_cv;
     
-    const size_t MAX_PACKET_QUEUE_SIZE = 100;
+    // PlayerConfig::packet_queue_size
+    size_t MAX_PACKET_QUEUE_SIZE = 100;
     const size_t MAX_FRAME_QUEUE_SIZE = 30;
+    const size_t POWER_SAVE_PACKET_BATCH = 8;
     
     std::atomic<int64_t> audio_samples_played_{0};
+    // Запрошенный темп (MediaPlayer::set_speed); декодер звука растягивает
+    // сэмплы под него, часы догоняют в audio_callback
+    std::atomic<double> playback_speed{1.0};
     std::atomic<int64_t> last_audio_update_{0};
+    
+    PipelineMetrics metrics;
+    
+    // Кэш показанных кадров (nullptr — выключен), см. PlayerConfig::frame_cache
+    std::shared_ptr<FrameCache> frame_cache;
+    // Размер плитки для сравнения кадров (0 — выключено), см.
+    // PlayerConfig::damage_tile_size
+    int damage_tile_size = 0;
+    MonochromeMode monochrome = MonochromeMode::Auto;
+    int bilevel_threshold = 0;
+    // Первый проход пишет показанные кадры сюда (nullptr — не пишем),
+    // см. PlayerConfig::frame_files
+    std::shared_ptr<FrameFileWriter> frame_file_writer;
+    // Повтор по кругу и лимит памяти под пакеты первого прохода, см.
+    // PlayerConfig::loop
+    bool loop = false;
+    size_t loop_cache_bytes = 0;
+    
+    // Экономия энергии (PlayerConfig::power_save): декодер будят, когда в
+    // очереди набралась пачка пакетов, а демультиплексор — когда в полной
+    // очереди освободилось место под пачку. На потоковом входе очереди
+    // ограничены JitterBuffer, там пачек нет
+    bool power_save = false;
+    size_t packet_batch() const
+    {
+        return power_save && !jitter ? POWER_SAVE_PACKET_BATCH : 1;
+    }
+    
+    // Потоковый вход: источник байтов и буфер против неровной доставки.
+    // Оба nullptr для обычных файлов; тогда очереди ограничены
+    // MAX_PACKET_QUEUE_SIZE
+    std::shared_ptr<StreamSource> stream_source;
+    std::shared_ptr<JitterBuffer> jitter;
+    // Обычный файл через имитацию медленного диска (PlayerConfig::slow_io),
+    // иначе nullptr
+    std::shared_ptr<SlowSource> slow_source;
 };
 
 #endif
\ No newline at end of file
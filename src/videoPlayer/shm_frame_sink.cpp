@@ -0,0 +1,46 @@
+#include "shm_frame_sink.h"
+#include "stage_stats.h"
+
+#include <iostream>
+
+SharedMemorySink::SharedMemorySink(std::string name, int slot_count)
+    : name_(std::move(name))
+    , slot_count_(slot_count)
+{
+}
+
+void SharedMemorySink::set_video_size(int width, int height)
+{
+    width_ = width;
+    height_ = height;
+}
+
+bool SharedMemorySink::start()
+{
+    if (!writer_.create(name_, width_, height_, slot_count_))
+    {
+        std::cerr << "Failed to create frame ring " << name_ << std::endl;
+        return false;
+    }
+    std::cout << "Publishing frames to shared memory " << name_ << std::endl;
+    return true;
+}
+
+void SharedMemorySink::display_frame(uint8_t* rgb, int width, int height, double pts)
+{
+    StageTimer timer(Stage::ShmPublish);
+    // Следующий файл плейлиста другого размера: читатели увидят закрытие
+    // старого кольца и подключатся заново
+    if (width != width_ || height != height_)
+    {
+        width_ = width;
+        height_ = height;
+        writer_.create(name_, width_, height_, slot_count_);
+    }
+    writer_.publish(rgb, width, height, pts);
+}
+
+void SharedMemorySink::stop()
+{
+    writer_.close();
+}
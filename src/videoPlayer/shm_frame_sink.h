@@ -0,0 +1,30 @@
+#ifndef SHM_FRAME_SINK_H
+#define SHM_FRAME_SINK_H
+
+#include "frame_ring.h"
+#include "video_sink.h"
+
+#include <string>
+
+// Публикует кадры в кольцо FrameRing для читателей из других процессов
+// (см. tools/frame_ring_consumer.cpp). Воспроизведение никогда не ждёт
+// читателей: если все слоты заняты, кадр в кольцо просто не попадает.
+class SharedMemorySink : public VideoSink
+{
+public:
+    SharedMemorySink(std::string name, int slot_count);
+
+    void set_video_size(int width, int height) override;
+    bool start() override;
+    void display_frame(uint8_t* rgb, int width, int height, double pts) override;
+    void stop() override;
+
+private:
+    std::string name_;
+    int slot_count_;
+    int width_ = 0;
+    int height_ = 0;
+    FrameRingWriter writer_;
+};
+
+#endif
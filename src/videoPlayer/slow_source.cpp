@@ -0,0 +1,219 @@
+#include "slow_source.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+extern "C"
+{
+#include <libavformat/avio.h>
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+namespace
+{
+    constexpr int MIN_READ_SIZE = 4096;
+
+    bool parse_number(const std::string& text, double& value)
+    {
+        char* end = nullptr;
+        value = std::strtod(text.c_str(), &end);
+        return !text.empty() && *end == '\0' && value >= 0.0;
+    }
+}
+
+bool parse_slow_source_options(const std::string& spec, SlowSourceOptions& options)
+{
+    std::stringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        size_t equals = item.find('=');
+        if (equals == std::string::npos)
+            return false;
+
+        std::string key = item.substr(0, equals);
+        double value = 0.0;
+        if (!parse_number(item.substr(equals + 1), value))
+            return false;
+
+        if (key == "latency")
+            options.latency_ms = value;
+        else if (key == "jitter")
+            options.jitter_ms = value;
+        else if (key == "bandwidth")
+            options.bandwidth_kib = value;
+        else if (key == "stall")
+            options.stall_ms = value;
+        else if (key == "stall-rate" && value <= 1.0)
+            options.stall_probability = value;
+        else if (key == "stall-every")
+            options.stall_every_seconds = value;
+        else if (key == "read-size" && value >= MIN_READ_SIZE && value <= (1 << 24))
+            options.read_size = static_cast<int>(value);
+        else if (key == "seed")
+            options.seed = static_cast<uint32_t>(value);
+        else
+            return false;
+    }
+    return true;
+}
+
+SlowSource::SlowSource(const SlowSourceOptions& options)
+    : options_(options), random_(options.seed)
+{
+    options_.read_size = std::max(options_.read_size, MIN_READ_SIZE);
+}
+
+SlowSource::~SlowSource()
+{
+    if (input_)
+    {
+        avio_closep(&input_);
+    }
+    if (avio_)
+    {
+        // Буфер мог быть заменён libavformat, освобождаем текущий
+        av_freep(&avio_->buffer);
+        avio_context_free(&avio_);
+    }
+}
+
+bool SlowSource::open(const std::string& path)
+{
+    int ret = avio_open2(&input_, path.c_str(), AVIO_FLAG_READ, nullptr, nullptr);
+    if (ret < 0)
+    {
+        char message[AV_ERROR_MAX_STRING_SIZE] = {};
+        av_strerror(ret, message, sizeof(message));
+        std::cerr << "Could not open " << path << ": " << message << std::endl;
+        return false;
+    }
+
+    uint8_t* buffer = static_cast<uint8_t*>(av_malloc(options_.read_size));
+    if (buffer)
+    {
+        avio_ = avio_alloc_context(buffer, options_.read_size, 0, this, &SlowSource::read_packet,
+            nullptr, &SlowSource::seek);
+    }
+    if (!avio_)
+    {
+        std::cerr << "Could not allocate slow I/O context" << std::endl;
+        av_free(buffer);
+        return false;
+    }
+
+    if (options_.stall_every_seconds > 0.0)
+    {
+        next_stall_ = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(options_.stall_every_seconds));
+    }
+    return true;
+}
+
+void SlowSource::interrupt()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+    stop_cv_.notify_all();
+}
+
+void SlowSource::delay(Clock::time_point start, int bytes)
+{
+    using Seconds = std::chrono::duration<double>;
+
+    double wait_ms = options_.latency_ms;
+    if (options_.jitter_ms > 0.0)
+    {
+        wait_ms += std::uniform_real_distribution<double>(0.0, options_.jitter_ms)(random_);
+    }
+
+    bool stall = options_.stall_probability > 0.0 &&
+        std::uniform_real_distribution<double>(0.0, 1.0)(random_) < options_.stall_probability;
+    if (options_.stall_every_seconds > 0.0 && start >= next_stall_)
+    {
+        stall = true;
+        next_stall_ = start + std::chrono::duration_cast<Clock::duration>(
+            Seconds(options_.stall_every_seconds));
+    }
+    if (stall)
+    {
+        wait_ms += options_.stall_ms;
+    }
+
+    Clock::time_point wake = start + std::chrono::duration_cast<Clock::duration>(Seconds(wait_ms / 1000.0));
+    if (options_.bandwidth_kib > 0.0 && bytes > 0)
+    {
+        // Чтения идут вплотную друг за другом: простой не копит запас
+        bandwidth_free_ = std::max(bandwidth_free_, start) + std::chrono::duration_cast<Clock::duration>(
+            Seconds(bytes / (options_.bandwidth_kib * 1024.0)));
+        wake = std::max(wake, bandwidth_free_);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_cv_.wait_until(lock, wake, [this] { return stopped_; });
+
+    Clock::time_point now = Clock::now();
+    double seconds = Seconds(now - start).count();
+    if (bytes > 0)
+    {
+        stats_.reads++;
+        stats_.bytes += static_cast<uint64_t>(bytes);
+    }
+    stats_.injected_seconds += Seconds(std::min(wake, now) - start).count();
+    stats_.max_read_seconds = std::max(stats_.max_read_seconds, seconds);
+    if (stall)
+    {
+        stats_.stalls++;
+        stats_.recovering = true;
+        stall_end_ = now;
+    }
+}
+
+int SlowSource::read_packet(void* opaque, uint8_t* buffer, int size)
+{
+    SlowSource* self = static_cast<SlowSource*>(opaque);
+    Clock::time_point start = Clock::now();
+
+    int received = avio_read(self->input_, buffer, std::min(size, self->options_.read_size));
+    if (received == 0)
+    {
+        received = AVERROR_EOF;
+    }
+    self->delay(start, received);
+    return received;
+}
+
+int64_t SlowSource::seek(void* opaque, int64_t offset, int whence)
+{
+    SlowSource* self = static_cast<SlowSource*>(opaque);
+    if (whence & AVSEEK_SIZE)
+        return avio_size(self->input_);
+
+    // Перемотка на сетевом диске — тот же запрос к серверу, что и чтение
+    self->delay(Clock::now(), 0);
+    return avio_seek(self->input_, offset, whence & ~AVSEEK_FORCE);
+}
+
+void SlowSource::queue_full()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!stats_.recovering)
+        return;
+
+    double seconds = std::chrono::duration<double>(Clock::now() - stall_end_).count();
+    stats_.recovering = false;
+    stats_.recoveries++;
+    recovery_sum_ += seconds;
+    stats_.max_recovery_seconds = std::max(stats_.max_recovery_seconds, seconds);
+}
+
+SlowSourceStats SlowSource::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    SlowSourceStats result = stats_;
+    result.mean_recovery_seconds = stats_.recoveries > 0 ? recovery_sum_ / stats_.recoveries : 0.0;
+    return result;
+}
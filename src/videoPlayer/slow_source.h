@@ -0,0 +1,110 @@
+#ifndef SLOW_SOURCE_H
+#define SLOW_SOURCE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+
+struct AVIOContext;
+
+// Имитация медленного диска или NFS поверх обычного файла
+struct SlowSourceOptions
+{
+    // Задержка каждого чтения и случайная добавка к ней до jitter_ms
+    double latency_ms = 0.0;
+    double jitter_ms = 0.0;
+    // Предел скорости чтения, КиБ/с (0 — без предела)
+    double bandwidth_kib = 0.0;
+    // Остановки на stall_ms: с вероятностью stall_probability на каждое
+    // чтение и/или раз в stall_every_seconds
+    double stall_ms = 200.0;
+    double stall_probability = 0.0;
+    double stall_every_seconds = 0.0;
+    // Порция одного чтения: NFS отдаёт файл кусками по rsize
+    int read_size = 64 * 1024;
+    uint32_t seed = 1;
+
+    bool enabled() const
+    {
+        return latency_ms > 0.0 || jitter_ms > 0.0 || bandwidth_kib > 0.0 ||
+            stall_probability > 0.0 || stall_every_seconds > 0.0;
+    }
+};
+
+// "latency=5,jitter=2,bandwidth=4096,stall=200,stall-rate=0.01,stall-every=5,
+// read-size=65536,seed=1"; любые ключи можно опустить
+bool parse_slow_source_options(const std::string& spec, SlowSourceOptions& options);
+
+struct SlowSourceStats
+{
+    uint64_t reads = 0;
+    uint64_t bytes = 0;
+    uint64_t stalls = 0;
+    // Всё добавленное ожидание: задержки, остановки и предел скорости
+    double injected_seconds = 0.0;
+    double max_read_seconds = 0.0;
+    // Восстановление: от конца последней остановки до момента, когда
+    // демультиплексор снова упёрся в полную очередь пакетов
+    uint64_t recoveries = 0;
+    double mean_recovery_seconds = 0.0;
+    double max_recovery_seconds = 0.0;
+    // Очередь так и не заполнилась после последней остановки
+    bool recovering = false;
+};
+
+// Вход обычного файла с задержками, пределом скорости и остановками.
+// Ждёт прямо в read_packet, то есть на потоке пула внутри av_read_frame,
+// как настоящий медленный диск, так что конвейер, лимиты очередей и
+// часы видят то же, что на NFS. Перемотка поддерживается
+class SlowSource
+{
+public:
+    explicit SlowSource(const SlowSourceOptions& options);
+    ~SlowSource();
+
+    SlowSource(const SlowSource&) = delete;
+    SlowSource& operator=(const SlowSource&) = delete;
+
+    bool open(const std::string& path);
+    // Обрывает текущее ожидание; дальше чтения идут без задержек
+    void interrupt();
+
+    // Для AVFormatContext::pb (с AVFMT_FLAG_CUSTOM_IO)
+    AVIOContext* avio() const
+    {
+        return avio_;
+    }
+
+    // Демультиплексор упёрся в лимит очереди: запас восстановлен
+    void queue_full();
+
+    SlowSourceStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static int read_packet(void* opaque, uint8_t* buffer, int size);
+    static int64_t seek(void* opaque, int64_t offset, int whence);
+    // Ожидание перед выдачей прочитанного (bytes = 0 — перемотка)
+    void delay(Clock::time_point start, int bytes);
+
+    SlowSourceOptions options_;
+    AVIOContext* input_ = nullptr;
+    AVIOContext* avio_ = nullptr;
+
+    std::mt19937 random_;
+    Clock::time_point bandwidth_free_{};
+    Clock::time_point next_stall_{};
+
+    mutable std::mutex mutex_;
+    std::condition_variable stop_cv_;
+    bool stopped_ = false;
+    SlowSourceStats stats_;
+    double recovery_sum_ = 0.0;
+    Clock::time_point stall_end_{};
+};
+
+#endif
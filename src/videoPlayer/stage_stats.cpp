@@ -0,0 +1,192 @@
+#include "stage_stats.h"
+
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+
+namespace
+{
+    std::array<LatencyHistogram, static_cast<size_t>(Stage::Count)> histograms;
+
+    const char* const stage_names[] = {
+        "demux_read",
+        "video_packet_wait",
+        "audio_packet_wait",
+        "video_send_packet",
+        "video_receive_frame",
+        "audio_send_packet",
+        "audio_receive_frame",
+        "video_scale",
+        "damage_compare",
+        "audio_resample",
+        "audio_stretch",
+        "display_handoff",
+        "gl_upload",
+        "gl_swap",
+        "shm_publish",
+        "audio_callback",
+    };
+
+    static_assert(sizeof(stage_names) / sizeof(stage_names[0]) == static_cast<size_t>(Stage::Count),
+        "stage_names must match Stage");
+}
+
+int LatencyHistogram::bucket_index(uint64_t value)
+{
+    if (value < static_cast<uint64_t>(SUB_BUCKET_COUNT))
+    {
+        return static_cast<int>(value);
+    }
+
+    int msb = std::bit_width(value) - 1;
+    int shift = msb - SUB_BUCKET_BITS + 1;
+    int mantissa = static_cast<int>(value >> shift);
+    return SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_HALF + (mantissa - SUB_BUCKET_HALF);
+}
+
+uint64_t LatencyHistogram::bucket_midpoint(int index)
+{
+    if (index < SUB_BUCKET_COUNT)
+    {
+        return static_cast<uint64_t>(index);
+    }
+
+    int offset = index - SUB_BUCKET_COUNT;
+    int shift = offset / SUB_BUCKET_HALF + 1;
+    uint64_t mantissa = static_cast<uint64_t>(offset % SUB_BUCKET_HALF + SUB_BUCKET_HALF);
+    return (mantissa << shift) + (uint64_t(1) << (shift - 1));
+}
+
+void LatencyHistogram::record(int64_t value_ns)
+{
+    if (value_ns < 0)
+    {
+        value_ns = 0;
+    }
+
+    buckets_[bucket_index(static_cast<uint64_t>(value_ns))].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(static_cast<uint64_t>(value_ns), std::memory_order_relaxed);
+
+    int64_t current_max = max_.load(std::memory_order_relaxed);
+    while (value_ns > current_max &&
+        !max_.compare_exchange_weak(current_max, value_ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& bucket : buckets_)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return count_.load(std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::max() const
+{
+    return max_.load(std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::percentile(double p) const
+{
+    uint64_t total = 0;
+    for (const auto& bucket : buckets_)
+    {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    // Ранг считаем по снимку корзин, а не по count_, чтобы не выйти за конец
+    // при одновременной записи из других потоков
+    uint64_t rank = static_cast<uint64_t>(std::clamp(p, 0.0, 100.0) / 100.0 * total + 0.5);
+    rank = std::clamp<uint64_t>(rank, 1, total);
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++)
+    {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            return std::min(static_cast<int64_t>(bucket_midpoint(i)), max());
+        }
+    }
+
+    return max();
+}
+
+StageSummary LatencyHistogram::summary() const
+{
+    StageSummary result;
+    result.count = count();
+    result.p50_ns = percentile(50.0);
+    result.p99_ns = percentile(99.0);
+    result.max_ns = max();
+    result.mean_ns = result.count ? static_cast<int64_t>(sum_.load(std::memory_order_relaxed) / result.count) : 0;
+    return result;
+}
+
+LatencyHistogram& stage_histogram(Stage stage)
+{
+    return histograms[static_cast<size_t>(stage)];
+}
+
+const char* stage_name(Stage stage)
+{
+    return stage_names[static_cast<size_t>(stage)];
+}
+
+StageSummary stage_summary(Stage stage)
+{
+    return stage_histogram(stage).summary();
+}
+
+void reset_stage_stats()
+{
+    for (auto& histogram : histograms)
+    {
+        histogram.reset();
+    }
+}
+
+void dump_stage_stats(std::ostream& out)
+{
+    auto flags = out.flags();
+    auto precision = out.precision();
+
+    out << "Stage latency (us):" << std::endl;
+    out << std::left << std::setw(22) << "stage" << std::right
+        << std::setw(10) << "count"
+        << std::setw(12) << "p50"
+        << std::setw(12) << "p99"
+        << std::setw(12) << "max" << std::endl;
+
+    out << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < static_cast<size_t>(Stage::Count); i++)
+    {
+        StageSummary s = histograms[i].summary();
+        if (s.count == 0)
+            continue;
+
+        out << std::left << std::setw(22) << stage_names[i] << std::right
+            << std::setw(10) << s.count
+            << std::setw(12) << s.p50_ns / 1000.0
+            << std::setw(12) << s.p99_ns / 1000.0
+            << std::setw(12) << s.max_ns / 1000.0 << std::endl;
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,124 @@
+#ifndef STAGE_STATS_H
+#define STAGE_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include "trace.h"
+
+// Стадии конвейера, для которых собираются гистограммы задержек
+enum class Stage
+{
+    DemuxRead,
+    VideoPacketWait,
+    AudioPacketWait,
+    VideoSendPacket,
+    VideoReceiveFrame,
+    AudioSendPacket,
+    AudioReceiveFrame,
+    VideoScale,
+    DamageCompare,
+    AudioResample,
+    AudioStretch,
+    DisplayHandoff,
+    GlUpload,
+    GlSwap,
+    ShmPublish,
+    AudioCallback,
+    Count
+};
+
+struct StageSummary
+{
+    uint64_t count = 0;
+    int64_t p50_ns = 0;
+    int64_t p99_ns = 0;
+    int64_t max_ns = 0;
+    int64_t mean_ns = 0;
+};
+
+// Лог-линейная гистограмма в духе HdrHistogram: 32 поддиапазона на каждую
+// степень двойки (~3% погрешности), запись без блокировок.
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BUCKET_BITS = 6;
+    static constexpr int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static constexpr int SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+    static constexpr int BUCKET_COUNT =
+        SUB_BUCKET_COUNT + (63 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_HALF;
+
+    void record(int64_t value_ns);
+    void reset();
+
+    uint64_t count() const;
+    int64_t max() const;
+    int64_t percentile(double p) const;
+    StageSummary summary() const;
+
+private:
+    static int bucket_index(uint64_t value);
+    static uint64_t bucket_midpoint(int index);
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<int64_t> max_{0};
+};
+
+LatencyHistogram& stage_histogram(Stage stage);
+const char* stage_name(Stage stage);
+StageSummary stage_summary(Stage stage);
+void reset_stage_stats();
+void dump_stage_stats(std::ostream& out);
+
+// Замеряет время жизни объекта и пишет его в гистограмму стадии
+// (и в таймлайн, если включена трассировка)
+class StageTimer
+{
+public:
+    explicit StageTimer(Stage stage)
+        : stage_(stage)
+        , start_(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~StageTimer()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        if (stopped_)
+            return;
+        stopped_ = true;
+        auto end = std::chrono::steady_clock::now();
+        stage_histogram(stage_).record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count());
+
+        if (trace_enabled())
+        {
+            trace_complete(stage_name(stage_), trace_ns(start_), trace_ns(end), TraceSpan::NO_PTS);
+        }
+    }
+
+    // Не записывать замер (например, если вызов вернул EAGAIN)
+    void cancel()
+    {
+        stopped_ = true;
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    Stage stage_;
+    std::chrono::steady_clock::time_point start_;
+    bool stopped_ = false;
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include "stream_source.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+namespace
+{
+    // Как часто поток чтения канала проверяет interrupt()
+    constexpr int POLL_INTERVAL_MS = 100;
+    // Порция одного чтения потока чтения и буфер AVIOContext демультиплексора
+    constexpr int IO_CHUNK_SIZE = 64 * 1024;
+    constexpr size_t MIN_RING_SIZE = 4 * IO_CHUNK_SIZE;
+}
+
+StreamSource::StreamSource(size_t buffer_bytes)
+    : ring_(std::max(buffer_bytes, MIN_RING_SIZE))
+{
+}
+
+StreamSource::~StreamSource()
+{
+    interrupt();
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+    
+    if (input_)
+    {
+        avio_closep(&input_);
+    }
+    if (owns_fd_)
+    {
+        ::close(fd_);
+    }
+    if (avio_)
+    {
+        // Буфер мог быть заменён libavformat, освобождаем текущий
+        av_freep(&avio_->buffer);
+        avio_context_free(&avio_);
+    }
+}
+
+bool StreamSource::is_stream_url(const std::string& url)
+{
+    static const char* const schemes[] = {"pipe:", "http://", "https://", "tcp://", "udp://",
+        "rtmp://", "srt://", "fd:"};
+    
+    if (url == "-")
+        return true;
+    for (const char* scheme : schemes)
+    {
+        if (url.compare(0, std::strlen(scheme), scheme) == 0)
+            return true;
+    }
+    
+    struct stat info;
+    return stat(url.c_str(), &info) == 0 && (S_ISFIFO(info.st_mode) || S_ISCHR(info.st_mode));
+}
+
+int StreamSource::interrupt_callback(void* opaque)
+{
+    return static_cast<StreamSource*>(opaque)->stopped_.load() ? 1 : 0;
+}
+
+bool StreamSource::open(const std::string& url)
+{
+    struct stat info;
+    if (url == "-" || url == "pipe:" || url == "pipe:0")
+    {
+        fd_ = STDIN_FILENO;
+    }
+    else if (url.compare(0, 5, "pipe:") == 0)
+    {
+        fd_ = std::atoi(url.c_str() + 5);
+    }
+    else if (stat(url.c_str(), &info) == 0 && S_ISFIFO(info.st_mode))
+    {
+        // Ждёт, пока канал не откроет писатель
+        fd_ = ::open(url.c_str(), O_RDONLY);
+        owns_fd_ = fd_ >= 0;
+        if (fd_ < 0)
+        {
+            std::cerr << "Could not open stream " << url << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    else
+    {
+        AVIOInterruptCB interrupt_cb{&StreamSource::interrupt_callback, this};
+        int ret = avio_open2(&input_, url.c_str(), AVIO_FLAG_READ, &interrupt_cb, nullptr);
+        if (ret < 0)
+        {
+            char message[AV_ERROR_MAX_STRING_SIZE] = {};
+            av_strerror(ret, message, sizeof(message));
+            std::cerr << "Could not open stream " << url << ": " << message << std::endl;
+            return false;
+        }
+    }
+    
+    uint8_t* buffer = static_cast<uint8_t*>(av_malloc(IO_CHUNK_SIZE));
+    if (buffer)
+    {
+        avio_ = avio_alloc_context(buffer, IO_CHUNK_SIZE, 0, this, &StreamSource::read_packet,
+            nullptr, nullptr);
+    }
+    if (!avio_)
+    {
+        std::cerr << "Could not allocate stream I/O context" << std::endl;
+        av_free(buffer);
+        return false;
+    }
+    avio_->seekable = 0;
+    
+    thread_ = std::thread(&StreamSource::io_loop, this);
+    return true;
+}
+
+void StreamSource::interrupt()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+        space_cv_.notify_all();
+        data_cv_.notify_all();
+        async_data_cv_.notify_all();
+    }
+}
+
+int StreamSource::read_input(uint8_t* buffer, int size)
+{
+    if (fd_ < 0)
+    {
+        // Блокирует, interrupt() прерывает его через interrupt_callback
+        return avio_read_partial(input_, buffer, size);
+    }
+    
+    while (!stopped_)
+    {
+        pollfd descriptor{fd_, POLLIN, 0};
+        int ready = poll(&descriptor, 1, POLL_INTERVAL_MS);
+        if (ready == 0 || (ready < 0 && errno == EINTR))
+            continue;
+        if (ready < 0)
+            return AVERROR(errno);
+        
+        ssize_t received = ::read(fd_, buffer, size);
+        if (received > 0)
+            return static_cast<int>(received);
+        if (received == 0)
+            return AVERROR_EOF;
+        if (errno != EINTR && errno != EAGAIN)
+            return AVERROR(errno);
+    }
+    return AVERROR_EXIT;
+}
+
+void StreamSource::io_loop()
+{
+    std::vector<uint8_t> chunk(IO_CHUNK_SIZE);
+    
+    while (!stopped_)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            space_cv_.wait(lock, [this]
+            {
+                return stopped_ || ring_.size() - size_ >= static_cast<size_t>(IO_CHUNK_SIZE);
+            });
+            if (stopped_)
+                break;
+        }
+        
+        int received = read_input(chunk.data(), static_cast<int>(chunk.size()));
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (received <= 0)
+        {
+            if (received != AVERROR_EOF && received != AVERROR_EXIT && !stopped_)
+            {
+                std::cerr << "Stream read failed: " << received << std::endl;
+            }
+            eof_ = true;
+        }
+        else
+        {
+            size_t tail = (head_ + size_) % ring_.size();
+            size_t first = std::min(static_cast<size_t>(received), ring_.size() - tail);
+            std::memcpy(ring_.data() + tail, chunk.data(), first);
+            std::memcpy(ring_.data(), chunk.data() + first, received - first);
+            size_ += received;
+            bytes_received_ += received;
+        }
+        data_cv_.notify_all();
+        async_data_cv_.notify_all();
+        if (eof_)
+            break;
+    }
+}
+
+int StreamSource::read_packet(void* opaque, uint8_t* buffer, int size)
+{
+    StreamSource* self = static_cast<StreamSource*>(opaque);
+    std::unique_lock<std::mutex> lock(self->mutex_);
+    
+    if (self->size_ == 0 && !self->eof_ && !self->stopped_)
+    {
+        // Сюда попадаем только при разборе заголовков или если пакет
+        // оказался больше ожидаемого — тогда приходится ждать на месте
+        self->read_stalls_++;
+        self->data_cv_.wait(lock, [self]
+        {
+            return self->size_ > 0 || self->eof_ || self->stopped_;
+        });
+    }
+    
+    if (self->size_ == 0)
+    {
+        return self->stopped_ ? AVERROR_EXIT : AVERROR_EOF;
+    }
+    
+    size_t count = std::min(static_cast<size_t>(size), self->size_);
+    size_t first = std::min(count, self->ring_.size() - self->head_);
+    std::memcpy(buffer, self->ring_.data() + self->head_, first);
+    std::memcpy(buffer + first, self->ring_.data(), count - first);
+    self->head_ = (self->head_ + count) % self->ring_.size();
+    self->size_ -= count;
+    self->space_cv_.notify_one();
+    return static_cast<int>(count);
+}
+
+bool StreamSource::readable_locked(size_t min_bytes) const
+{
+    return size_ >= std::min(min_bytes, ring_.size() / 2) || eof_ || stopped_;
+}
+
+StreamSourceStats StreamSource::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    StreamSourceStats result;
+    result.bytes_received = bytes_received_;
+    result.bytes_buffered = size_;
+    result.read_stalls = read_stalls_;
+    return result;
+}
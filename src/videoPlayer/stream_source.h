@@ -0,0 +1,100 @@
+#ifndef STREAM_SOURCE_H
+#define STREAM_SOURCE_H
+
+#include "task_scheduler.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C"
+{
+#include <libavformat/avio.h>
+}
+
+struct StreamSourceStats
+{
+    uint64_t bytes_received = 0;
+    size_t bytes_buffered = 0;
+    // Сколько раз чтение libavformat упёрлось в пустой буфер и ждало
+    uint64_t read_stalls = 0;
+};
+
+// Потоковый вход (pipe:, stdin, http://, tcp:// ...). Сеть и канал читает
+// отдельный поток в кольцевой буфер байтов, а демультиплексор получает
+// AVIOContext поверх этого буфера. Так пауза в доставке не держит поток
+// пула внутри av_read_frame: задача демультиплексора ждёт данных через
+// data_condition() и отдаёт поток другим задачам.
+class StreamSource
+{
+public:
+    explicit StreamSource(size_t buffer_bytes);
+    ~StreamSource();
+
+    StreamSource(const StreamSource&) = delete;
+    StreamSource& operator=(const StreamSource&) = delete;
+
+    // Открывает url и запускает поток чтения. "-" — стандартный ввод
+    bool open(const std::string& url);
+    // Прерывает чтение; после этого источник отдаёт только конец потока
+    void interrupt();
+
+    // Для AVFormatContext::pb (с AVFMT_FLAG_CUSTOM_IO), без перемотки
+    AVIOContext* avio() const
+    {
+        return avio_;
+    }
+
+    // Демультиплексор ждёт под mutex() на data_condition(), пока
+    // readable_locked() не вернёт true, чтобы следующий av_read_frame не
+    // заблокировал поток пула
+    std::mutex& mutex()
+    {
+        return mutex_;
+    }
+    AsyncCondition& data_condition()
+    {
+        return async_data_cv_;
+    }
+    // В буфере хотя бы min_bytes, либо поток кончился или прерван
+    bool readable_locked(size_t min_bytes) const;
+
+    StreamSourceStats stats() const;
+
+    // http://, pipe:, "-", именованный канал и т.п.
+    static bool is_stream_url(const std::string& url);
+
+private:
+    static int read_packet(void* opaque, uint8_t* buffer, int size);
+    static int interrupt_callback(void* opaque);
+    void io_loop();
+    int read_input(uint8_t* buffer, int size);
+
+    std::vector<uint8_t> ring_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+    bool eof_ = false;
+    uint64_t bytes_received_ = 0;
+    uint64_t read_stalls_ = 0;
+
+    mutable std::mutex mutex_;
+    std::condition_variable space_cv_;
+    std::condition_variable data_cv_;
+    AsyncCondition async_data_cv_;
+    std::atomic<bool> stopped_{false};
+
+    // Канал или stdin читаем сами через poll, чтобы interrupt() не ждал
+    // данных от писателя; остальное — через протоколы libavformat
+    int fd_ = -1;
+    bool owns_fd_ = false;
+    AVIOContext* input_ = nullptr;
+    AVIOContext* avio_ = nullptr;
+    std::thread thread_;
+};
+
+#endif
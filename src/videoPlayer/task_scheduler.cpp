@@ -0,0 +1,190 @@
+#include "task_scheduler.h"
+#include "thread_budget.h"
+#include "trace.h"
+
+#include <algorithm>
+
+namespace
+{
+    thread_local TaskScheduler* t_scheduler = nullptr;
+    thread_local size_t t_worker_index = 0;
+}
+
+void PipelineTask::promise_type::FinalAwaiter::await_suspend(
+    std::coroutine_handle<promise_type> handle) noexcept
+{
+    TaskGroup* group = handle.promise().group;
+    handle.destroy();
+    if (group)
+    {
+        group->done();
+    }
+}
+
+TaskScheduler::TaskScheduler(int threads)
+{
+    threads = std::max(1, threads);
+    for (int i = 0; i < threads; i++)
+    {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < threads; i++)
+    {
+        workers_[i]->thread = std::thread(&TaskScheduler::worker_loop, this, static_cast<size_t>(i));
+    }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    sleep_cv_.notify_all();
+
+    for (auto& worker : workers_)
+    {
+        if (worker->thread.joinable())
+        {
+            worker->thread.join();
+        }
+    }
+}
+
+TaskScheduler* TaskScheduler::current()
+{
+    return t_scheduler;
+}
+
+void TaskScheduler::spawn(PipelineTask task, TaskGroup& group)
+{
+    auto handle = task.release();
+    handle.promise().group = &group;
+    group.add();
+    schedule(handle);
+}
+
+void TaskScheduler::schedule(std::coroutine_handle<> handle)
+{
+    // Из своего потока — в свою очередь (там кеш тёплый), извне — по кругу
+    size_t index = t_scheduler == this
+        ? t_worker_index
+        : next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+
+    {
+        std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+        workers_[index]->ready.push_back(handle);
+    }
+    ready_count_.fetch_add(1, std::memory_order_release);
+
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+}
+
+void TaskScheduler::schedule_at(std::coroutine_handle<> handle, Clock::time_point when)
+{
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        earliest = timers_.empty() || when < timers_.top().when;
+        timers_.push(Timer{when, handle});
+    }
+    // Спящему потоку нужно пересчитать время пробуждения
+    if (earliest)
+    {
+        sleep_cv_.notify_one();
+    }
+}
+
+std::coroutine_handle<> TaskScheduler::take_task(size_t index)
+{
+    // Своя очередь — FIFO: задачи, отдавшие поток через yield, идут по кругу
+    {
+        Worker& own = *workers_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.ready.empty())
+        {
+            auto handle = own.ready.front();
+            own.ready.pop_front();
+            return handle;
+        }
+    }
+
+    // Чужие — с хвоста, чтобы меньше толкаться с владельцем
+    for (size_t i = 1; i < workers_.size(); i++)
+    {
+        Worker& victim = *workers_[(index + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.ready.empty())
+        {
+            auto handle = victim.ready.back();
+            victim.ready.pop_back();
+            return handle;
+        }
+    }
+
+    return nullptr;
+}
+
+void TaskScheduler::fire_timers()
+{
+    std::vector<std::coroutine_handle<>> due;
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        auto now = Clock::now();
+        while (!timers_.empty() && timers_.top().when <= now)
+        {
+            due.push_back(timers_.top().handle);
+            timers_.pop();
+        }
+    }
+    for (auto handle : due)
+    {
+        schedule(handle);
+    }
+}
+
+void TaskScheduler::worker_loop(size_t index)
+{
+    t_scheduler = this;
+    t_worker_index = index;
+    trace_set_thread_name("pipeline_worker");
+    apply_thread_role(ThreadRole::Worker);
+
+    while (true)
+    {
+        fire_timers();
+
+        if (auto handle = take_task(index))
+        {
+            ready_count_.fetch_sub(1, std::memory_order_acq_rel);
+            handle.resume();
+            // Между задачами выделения относятся к самому пулу
+            set_alloc_stage(AllocStage::Other);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        if (stopping_)
+            break;
+
+        // Проверка под sleep_mutex_: schedule() берёт его перед notify,
+        // так что пробуждение не потеряется
+        if (ready_count_.load(std::memory_order_acquire) > 0)
+            continue;
+
+        // Без предиката: после notify заново посчитаем срок ближайшего таймера
+        if (timers_.empty())
+        {
+            sleep_cv_.wait(lock);
+        }
+        else if (timers_.top().when > Clock::now())
+        {
+            sleep_cv_.wait_until(lock, timers_.top().when);
+        }
+    }
+
+    t_scheduler = nullptr;
+}
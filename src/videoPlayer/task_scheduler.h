@@ -0,0 +1,334 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "alloc_profile.h"
+
+class TaskGroup;
+
+// Стадия конвейера в виде корутины. Создаётся приостановленной и
+// запускается через TaskScheduler::spawn; кадр корутины освобождается
+// сам после завершения.
+class PipelineTask
+{
+public:
+    struct promise_type
+    {
+        TaskGroup* group = nullptr;
+
+        PipelineTask get_return_object()
+        {
+            return PipelineTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+
+            void await_resume() noexcept
+            {
+            }
+        };
+
+        FinalAwaiter final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void()
+        {
+        }
+
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+
+    PipelineTask(PipelineTask&& other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr))
+    {
+    }
+
+    PipelineTask(const PipelineTask&) = delete;
+    PipelineTask& operator=(const PipelineTask&) = delete;
+
+    ~PipelineTask()
+    {
+        // Задача, которую так и не запустили
+        if (handle_)
+        {
+            handle_.destroy();
+        }
+    }
+
+    std::coroutine_handle<promise_type> release()
+    {
+        return std::exchange(handle_, nullptr);
+    }
+
+private:
+    explicit PipelineTask(std::coroutine_handle<promise_type> handle)
+        : handle_(handle)
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// Счётчик незавершённых задач; wait() вызывается из потока вне пула
+class TaskGroup
+{
+public:
+    void add()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_++;
+    }
+
+    void done()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0)
+        {
+            cv_.notify_all();
+        }
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return pending_ == 0; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int pending_ = 0;
+};
+
+// Пул с перехватом работы: у каждого рабочего потока своя очередь
+// готовых корутин, свободный поток забирает задачи у соседей. Один пул
+// может обслуживать стадии любого числа плееров. Перед разрушением пула
+// все запущенные в нём задачи должны завершиться.
+class TaskScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TaskScheduler(int threads);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    int thread_count() const
+    {
+        return static_cast<int>(workers_.size());
+    }
+
+    void spawn(PipelineTask task, TaskGroup& group);
+
+    // Можно вызывать из любого потока, в том числе не из пула
+    void schedule(std::coroutine_handle<> handle);
+    void schedule_at(std::coroutine_handle<> handle, Clock::time_point when);
+
+    // co_await scheduler.yield() — отдать поток другим готовым задачам
+    [[nodiscard]] auto yield()
+    {
+        struct Awaiter
+        {
+            TaskScheduler& scheduler;
+            AllocStage stage = alloc_stage();
+
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                scheduler.schedule(handle);
+            }
+
+            void await_resume() noexcept
+            {
+                set_alloc_stage(stage);
+            }
+        };
+        return Awaiter{*this};
+    }
+
+    // co_await scheduler.sleep_until(t) — поток пула при этом не занят
+    [[nodiscard]] auto sleep_until(Clock::time_point when)
+    {
+        struct Awaiter
+        {
+            TaskScheduler& scheduler;
+            Clock::time_point when;
+            AllocStage stage = alloc_stage();
+
+            bool await_ready() noexcept
+            {
+                return when <= Clock::now();
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                scheduler.schedule_at(handle, when);
+            }
+
+            void await_resume() noexcept
+            {
+                set_alloc_stage(stage);
+            }
+        };
+        return Awaiter{*this, when};
+    }
+
+    // Пул, которому принадлежит текущий поток (nullptr вне пула)
+    static TaskScheduler* current();
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<std::coroutine_handle<>> ready;
+        std::thread thread;
+    };
+
+    struct Timer
+    {
+        Clock::time_point when;
+        std::coroutine_handle<> handle;
+
+        bool operator>(const Timer& other) const
+        {
+            return when > other.when;
+        }
+    };
+
+    void worker_loop(size_t index);
+    std::coroutine_handle<> take_task(size_t index);
+    void fire_timers();
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_worker_{0};
+    std::atomic<int64_t> ready_count_{0};
+    std::atomic<bool> stopping_{false};
+
+    // Спящие потоки и таймеры
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+};
+
+// Аналог condition_variable для корутин: ожидающая задача не блокирует
+// поток пула, а снова ставится в очередь при notify. Как и с
+// condition_variable, состояние меняется под тем же мьютексом, под
+// которым проверяется условие, а после пробуждения условие проверяется
+// заново. notify можно вызывать из любого потока (например, из audio callback).
+class AsyncCondition
+{
+public:
+    [[nodiscard]] auto wait(std::unique_lock<std::mutex>& lock)
+    {
+        struct Awaiter
+        {
+            AsyncCondition& condition;
+            std::unique_lock<std::mutex>& lock;
+            std::mutex* mutex = nullptr;
+            AllocStage stage = alloc_stage();
+
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                std::mutex* held = lock.release();
+                mutex = held;
+                {
+                    std::lock_guard<std::mutex> guard(condition.waiters_mutex_);
+                    condition.waiters_.push_back(Waiter{handle, TaskScheduler::current()});
+                }
+                // С этого момента корутину может возобновить другой поток,
+                // поэтому кадр корутины здесь больше не трогаем
+                held->unlock();
+            }
+
+            void await_resume()
+            {
+                set_alloc_stage(stage);
+                lock = std::unique_lock<std::mutex>(*mutex);
+            }
+        };
+        return Awaiter{*this, lock};
+    }
+
+    void notify_one()
+    {
+        notify(false);
+    }
+
+    void notify_all()
+    {
+        notify(true);
+    }
+
+private:
+    struct Waiter
+    {
+        std::coroutine_handle<> handle;
+        TaskScheduler* scheduler;
+    };
+
+    void notify(bool all)
+    {
+        std::vector<Waiter> woken;
+        {
+            std::lock_guard<std::mutex> guard(waiters_mutex_);
+            if (all)
+            {
+                woken.swap(waiters_);
+            }
+            else if (!waiters_.empty())
+            {
+                woken.push_back(waiters_.front());
+                waiters_.erase(waiters_.begin());
+            }
+        }
+        for (const Waiter& waiter : woken)
+        {
+            waiter.scheduler->schedule(waiter.handle);
+        }
+    }
+
+    std::mutex waiters_mutex_;
+    std::vector<Waiter> waiters_;
+};
+
+#endif
@@ -0,0 +1,368 @@
+#include "thread_budget.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#if defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/prctl.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#elif defined(__APPLE__)
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/resource.h>
+    #include <sys/sysctl.h>
+#endif
+
+namespace
+{
+    // libavcodec не рекомендует больше 16 потоков на декодер
+    constexpr int MAX_DECODE_THREADS = 16;
+    // Приоритеты SCHED_FIFO держим низкими, чтобы не вытеснять потоки ядра
+    constexpr int PRESENTER_RT_PRIORITY = 5;
+    constexpr int AUDIO_RT_PRIORITY = 10;
+    constexpr int PRESENTER_NICE = -5;
+    constexpr int AUDIO_NICE = -10;
+
+    ThreadBudget g_budget;
+
+    thread_local int t_applied_role = -1;
+
+    void warn_once(std::atomic<bool>& flag, const std::string& message)
+    {
+        if (!flag.exchange(true))
+        {
+            std::cerr << message << std::endl;
+        }
+    }
+
+    std::string format_cpus(const std::vector<int>& cpus)
+    {
+        std::ostringstream out;
+        for (size_t i = 0; i < cpus.size(); i++)
+        {
+            out << (i ? "," : "") << cpus[i];
+        }
+        return out.str();
+    }
+
+#if defined(__linux__)
+    bool read_sysfs(const std::string& path, std::string& value)
+    {
+        std::ifstream in(path);
+        return static_cast<bool>(std::getline(in, value));
+    }
+
+    // Кеш самого высокого уровня, которым владеет CPU; ключ — shared_cpu_list
+    std::string llc_key(int cpu)
+    {
+        std::string best_key;
+        int best_level = 0;
+        for (int index = 0; index < 8; index++)
+        {
+            std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                "/cache/index" + std::to_string(index) + "/";
+            std::string level;
+            std::string shared;
+            if (!read_sysfs(base + "level", level))
+                break;
+            if (read_sysfs(base + "shared_cpu_list", shared) && std::atoi(level.c_str()) > best_level)
+            {
+                best_level = std::atoi(level.c_str());
+                best_key = shared;
+            }
+        }
+        return best_key;
+    }
+
+    bool set_affinity(const std::vector<int>& cpus)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+        {
+            CPU_SET(cpu, &set);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    bool set_nice(int nice)
+    {
+        // В Linux nice у каждого потока свой, адресуется через tid
+        return setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), nice) == 0;
+    }
+#else
+    bool set_affinity(const std::vector<int>&)
+    {
+        // В macOS нет жёсткой привязки потоков к CPU
+        return false;
+    }
+
+    bool set_nice(int)
+    {
+        return false;
+    }
+#endif
+
+    bool set_realtime(int priority)
+    {
+#if defined(__linux__) || defined(__APPLE__)
+        sched_param param{};
+        param.sched_priority = sched_get_priority_min(SCHED_FIFO) + priority;
+        return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#else
+        return false;
+#endif
+    }
+}
+
+CpuTopology detect_cpu_topology()
+{
+    CpuTopology topology;
+
+#if defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        std::map<std::pair<int, int>, size_t> core_index;
+        std::map<std::string, size_t> llc_index;
+
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (!CPU_ISSET(cpu, &allowed))
+                continue;
+
+            std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+            std::string package = "0";
+            std::string core = std::to_string(cpu);
+            read_sysfs(base + "physical_package_id", package);
+            read_sysfs(base + "core_id", core);
+
+            auto key = std::make_pair(std::atoi(package.c_str()), std::atoi(core.c_str()));
+            auto it = core_index.find(key);
+            if (it != core_index.end())
+            {
+                topology.cores[it->second].push_back(cpu);
+                continue;
+            }
+
+            core_index[key] = topology.cores.size();
+            topology.cores.push_back({cpu});
+
+            std::string llc = llc_key(cpu);
+            auto domain = llc_index.find(llc);
+            if (domain == llc_index.end())
+            {
+                llc_index[llc] = topology.llc_domains.size();
+                topology.llc_domains.push_back({static_cast<int>(topology.cores.size() - 1)});
+            }
+            else
+            {
+                topology.llc_domains[domain->second].push_back(static_cast<int>(topology.cores.size() - 1));
+            }
+        }
+
+        topology.pinnable = !topology.cores.empty();
+    }
+#elif defined(__APPLE__)
+    int physical = 0;
+    int logical = 0;
+    size_t size = sizeof(int);
+    if (sysctlbyname("hw.physicalcpu", &physical, &size, nullptr, 0) == 0 &&
+        sysctlbyname("hw.logicalcpu", &logical, &size, nullptr, 0) == 0 && physical > 0)
+    {
+        int smt = std::max(1, logical / physical);
+        for (int core = 0; core < physical; core++)
+        {
+            std::vector<int> siblings;
+            for (int t = 0; t < smt; t++)
+            {
+                siblings.push_back(core * smt + t);
+            }
+            topology.cores.push_back(siblings);
+        }
+    }
+#endif
+
+    if (topology.cores.empty())
+    {
+        int count = std::max(1u, std::thread::hardware_concurrency());
+        for (int cpu = 0; cpu < count; cpu++)
+        {
+            topology.cores.push_back({cpu});
+        }
+    }
+
+    if (topology.llc_domains.empty())
+    {
+        topology.llc_domains.emplace_back();
+        for (size_t i = 0; i < topology.cores.size(); i++)
+        {
+            topology.llc_domains.back().push_back(static_cast<int>(i));
+        }
+    }
+
+    topology.logical_cpus = 0;
+    for (const auto& core : topology.cores)
+    {
+        topology.logical_cpus += static_cast<int>(core.size());
+    }
+    return topology;
+}
+
+ThreadBudget plan_thread_budget(const CpuTopology& topology, const ThreadBudgetOptions& options)
+{
+    ThreadBudget budget;
+    budget.realtime = options.realtime;
+
+    int cores = static_cast<int>(topology.cores.size());
+
+    // На 4+ ядрах последнее ядро отдаём audio callback и презентеру: оба
+    // почти всё время спят, но должны просыпаться вовремя
+    int reserved = -1;
+    if (options.pin_threads && topology.pinnable && cores >= 4)
+    {
+        reserved = cores - 1;
+        const std::vector<int>& siblings = topology.cores[reserved];
+        budget.presenter_cpus = {siblings.front()};
+        budget.audio_cpus = {siblings.back()};
+
+        for (int i = 0; i < reserved; i++)
+        {
+            budget.worker_cpus.insert(budget.worker_cpus.end(),
+                topology.cores[i].begin(), topology.cores[i].end());
+        }
+        std::sort(budget.worker_cpus.begin(), budget.worker_cpus.end());
+    }
+
+    int available = reserved >= 0 ? cores - 1 : cores;
+
+    // Одно ядро уходит потоку видео: он гоняет декодер, sws_scale и
+    // выдерживает паузы до pts. Остальное делим между потоками libavcodec
+    // и frameDisplayer. Считаем физические ядра: SMT-сиблинги дают
+    // прирост пропускной способности, но не стабильное время кадра.
+    int rest = available >= 3 ? available - 1 : available;
+    budget.decode_threads = std::max(1, (rest + 1) / 2);
+    budget.displayer_threads = std::max(1, rest - budget.decode_threads);
+
+    // Потоки кадрового параллелизма обмениваются опорными кадрами, поэтому
+    // не выходим за один домен общего кеша
+    size_t largest_llc = 1;
+    for (const auto& domain : topology.llc_domains)
+    {
+        largest_llc = std::max(largest_llc, domain.size());
+    }
+    budget.decode_threads = std::min({budget.decode_threads, static_cast<int>(largest_llc), MAX_DECODE_THREADS});
+
+    return budget;
+}
+
+std::string describe_thread_budget(const CpuTopology& topology, const ThreadBudget& budget)
+{
+    std::ostringstream out;
+    out << "CPU topology: " << topology.logical_cpus << " logical CPUs, "
+        << topology.cores.size() << " cores, " << topology.llc_domains.size() << " LLC domain(s)" << std::endl
+        << "Thread budget: decode " << budget.decode_threads
+        << ", displayer " << budget.displayer_threads;
+
+    if (!budget.worker_cpus.empty())
+    {
+        out << ", workers on [" << format_cpus(budget.worker_cpus) << "]"
+            << ", presenter on [" << format_cpus(budget.presenter_cpus) << "]"
+            << ", audio on [" << format_cpus(budget.audio_cpus) << "]";
+    }
+    if (budget.realtime)
+    {
+        out << ", realtime priorities requested";
+    }
+    return out.str();
+}
+
+void set_thread_budget(const ThreadBudget& budget)
+{
+    g_budget = budget;
+}
+
+const ThreadBudget& thread_budget()
+{
+    return g_budget;
+}
+
+void apply_thread_role(ThreadRole role)
+{
+    if (t_applied_role == static_cast<int>(role))
+        return;
+    t_applied_role = static_cast<int>(role);
+
+    static std::atomic<bool> affinity_warned{false};
+    static std::atomic<bool> realtime_warned{false};
+
+    const std::vector<int>* cpus = &g_budget.worker_cpus;
+    int rt_priority = 0;
+    int nice = 0;
+    if (role == ThreadRole::Presenter)
+    {
+        cpus = &g_budget.presenter_cpus;
+        rt_priority = PRESENTER_RT_PRIORITY;
+        nice = PRESENTER_NICE;
+    }
+    else if (role == ThreadRole::AudioCallback)
+    {
+        cpus = &g_budget.audio_cpus;
+        rt_priority = AUDIO_RT_PRIORITY;
+        nice = AUDIO_NICE;
+    }
+
+    if (!cpus->empty() && !set_affinity(*cpus))
+    {
+        warn_once(affinity_warned, "Could not pin threads to CPUs [" + format_cpus(*cpus) + "]");
+    }
+
+    if (!g_budget.realtime || role == ThreadRole::Worker)
+        return;
+
+    if (set_realtime(rt_priority))
+        return;
+
+    // Без CAP_SYS_NICE / RLIMIT_RTPRIO остаётся только nice
+    if (!set_nice(nice))
+    {
+        warn_once(realtime_warned, "Realtime priority and negative niceness are not permitted, "
+            "latency-critical threads run with default priority");
+    }
+}
+
+void set_timer_slack(std::chrono::nanoseconds slack)
+{
+#if defined(__linux__)
+    // 0 возвращает допуск по умолчанию (50 мкс)
+    prctl(PR_SET_TIMERSLACK, static_cast<unsigned long>(slack.count()), 0, 0, 0);
+#else
+    (void)slack;
+#endif
+}
+
+CpuUsage sample_cpu_usage()
+{
+    CpuUsage sample;
+    sample.time = std::chrono::steady_clock::now();
+
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        sample.cpu_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+            usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+        sample.wakeups = static_cast<uint64_t>(usage.ru_nvcsw);
+    }
+    return sample;
+}
@@ -0,0 +1,84 @@
+#ifndef THREAD_BUDGET_H
+#define THREAD_BUDGET_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Доступные процессу логические CPU (с учётом taskset/cgroup),
+// сгруппированные по физическим ядрам и общему кешу последнего уровня
+struct CpuTopology
+{
+    int logical_cpus = 1;
+    // cores[i] — логические CPU одного физического ядра (SMT-сиблинги)
+    std::vector<std::vector<int>> cores;
+    // llc_domains[i] — индексы в cores, у которых общий L3 (или L2, если L3 нет)
+    std::vector<std::vector<int>> llc_domains;
+    // false, если номера CPU синтетические и к ним нельзя привязаться
+    bool pinnable = false;
+};
+
+CpuTopology detect_cpu_topology();
+
+struct ThreadBudgetOptions
+{
+    // Выделить ядро под audio callback и презентер и привязать к нему потоки
+    bool pin_threads = false;
+    // Попросить SCHED_FIFO (или пониженный nice) для критичных по задержке потоков
+    bool realtime = false;
+};
+
+struct ThreadBudget
+{
+    // thread_count видеодекодера libavcodec
+    int decode_threads = 1;
+    // SetThreadCount у frameDisplayer
+    int displayer_threads = 1;
+
+    // Пустой список — поток роли не привязывается
+    std::vector<int> worker_cpus;
+    std::vector<int> presenter_cpus;
+    std::vector<int> audio_cpus;
+
+    bool realtime = false;
+};
+
+enum class ThreadRole
+{
+    // Демуксер, декодеры, конвертация и внутренние потоки libavcodec
+    Worker,
+    // Поток, в котором крутится цикл frameDisplayer
+    Presenter,
+    AudioCallback
+};
+
+ThreadBudget plan_thread_budget(const CpuTopology& topology, const ThreadBudgetOptions& options);
+std::string describe_thread_budget(const CpuTopology& topology, const ThreadBudget& budget);
+
+// Бюджет задаётся один раз при старте, до запуска потоков конвейера
+void set_thread_budget(const ThreadBudget& budget);
+const ThreadBudget& thread_budget();
+
+// Привязывает вызывающий поток к CPU роли и поднимает приоритет, если это
+// разрешено. Потоки, созданные после вызова, наследуют привязку.
+// Повторный вызов с той же ролью в том же потоке ничего не делает.
+void apply_thread_role(ThreadRole role);
+
+// Допуск срабатывания таймеров вызывающего потока (prctl PR_SET_TIMERSLACK,
+// только Linux): ядро откладывает пробуждение в его пределах и совмещает
+// с соседними. Потоки, созданные после вызова, наследуют допуск
+void set_timer_slack(std::chrono::nanoseconds slack);
+
+// Процессорное время и добровольные переключения контекста (засыпания с
+// последующим пробуждением) всего процесса с его старта
+struct CpuUsage
+{
+    double cpu_seconds = 0.0;
+    uint64_t wakeups = 0;
+    std::chrono::steady_clock::time_point time;
+};
+
+CpuUsage sample_cpu_usage();
+
+#endif
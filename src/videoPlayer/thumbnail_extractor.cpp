@@ -0,0 +1,366 @@
+#include "thumbnail_extractor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <numeric>
+#include <thread>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+
+namespace
+{
+    // Столько соседних меток рабочий поток забирает за раз
+    constexpr size_t TIMESTAMPS_PER_BLOCK = 4;
+    // Если следующая метка ближе, декодируем вперёд без перехода:
+    // типичный GOP короче, и переход всё равно вернул бы нас назад
+    constexpr double FORWARD_DECODE_LIMIT_SECONDS = 2.0;
+
+    class ThumbnailDecoder
+    {
+    public:
+        ~ThumbnailDecoder()
+        {
+            sws_freeContext(sws_ctx_);
+            av_frame_free(&frame_);
+            av_frame_free(&next_);
+            av_packet_free(&packet_);
+            avcodec_free_context(&codec_ctx_);
+            avformat_close_input(&format_ctx_);
+        }
+
+        bool open(const std::string& path)
+        {
+            if (avformat_open_input(&format_ctx_, path.c_str(), nullptr, nullptr) != 0 ||
+                avformat_find_stream_info(format_ctx_, nullptr) < 0)
+            {
+                std::cerr << "Could not open video file: " << path << std::endl;
+                return false;
+            }
+
+            const AVCodec* codec = nullptr;
+            stream_index_ = av_find_best_stream(format_ctx_, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+            if (stream_index_ < 0 || !codec)
+            {
+                std::cerr << "Could not find video stream" << std::endl;
+                return false;
+            }
+
+            AVStream* stream = format_ctx_->streams[stream_index_];
+            codec_ctx_ = avcodec_alloc_context3(codec);
+            if (!codec_ctx_ || avcodec_parameters_to_context(codec_ctx_, stream->codecpar) < 0)
+                return false;
+
+            // Параллельность даёт число рабочих потоков, а не потоки декодера
+            codec_ctx_->thread_count = 1;
+            if (avcodec_open2(codec_ctx_, codec, nullptr) < 0)
+            {
+                std::cerr << "Could not open video codec" << std::endl;
+                return false;
+            }
+
+            time_base_ = av_q2d(stream->time_base);
+            start_pts_ = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+
+            frame_ = av_frame_alloc();
+            next_ = av_frame_alloc();
+            packet_ = av_packet_alloc();
+            return frame_ && next_ && packet_;
+        }
+
+        // Первый кадр с pts >= seconds (или последний кадр файла)
+        bool frame_at(double seconds)
+        {
+            int64_t target = start_pts_ + static_cast<int64_t>(std::llround(seconds / time_base_));
+
+            if (have_frame_ && frame_pts_ >= target)
+                return true;
+
+            bool close_ahead = have_frame_ && !eof_ &&
+                (target - frame_pts_) * time_base_ <= FORWARD_DECODE_LIMIT_SECONDS;
+            if (!close_ahead)
+            {
+                if (av_seek_frame(format_ctx_, stream_index_, target, AVSEEK_FLAG_BACKWARD) < 0)
+                {
+                    // Без индекса переход может не удаться; тогда читаем с начала
+                    av_seek_frame(format_ctx_, stream_index_, start_pts_, AVSEEK_FLAG_BACKWARD);
+                }
+                avcodec_flush_buffers(codec_ctx_);
+                have_frame_ = false;
+                eof_ = false;
+            }
+
+            while (!have_frame_ || frame_pts_ < target)
+            {
+                if (!decode_next())
+                    return have_frame_;
+            }
+            return true;
+        }
+
+        double frame_seconds() const
+        {
+            return (frame_pts_ - start_pts_) * time_base_;
+        }
+
+        bool scale(const ThumbnailOptions& options, Thumbnail& thumbnail)
+        {
+            int src_w = frame_->width;
+            int src_h = frame_->height;
+            int dst_w = options.width;
+            int dst_h = options.height;
+            if (dst_w <= 0 && dst_h <= 0)
+            {
+                dst_w = src_w;
+                dst_h = src_h;
+            }
+            else if (dst_h <= 0)
+            {
+                dst_h = std::max(2, static_cast<int>(std::lround(static_cast<double>(dst_w) * src_h / src_w)) & ~1);
+            }
+            else if (dst_w <= 0)
+            {
+                dst_w = std::max(2, static_cast<int>(std::lround(static_cast<double>(dst_h) * src_w / src_h)) & ~1);
+            }
+
+            sws_ctx_ = sws_getCachedContext(sws_ctx_, src_w, src_h,
+                static_cast<AVPixelFormat>(frame_->format), dst_w, dst_h, AV_PIX_FMT_RGB24,
+                SWS_BICUBIC, nullptr, nullptr, nullptr);
+            if (!sws_ctx_)
+            {
+                std::cerr << "Failed to create sws context" << std::endl;
+                return false;
+            }
+
+            thumbnail.width = dst_w;
+            thumbnail.height = dst_h;
+            thumbnail.rgb.resize(static_cast<size_t>(dst_w) * dst_h * 3);
+
+            uint8_t* dst_data[4] = {thumbnail.rgb.data(), nullptr, nullptr, nullptr};
+            int dst_linesize[4] = {dst_w * 3, 0, 0, 0};
+            sws_scale(sws_ctx_, frame_->data, frame_->linesize, 0, src_h, dst_data, dst_linesize);
+            return true;
+        }
+
+    private:
+        // false — файл кончился, в frame_ остаётся последний кадр
+        bool decode_next()
+        {
+            while (true)
+            {
+                int ret = avcodec_receive_frame(codec_ctx_, next_);
+                if (ret == 0)
+                {
+                    av_frame_unref(frame_);
+                    av_frame_move_ref(frame_, next_);
+                    frame_pts_ = frame_->best_effort_timestamp != AV_NOPTS_VALUE
+                        ? frame_->best_effort_timestamp
+                        : frame_->pts;
+                    have_frame_ = true;
+                    return true;
+                }
+                if (ret != AVERROR(EAGAIN))
+                {
+                    eof_ = true;
+                    return false;
+                }
+
+                if (av_read_frame(format_ctx_, packet_) < 0)
+                {
+                    // Вытаскиваем задержанные в декодере кадры
+                    avcodec_send_packet(codec_ctx_, nullptr);
+                    continue;
+                }
+
+                if (packet_->stream_index == stream_index_)
+                {
+                    avcodec_send_packet(codec_ctx_, packet_);
+                }
+                av_packet_unref(packet_);
+            }
+        }
+
+        AVFormatContext* format_ctx_ = nullptr;
+        AVCodecContext* codec_ctx_ = nullptr;
+        SwsContext* sws_ctx_ = nullptr;
+        AVFrame* frame_ = nullptr;
+        AVFrame* next_ = nullptr;
+        AVPacket* packet_ = nullptr;
+        int stream_index_ = -1;
+        double time_base_ = 0.0;
+        int64_t start_pts_ = 0;
+        int64_t frame_pts_ = 0;
+        bool have_frame_ = false;
+        bool eof_ = false;
+    };
+
+    bool encode_png(const Thumbnail& thumbnail, std::vector<uint8_t>& out)
+    {
+        const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_PNG);
+        if (!codec)
+        {
+            std::cerr << "PNG encoder not available" << std::endl;
+            return false;
+        }
+
+        AVCodecContext* ctx = avcodec_alloc_context3(codec);
+        AVFrame* frame = av_frame_alloc();
+        AVPacket* packet = av_packet_alloc();
+        bool ok = ctx && frame && packet;
+
+        if (ok)
+        {
+            ctx->width = thumbnail.width;
+            ctx->height = thumbnail.height;
+            ctx->pix_fmt = AV_PIX_FMT_RGB24;
+            ctx->time_base = AVRational{1, 25};
+            ok = avcodec_open2(ctx, codec, nullptr) >= 0;
+        }
+
+        if (ok)
+        {
+            frame->format = AV_PIX_FMT_RGB24;
+            frame->width = thumbnail.width;
+            frame->height = thumbnail.height;
+            frame->data[0] = const_cast<uint8_t*>(thumbnail.rgb.data());
+            frame->linesize[0] = thumbnail.width * 3;
+
+            ok = avcodec_send_frame(ctx, frame) >= 0 && avcodec_send_frame(ctx, nullptr) >= 0;
+            while (ok && avcodec_receive_packet(ctx, packet) == 0)
+            {
+                out.insert(out.end(), packet->data, packet->data + packet->size);
+                av_packet_unref(packet);
+            }
+            ok = ok && !out.empty();
+        }
+
+        av_packet_free(&packet);
+        av_frame_free(&frame);
+        avcodec_free_context(&ctx);
+        return ok;
+    }
+}
+
+double probe_duration(const std::string& path)
+{
+    AVFormatContext* format_ctx = nullptr;
+    if (avformat_open_input(&format_ctx, path.c_str(), nullptr, nullptr) != 0)
+        return 0.0;
+
+    double duration = 0.0;
+    if (avformat_find_stream_info(format_ctx, nullptr) >= 0 && format_ctx->duration != AV_NOPTS_VALUE)
+    {
+        duration = static_cast<double>(format_ctx->duration) / AV_TIME_BASE;
+    }
+    avformat_close_input(&format_ctx);
+    return duration;
+}
+
+std::vector<double> thumbnail_times_every(double duration, double interval)
+{
+    std::vector<double> times;
+    if (interval <= 0.0)
+        return times;
+
+    for (int64_t i = 0; i * interval < duration; i++)
+    {
+        times.push_back(i * interval);
+    }
+    return times;
+}
+
+int extract_thumbnails(const std::string& path, const std::vector<double>& timestamps,
+    const ThumbnailOptions& options, const ThumbnailCallback& on_thumbnail)
+{
+    std::vector<size_t> order(timestamps.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&timestamps](size_t a, size_t b)
+    {
+        return timestamps[a] < timestamps[b];
+    });
+
+    size_t blocks = (order.size() + TIMESTAMPS_PER_BLOCK - 1) / TIMESTAMPS_PER_BLOCK;
+    int workers = options.workers > 0 ? options.workers
+                                      : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    workers = static_cast<int>(std::min<size_t>(workers, std::max<size_t>(blocks, 1)));
+
+    std::atomic<size_t> next_block{0};
+    std::atomic<int> extracted{0};
+    std::atomic<int> opened{0};
+
+    auto worker = [&]()
+    {
+        ThumbnailDecoder decoder;
+        if (!decoder.open(path))
+            return;
+        opened++;
+
+        Thumbnail thumbnail;
+        size_t block;
+        while ((block = next_block.fetch_add(1)) < blocks)
+        {
+            size_t end = std::min(order.size(), (block + 1) * TIMESTAMPS_PER_BLOCK);
+            for (size_t i = block * TIMESTAMPS_PER_BLOCK; i < end; i++)
+            {
+                size_t index = order[i];
+                if (!decoder.frame_at(timestamps[index]) || !decoder.scale(options, thumbnail))
+                {
+                    std::cerr << "No frame for " << timestamps[index] << " s" << std::endl;
+                    continue;
+                }
+
+                thumbnail.index = index;
+                thumbnail.requested_seconds = timestamps[index];
+                thumbnail.frame_seconds = decoder.frame_seconds();
+                on_thumbnail(thumbnail);
+                extracted++;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workers; i++)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    return opened > 0 ? extracted.load() : -1;
+}
+
+bool write_thumbnail(const Thumbnail& thumbnail, const std::string& path, ThumbnailFormat format)
+{
+    std::vector<uint8_t> data;
+    if (format == ThumbnailFormat::Png)
+    {
+        if (!encode_png(thumbnail, data))
+            return false;
+    }
+    else
+    {
+        std::string header = "P6\n" + std::to_string(thumbnail.width) + " " +
+            std::to_string(thumbnail.height) + "\n255\n";
+        data.assign(header.begin(), header.end());
+        data.insert(data.end(), thumbnail.rgb.begin(), thumbnail.rgb.end());
+    }
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        std::cerr << "Could not write " << path << std::endl;
+        return false;
+    }
+    bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    return std::fclose(file) == 0 && ok;
+}
@@ -0,0 +1,57 @@
+#ifndef THUMBNAIL_EXTRACTOR_H
+#define THUMBNAIL_EXTRACTOR_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+enum class ThumbnailFormat
+{
+    Png,
+    // Сырой RGB24 с заголовком PPM (P6)
+    Ppm
+};
+
+struct ThumbnailOptions
+{
+    // 0 — по другой стороне с сохранением пропорций; оба 0 — исходный размер
+    int width = 320;
+    int height = 0;
+    // 0 — по числу логических CPU
+    int workers = 0;
+};
+
+struct Thumbnail
+{
+    // Индекс во входном списке меток времени
+    size_t index = 0;
+    double requested_seconds = 0.0;
+    double frame_seconds = 0.0;
+    int width = 0;
+    int height = 0;
+    // RGB24 без выравнивания строк (stride = width * 3)
+    std::vector<uint8_t> rgb;
+};
+
+// Вызывается из рабочих потоков, одновременно для разных кадров
+using ThumbnailCallback = std::function<void(const Thumbnail& thumbnail)>;
+
+// Длительность файла в секундах, 0 — если неизвестна
+double probe_duration(const std::string& path);
+
+// Метки 0, interval, 2*interval, ... меньше duration
+std::vector<double> thumbnail_times_every(double duration, double interval);
+
+// Достаёт по кадру на каждую метку: переход к ближайшему ключевому кадру
+// перед ней и декодирование вперёд до первого кадра с pts >= метки.
+// У каждого рабочего потока свой AVFormatContext и декодер; метки
+// сортируются и раздаются блоками соседних, чтобы близкие метки
+// декодировались подряд без лишних переходов.
+// Возвращает число извлечённых кадров, -1 — если файл не открылся.
+int extract_thumbnails(const std::string& path, const std::vector<double>& timestamps,
+    const ThumbnailOptions& options, const ThumbnailCallback& on_thumbnail);
+
+bool write_thumbnail(const Thumbnail& thumbnail, const std::string& path, ThumbnailFormat format);
+
+#endif
@@ -0,0 +1,227 @@
+#include "time_stretch.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
+namespace
+{
+    constexpr int SEQUENCE_MS = 40;
+    constexpr int OVERLAP_MS = 8;
+    constexpr int SEEK_MS = 15;
+    // Шаг грубого поиска; точный проходит ±(COARSE_STEP - 1) около лучшего
+    constexpr int COARSE_STEP = 4;
+
+    float dot(const float* a, const float* b, int size)
+    {
+        int i = 0;
+        float sum = 0.0f;
+#if defined(__AVX2__)
+        __m256 acc8 = _mm256_setzero_ps();
+        for (; i + 8 <= size; i += 8)
+        {
+            acc8 = _mm256_add_ps(acc8, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        }
+        alignas(32) float lanes8[8];
+        _mm256_store_ps(lanes8, acc8);
+        for (float lane : lanes8)
+        {
+            sum += lane;
+        }
+#endif
+#if defined(__SSE2__)
+        __m128 acc = _mm_setzero_ps();
+        for (; i + 4 <= size; i += 4)
+        {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        }
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, acc);
+        sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__ARM_NEON)
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (; i + 4 <= size; i += 4)
+        {
+            acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+        }
+        sum += vaddvq_f32(acc);
+#endif
+        for (; i < size; i++)
+        {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+}
+
+TimeStretch::TimeStretch(int sample_rate, int channels)
+    : channels_(std::max(channels, 1))
+{
+    sequence_ = sample_rate * SEQUENCE_MS / 1000;
+    overlap_ = sample_rate * OVERLAP_MS / 1000;
+    seek_ = sample_rate * SEEK_MS / 1000;
+}
+
+void TimeStretch::set_speed(double speed)
+{
+    speed = std::clamp(speed, MIN_SPEED, MAX_SPEED);
+    speed_ = std::abs(speed - 1.0) < 0.001 ? 1.0 : speed;
+}
+
+bool TimeStretch::passthrough() const
+{
+    return speed_ == 1.0 && input_.empty() && mid_.empty();
+}
+
+int TimeStretch::best_offset()
+{
+    const float* x = mono_.data() + read_;
+    const float* reference = mid_mono_.data();
+
+    // Энергия окна при каждом сдвиге — разность префиксных сумм
+    energy_.resize(static_cast<size_t>(seek_) + overlap_ + 1);
+    energy_[0] = 0.0;
+    for (int i = 0; i < seek_ + overlap_; i++)
+    {
+        energy_[i + 1] = energy_[i] + static_cast<double>(x[i]) * x[i];
+    }
+
+    auto score = [&](int offset)
+    {
+        double energy = energy_[offset + overlap_] - energy_[offset];
+        return dot(reference, x + offset, overlap_) / std::sqrt(std::max(energy, 1e-9));
+    };
+
+    int best = 0;
+    double best_score = score(0);
+    for (int offset = COARSE_STEP; offset <= seek_; offset += COARSE_STEP)
+    {
+        double value = score(offset);
+        if (value > best_score)
+        {
+            best_score = value;
+            best = offset;
+        }
+    }
+
+    int coarse = best;
+    for (int offset = std::max(coarse - COARSE_STEP + 1, 0);
+         offset <= std::min(coarse + COARSE_STEP - 1, seek_); offset++)
+    {
+        double value = score(offset);
+        if (offset != coarse && value > best_score)
+        {
+            best_score = value;
+            best = offset;
+        }
+    }
+    return best;
+}
+
+void TimeStretch::process(const int16_t* input, int samples, std::vector<int16_t>& output)
+{
+    output.clear();
+    if (speed_ == 1.0)
+    {
+        flush(output);
+        output.insert(output.end(), input, input + static_cast<size_t>(samples) * channels_);
+        return;
+    }
+
+    input_.insert(input_.end(), input, input + static_cast<size_t>(samples) * channels_);
+    const float scale = 1.0f / (32768.0f * channels_);
+    for (int i = 0; i < samples; i++)
+    {
+        int sum = 0;
+        for (int c = 0; c < channels_; c++)
+        {
+            sum += input[i * channels_ + c];
+        }
+        mono_.push_back(sum * scale);
+    }
+
+    const size_t ch = static_cast<size_t>(channels_);
+    while (mono_.size() >= read_ + seek_ + sequence_)
+    {
+        size_t start = read_ + (mid_.empty() ? 0 : best_offset());
+        const int16_t* x = input_.data() + start * ch;
+
+        size_t out = output.size();
+        output.resize(out + static_cast<size_t>(sequence_ - overlap_) * ch);
+        int16_t* dst = output.data() + out;
+
+        if (mid_.empty())
+        {
+            std::copy(x, x + overlap_ * ch, dst);
+        }
+        else
+        {
+            // Линейный переход от хвоста прошлого отрезка к найденному началу
+            for (int i = 0; i < overlap_; i++)
+            {
+                float weight = (i + 0.5f) / overlap_;
+                for (size_t c = 0; c < ch; c++)
+                {
+                    float value = mid_[i * ch + c] * (1.0f - weight) + x[i * ch + c] * weight;
+                    dst[i * ch + c] = static_cast<int16_t>(std::lrint(value));
+                }
+            }
+        }
+        std::copy(x + overlap_ * ch, x + (sequence_ - overlap_) * ch, dst + overlap_ * ch);
+
+        mid_.assign(x + (sequence_ - overlap_) * ch, x + sequence_ * ch);
+        mid_mono_.assign(mono_.begin() + (start + sequence_ - overlap_), mono_.begin() + (start + sequence_));
+        mid_end_ = start + sequence_;
+
+        skip_remainder_ += (sequence_ - overlap_) * speed_;
+        size_t skip = static_cast<size_t>(skip_remainder_);
+        skip_remainder_ -= static_cast<double>(skip);
+        read_ += skip;
+    }
+    compact();
+}
+
+void TimeStretch::flush(std::vector<int16_t>& output)
+{
+    const size_t ch = static_cast<size_t>(channels_);
+    size_t from = read_;
+    if (!mid_.empty())
+    {
+        output.insert(output.end(), mid_.begin(), mid_.end());
+        from = mid_end_;
+    }
+    if (from * ch < input_.size())
+    {
+        output.insert(output.end(), input_.begin() + from * ch, input_.end());
+    }
+    reset();
+}
+
+void TimeStretch::reset()
+{
+    input_.clear();
+    mono_.clear();
+    mid_.clear();
+    mid_mono_.clear();
+    read_ = 0;
+    mid_end_ = 0;
+    skip_remainder_ = 0.0;
+}
+
+void TimeStretch::compact()
+{
+    // mid_end_ нужен flush(), поэтому держим вход и от него
+    size_t drop = mid_.empty() ? read_ : std::min(read_, mid_end_);
+    if (drop == 0)
+        return;
+
+    input_.erase(input_.begin(), input_.begin() + drop * channels_);
+    mono_.erase(mono_.begin(), mono_.begin() + drop);
+    read_ -= drop;
+    mid_end_ -= drop;
+}
@@ -0,0 +1,63 @@
+#ifndef TIME_STRETCH_H
+#define TIME_STRETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Изменение темпа без изменения высоты тона (WSOLA) для interleaved S16
+// после swr_convert. Вход режется на отрезки по SEQUENCE_MS, соседние
+// перекрываются на OVERLAP_MS с линейным переходом; начало следующего
+// отрезка ищется в окне SEEK_MS около номинального шага по максимуму
+// нормированной корреляции с хвостом предыдущего (сначала грубо через 4
+// сэмпла, затем точно), так что на отрезок приходится фиксированное число
+// операций. На скорости 1.0 сэмплы проходят без изменений.
+class TimeStretch
+{
+public:
+    static constexpr double MIN_SPEED = 0.5;
+    static constexpr double MAX_SPEED = 2.0;
+
+    explicit TimeStretch(int sample_rate, int channels = 2);
+
+    // Зажимается в MIN_SPEED..MAX_SPEED; действует со следующего отрезка
+    void set_speed(double speed);
+    double speed() const
+    {
+        return speed_;
+    }
+
+    // Скорость 1.0 и ничего не накоплено: вход можно отдавать как есть
+    bool passthrough() const;
+
+    // samples сэмплов на канал; output заменяется готовыми. Выход
+    // отстаёт от входа на отрезок с окном поиска
+    void process(const int16_t* input, int samples, std::vector<int16_t>& output);
+    // Отдаёт всё накопленное без растяжения
+    void flush(std::vector<int16_t>& output);
+    void reset();
+
+private:
+    int best_offset();
+    void compact();
+
+    int channels_;
+    int sequence_;
+    int overlap_;
+    int seek_;
+    double speed_ = 1.0;
+    double skip_remainder_ = 0.0;
+
+    // Накопленный вход: interleaved и его моно-версия для поиска.
+    // read_ — начало окна поиска, mid_end_ — сэмпл сразу за хвостом mid_
+    std::vector<int16_t> input_;
+    std::vector<float> mono_;
+    size_t read_ = 0;
+    size_t mid_end_ = 0;
+    // Хвост последнего отрезка, ещё не выданный: с ним сводится следующий
+    std::vector<int16_t> mid_;
+    std::vector<float> mid_mono_;
+    std::vector<double> energy_;
+};
+
+#endif
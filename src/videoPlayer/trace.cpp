@@ -0,0 +1,281 @@
+#include "trace.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<bool> g_trace_enabled{false};
+
+namespace
+{
+    constexpr size_t CHUNK_EVENTS = 8192;
+
+    struct TraceEvent
+    {
+        const char* name;
+        int64_t ts_ns;
+        int64_t dur_ns;
+        int64_t pts;
+        double value;
+        char phase;
+    };
+
+    struct TraceChunk
+    {
+        int tid;
+        std::vector<TraceEvent> events;
+    };
+
+    struct ThreadBuffer
+    {
+        std::mutex mutex;
+        int tid = 0;
+        const char* name = nullptr;
+        std::vector<TraceEvent> events;
+    };
+
+    struct TraceSession
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<TraceChunk> pending;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        std::thread writer;
+        FILE* file = nullptr;
+        bool first_event = true;
+        bool stopping = false;
+        int next_tid = 1;
+        std::chrono::steady_clock::time_point origin;
+    };
+
+    TraceSession session;
+
+    void submit_chunk(int tid, std::vector<TraceEvent>&& events)
+    {
+        if (events.empty())
+            return;
+
+        std::lock_guard<std::mutex> lock(session.mutex);
+        session.pending.push_back(TraceChunk{tid, std::move(events)});
+        session.cv.notify_one();
+    }
+
+    // Буфер регистрируется при первом событии потока и сбрасывает остаток
+    // при завершении потока
+    struct ThreadBufferHolder
+    {
+        std::shared_ptr<ThreadBuffer> buffer;
+
+        ~ThreadBufferHolder()
+        {
+            if (!buffer)
+                return;
+
+            std::vector<TraceEvent> rest;
+            {
+                std::lock_guard<std::mutex> lock(buffer->mutex);
+                rest.swap(buffer->events);
+            }
+            if (trace_enabled())
+            {
+                submit_chunk(buffer->tid, std::move(rest));
+            }
+        }
+    };
+
+    thread_local ThreadBufferHolder thread_buffer;
+
+    ThreadBuffer& current_buffer()
+    {
+        if (!thread_buffer.buffer)
+        {
+            auto buffer = std::make_shared<ThreadBuffer>();
+            buffer->events.reserve(CHUNK_EVENTS);
+
+            std::lock_guard<std::mutex> lock(session.mutex);
+            buffer->tid = session.next_tid++;
+            session.buffers.push_back(buffer);
+            thread_buffer.buffer = buffer;
+        }
+        return *thread_buffer.buffer;
+    }
+
+    void append(const TraceEvent& event)
+    {
+        ThreadBuffer& buffer = current_buffer();
+        std::vector<TraceEvent> full;
+        {
+            std::lock_guard<std::mutex> lock(buffer.mutex);
+            buffer.events.push_back(event);
+            if (buffer.events.size() < CHUNK_EVENTS)
+                return;
+
+            full.swap(buffer.events);
+            buffer.events.reserve(CHUNK_EVENTS);
+        }
+        submit_chunk(buffer.tid, std::move(full));
+    }
+
+    void write_chunk(FILE* file, bool& first_event, const TraceChunk& chunk)
+    {
+        for (const TraceEvent& e : chunk.events)
+        {
+            fputs(first_event ? "\n" : ",\n", file);
+            first_event = false;
+
+            double ts_us = e.ts_ns / 1000.0;
+            switch (e.phase)
+            {
+            case 'M':
+                fprintf(file,
+                    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    chunk.tid, e.name);
+                break;
+            case 'C':
+                fprintf(file,
+                    "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%g}}",
+                    e.name, ts_us, chunk.tid, e.value);
+                break;
+            default:
+                if (e.pts == TraceSpan::NO_PTS)
+                {
+                    fprintf(file,
+                        "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                        e.name, ts_us, e.dur_ns / 1000.0, chunk.tid);
+                }
+                else
+                {
+                    fprintf(file,
+                        "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,"
+                        "\"args\":{\"pts\":%lld}}",
+                        e.name, ts_us, e.dur_ns / 1000.0, chunk.tid, static_cast<long long>(e.pts));
+                }
+                break;
+            }
+        }
+    }
+
+    void writer_thread_func()
+    {
+        std::unique_lock<std::mutex> lock(session.mutex);
+        while (true)
+        {
+            session.cv.wait(lock, []()
+            {
+                return !session.pending.empty() || session.stopping;
+            });
+
+            while (!session.pending.empty())
+            {
+                TraceChunk chunk = std::move(session.pending.front());
+                session.pending.pop_front();
+
+                lock.unlock();
+                write_chunk(session.file, session.first_event, chunk);
+                lock.lock();
+            }
+
+            if (session.stopping)
+                break;
+        }
+    }
+}
+
+int64_t trace_ns(std::chrono::steady_clock::time_point time)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time - session.origin).count();
+}
+
+bool trace_start(const std::string& path)
+{
+    if (trace_enabled())
+        return true;
+
+    session.file = fopen(path.c_str(), "w");
+    if (!session.file)
+    {
+        std::cerr << "Could not open trace file: " << path << std::endl;
+        return false;
+    }
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", session.file);
+    session.first_event = true;
+    session.stopping = false;
+    session.origin = std::chrono::steady_clock::now();
+    session.writer = std::thread(writer_thread_func);
+
+    g_trace_enabled.store(true);
+    return true;
+}
+
+void trace_stop()
+{
+    if (!trace_enabled())
+        return;
+
+    g_trace_enabled.store(false);
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        buffers = session.buffers;
+    }
+
+    for (auto& buffer : buffers)
+    {
+        std::vector<TraceEvent> rest;
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            rest.swap(buffer->events);
+        }
+        submit_chunk(buffer->tid, std::move(rest));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        session.stopping = true;
+        session.cv.notify_one();
+    }
+
+    session.writer.join();
+
+    fputs("\n]}\n", session.file);
+    fclose(session.file);
+    session.file = nullptr;
+}
+
+void trace_set_thread_name(const char* name)
+{
+    if (!trace_enabled())
+        return;
+
+    // Вызывать можно на каждой итерации (например, из audio_callback):
+    // событие пишется только при смене имени
+    ThreadBuffer& buffer = current_buffer();
+    if (buffer.name == name)
+        return;
+    buffer.name = name;
+
+    append(TraceEvent{name, 0, 0, TraceSpan::NO_PTS, 0.0, 'M'});
+}
+
+void trace_complete(const char* name, int64_t start_ns, int64_t end_ns, int64_t pts)
+{
+    if (!trace_enabled())
+        return;
+
+    append(TraceEvent{name, start_ns, end_ns - start_ns, pts, 0.0, 'X'});
+}
+
+void trace_counter(const char* name, double value)
+{
+    if (!trace_enabled())
+        return;
+
+    append(TraceEvent{name, trace_now_ns(), 0, TraceSpan::NO_PTS, value, 'C'});
+}
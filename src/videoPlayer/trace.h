@@ -0,0 +1,77 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Запись таймлайна в формате Chrome trace-event JSON (открывается в Perfetto
+// и chrome://tracing). События копятся в буферах потоков, полные буферы
+// дописываются в файл отдельным потоком.
+
+extern std::atomic<bool> g_trace_enabled;
+
+inline bool trace_enabled()
+{
+    return g_trace_enabled.load(std::memory_order_relaxed);
+}
+
+bool trace_start(const std::string& path);
+void trace_stop();
+
+// Имена событий и потоков должны жить до trace_stop (строковые литералы)
+void trace_set_thread_name(const char* name);
+void trace_complete(const char* name, int64_t start_ns, int64_t end_ns, int64_t pts);
+void trace_counter(const char* name, double value);
+
+int64_t trace_ns(std::chrono::steady_clock::time_point time);
+
+inline int64_t trace_now_ns()
+{
+    return trace_ns(std::chrono::steady_clock::now());
+}
+
+class TraceSpan
+{
+public:
+    static constexpr int64_t NO_PTS = INT64_MIN;
+
+    explicit TraceSpan(const char* name, int64_t pts = NO_PTS)
+        : name_(trace_enabled() ? name : nullptr)
+        , pts_(pts)
+        , start_ns_(name_ ? trace_now_ns() : 0)
+    {
+    }
+
+    ~TraceSpan()
+    {
+        stop();
+    }
+
+    // Закрыть событие раньше конца области видимости (например, перед
+    // co_await: после него корутина может продолжиться в другом потоке)
+    void stop()
+    {
+        if (name_)
+        {
+            trace_complete(name_, start_ns_, trace_now_ns(), pts_);
+            name_ = nullptr;
+        }
+    }
+
+    void set_pts(int64_t pts)
+    {
+        pts_ = pts;
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    int64_t pts_;
+    int64_t start_ns_;
+};
+
+#endif
@@ -1,10 +1,14 @@
 #include "video_decoder.h"
 #include "shared_data.h"
+#include "monochrome.h"
+#include "stage_stats.h"
+#include "trace.h"
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
-#include <thread>
 #include <chrono>
+#include <vector>
 
 extern "C"
 {
@@ -12,120 +16,77 @@ extern "C"
 #include <libswscale/swscale.h>
 }
 
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
-
-#include "Globals.h"
-
-const char* vertex_shader_src = R"(
-#version 330 core
-layout (location = 0) in vec2 aPos;
-layout (location = 1) in vec2 aTexCoord;
-out vec2 TexCoord;
-void main() 
-{
-    gl_Position = vec4(aPos.x, aPos.y, 0.0, 1.0);
-    TexCoord = aTexCoord;
-}
-)";
-
-const char* fragment_shader_src = R"(
-#version 330 core
-in vec2 TexCoord;
-out vec4 FragColor;
-uniform sampler2D ourTexture;
-void main() 
+namespace
 {
-    FragColor = texture(ourTexture, TexCoord);
+    // Плоскость яркости прямо из кадра декодера. Получателю без поддержки
+    // шага строки — строки вплотную
+    void display_luma(const AVFrame* frame, bool strided, std::vector<uint8_t>& packed,
+        VideoSink& sink, double pts)
+    {
+        VideoImage image;
+        image.format = PixelFormat::Gray8;
+        image.width = frame->width;
+        image.height = frame->height;
+        image.limited_range = frame->color_range != AVCOL_RANGE_JPEG &&
+            static_cast<AVPixelFormat>(frame->format) != AV_PIX_FMT_GRAY8;
+        image.data[0] = frame->data[0];
+        image.stride[0] = frame->linesize[0];
+        
+        if (!strided && frame->linesize[0] != frame->width)
+        {
+            StageTimer timer(Stage::VideoScale);
+            packed.resize(static_cast<size_t>(frame->width) * frame->height);
+            av_image_copy_plane(packed.data(), frame->width, frame->data[0], frame->linesize[0],
+                frame->width, frame->height);
+            image.data[0] = packed.data();
+            image.stride[0] = frame->width;
+        }
+        sink.display_image(image, pts);
+    }
 }
-)";
 
-GLuint create_shader_program();
-
-void decode_video(AVCodecContext* video_codec_ctx, AVRational video_time_base,
-    std::shared_ptr<SharedData> shared)
+PipelineTask decode_video(TaskScheduler& scheduler, AVCodecContext* video_codec_ctx,
+    AVRational video_time_base, std::shared_ptr<SharedData> shared, std::shared_ptr<VideoSink> sink)
 {
-    
-    if (!glfwInit())
-    {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
-        return;
-    }
-    
-    GLFWwindow* window = glfwCreateWindow(video_codec_ctx->width, video_codec_ctx->height,
-        "ergtrshsegfa", nullptr, nullptr);
-        
-    if (!window)
+    set_alloc_stage(AllocStage::Video);
+    // Формат кадров выбирает получатель. Кэш кадров и сравнение плиток
+    // работают с packed RGB24, поэтому с ними берём его, если получатель
+    // его понимает
+    OutputFormatRequest request = sink->output_formats();
+    OutputFormat output = negotiate_output_format(request);
+    if (shared->frame_cache || shared->damage_tile_size > 0)
     {
-        std::cerr << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return;
+        if (std::find(request.formats.begin(), request.formats.end(), PixelFormat::Rgb24) != request.formats.end())
+        {
+            output = OutputFormat{};
+        }
+        else
+        {
+            std::cerr << "Frame cache and dirty tiles need RGB24, sink takes "
+                << pixel_format_name(output.format) << "; both are disabled" << std::endl;
+        }
     }
+    const bool packed_rgb = output.format == PixelFormat::Rgb24 && output.row_align == 1;
+    const AVPixelFormat output_pix_fmt = to_av_pixel_format(output.format);
+    std::cout << "Video output: " << pixel_format_name(output.format)
+        << ", row alignment " << output.row_align << std::endl;
     
-    glfwMakeContextCurrent(window);
-    
-    glewExperimental = GL_TRUE;
-    if (glewInit() != GLEW_OK)
+    if (!sink->start())
     {
-        std::cerr << "Failed to initialize GLEW" << std::endl;
-        glfwDestroyWindow(window);
-        glfwTerminate();
-        return;
+        std::cerr << "Failed to start video sink" << std::endl;
+        co_return;
     }
     
-    GLuint shader_program = create_shader_program();
-    
-    float vertices[] = {1.0f,  1.0f,  1.0f, 0.0f, 1.0f,  -1.0f, 1.0f, 1.0f,
-                       -1.0f, -1.0f, 0.0f, 1.0f, -1.0f, 1.0f,  0.0f, 0.0f};
-                       
-    unsigned int indices[] = {0, 1, 3, 1, 2, 3};
-    
-    GLuint VAO, VBO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-    
-    glBindVertexArray(VAO);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-    
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float),
-        (void*)(2 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    
     SwsContext* sws_ctx = sws_getContext(
         video_codec_ctx->width, video_codec_ctx->height, video_codec_ctx->pix_fmt,
-        video_codec_ctx->width, video_codec_ctx->height, AV_PIX_FMT_RGB24,
+        video_codec_ctx->width, video_codec_ctx->height, output_pix_fmt,
         SWS_BILINEAR, nullptr, nullptr, nullptr);
         
     if (!sws_ctx)
     {
         std::cerr << "Failed to create sws context" << std::endl;
-        /*
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
-        glDeleteBuffers(1, &EBO);
-        glDeleteTextures(1, &texture);
-        glDeleteProgram(shader_program);
-        glfwDestroyWindow(window);
-        glfwTerminate();*/
-        return;
+        sink->stop();
+        co_return;
     }
     
     AVFrame* frame = av_frame_alloc();
@@ -133,35 +94,95 @@ void decode_video(AVCodecContext* video_codec_ctx, AVRational video_time_base,
     {
         std::cerr << "Failed to allocate video frame" << std::endl;
         sws_freeContext(sws_ctx);
-        /*glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
-        glDeleteBuffers(1, &EBO);
-        glDeleteTextures(1, &texture);
-        glDeleteProgram(shader_program);
-        glfwDestroyWindow(window);
-        glfwTerminate();*/
-        return;
+        sink->stop();
+        co_return;
     }
     
 
     
+    // Чёрно-белый источник отдаём плоскостью Y без sws_scale, если
+    // получатель принимает GRAY8 и RGB24 не нужен кэшу или плиткам
+    std::unique_ptr<MonochromeDetector> monochrome;
+    std::vector<uint8_t> luma_buffer;
+    bool accepts_gray = std::find(request.formats.begin(), request.formats.end(), PixelFormat::Gray8) !=
+        request.formats.end();
+    if (shared->monochrome != MonochromeMode::Off && accepts_gray && !shared->frame_cache &&
+        shared->damage_tile_size <= 0)
+    {
+        monochrome = std::make_unique<MonochromeDetector>(shared->monochrome, video_codec_ctx->pix_fmt);
+    }
+    
+    // Двухцветный режим: порог яркости, 1 бит на пиксель и дельта к
+    // прошлому кадру. Яркость берётся из плоскости Y, иначе через sws
+    std::unique_ptr<BilevelEncoder> bilevel;
+    SwsContext* luma_sws_ctx = nullptr;
+    std::vector<uint8_t> luma_plane;
+    if (shared->bilevel_threshold > 0)
+    {
+        if (sink->accepts_bilevel())
+        {
+            bilevel = std::make_unique<BilevelEncoder>(static_cast<uint8_t>(std::min(shared->bilevel_threshold, 255)));
+            if (!has_luma_plane(video_codec_ctx->pix_fmt))
+            {
+                luma_sws_ctx = sws_getContext(
+                    video_codec_ctx->width, video_codec_ctx->height, video_codec_ctx->pix_fmt,
+                    video_codec_ctx->width, video_codec_ctx->height, AV_PIX_FMT_GRAY8,
+                    SWS_POINT, nullptr, nullptr, nullptr);
+            }
+        }
+        else
+        {
+            std::cerr << "Video sink does not take bilevel frames, playing in full colour" << std::endl;
+        }
+    }
+    
+    // Файл кадров годится для повтора только целиком: кадр не в packed
+    // RGB24 или пропущенный кадр прекращают запись
+    std::shared_ptr<FrameFileWriter> frame_file = shared->frame_file_writer;
+    if (frame_file && (!packed_rgb || bilevel))
+    {
+        std::cerr << "Frame file needs packed RGB24 output, not writing it" << std::endl;
+        frame_file->abort();
+        frame_file.reset();
+    }
+    
+    // Сравнение с прошлым кадром по плиткам, если получатель их учитывает
+    std::unique_ptr<DamageTracker> damage_tracker;
+    if (shared->damage_tile_size > 0 && packed_rgb)
+    {
+        damage_tracker = std::make_unique<DamageTracker>(shared->damage_tile_size);
+    }
+    
+    // Получатель со своим буфером: кадр масштабируется прямо в него.
+    // Кэшу, плиткам и файлу кадров нужен кадр исходного размера
+    const bool direct_target = sink->provides_target() && !bilevel && !monochrome &&
+        !damage_tracker && !shared->frame_cache && !frame_file;
+    SwsContext* target_sws_ctx = nullptr;
+    
     double last_video_time = 0.0;
+    int64_t previous_pts = AV_NOPTS_VALUE;
     int frames_displayed = 0;
     int frames_dropped = 0;
 
     auto last_fps_time = std::chrono::steady_clock::now();
     int frames_in_second = 0;
 
-    while (shared->video_running && !GLobal::shouldStop)
+    PipelineMetrics& metrics = shared->metrics;
+    metrics.thread_started(PipelineThread::VideoDecode);
+
+    while (shared->video_running)
     {
         std::shared_ptr<AVPacket> packet;
         
         {
+            StageTimer wait_timer(Stage::VideoPacketWait);
             std::unique_lock<std::mutex> lock(shared->packet_mutex);
-            shared->packet_cv.wait(lock, [shared]()
+            const size_t batch = shared->packet_batch();
+            while (shared->video_packets.size() < batch && shared->demuxer_running)
             {
-                return !shared->video_packets.empty() || !shared->demuxer_running;
-            });
+                co_await shared->packet_cv.wait(lock);
+            }
+            wait_timer.stop();
             
             if (!shared->video_running || (!shared->demuxer_running && shared->video_packets.empty()))
             {
@@ -172,17 +193,28 @@ void decode_video(AVCodecContext* video_codec_ctx, AVRational video_time_base,
             {
                 packet = shared->video_packets.front();
                 shared->video_packets.pop();
-                shared->packet_cv.notify_one();
+                if (shared->jitter && packet)
+                {
+                    shared->jitter->remove(JitterStream::Video, packet->duration * av_q2d(video_time_base));
+                }
+                trace_counter("video_packets", shared->video_packets.size());
+                if (batch == 1 || shared->video_packets.size() == shared->MAX_PACKET_QUEUE_SIZE - batch)
+                {
+                    shared->packet_cv.notify_all();
+                }
             }
         }
         
+        TraceSpan packet_span("video_packet", packet ? packet->pts : TraceSpan::NO_PTS);
         if (!packet)
         {
             avcodec_send_packet(video_codec_ctx, nullptr);
         }
         else
         {
+            StageTimer send_timer(Stage::VideoSendPacket);
             int ret = avcodec_send_packet(video_codec_ctx, packet.get());
+            send_timer.stop();
             if (ret < 0)
             {
                 std::cerr << "Error sending packet to video decoder: " << ret
@@ -190,12 +222,15 @@ void decode_video(AVCodecContext* video_codec_ctx, AVRational video_time_base,
                 continue;
             }
         }
+        packet_span.stop();
         
         while (true)
         {
+            StageTimer receive_timer(Stage::VideoReceiveFrame);
             int ret = avcodec_receive_frame(video_codec_ctx, frame);
             if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
             {
+                receive_timer.cancel();
                 break;
             }
             else if (ret < 0)
@@ -203,8 +238,25 @@ void decode_video(AVCodecContext* video_codec_ctx, AVRational video_time_base,
                 std::cerr << "Error during video decoding: " << ret << std::endl;
                 break;
             }
+            receive_timer.stop();
+            TraceSpan frame_span("video_frame", frame->pts);
+            metrics.frames_decoded++;
+            metrics.progress(PipelineThread::VideoDecode);
+            int64_t frame_previous_pts = previous_pts;
+            previous_pts = frame->pts;
             
-            double audio_time = shared->audio_clock.get_time();
+            // Догрузка потока: кадр ждёт вместе с остановленными часами
+            if (shared->jitter && shared->jitter->buffering())
+            {
+                frame_span.stop();
+                while (shared->jitter->buffering() && shared->video_running)
+                {
+                    co_await scheduler.sleep_until(std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(10));
+                }
+            }
+            
+            double audio_time = shared->clock_time();
             double video_time = frame->pts * av_q2d(video_time_base);
             
             if (frames_displayed == 0)
@@ -220,53 +272,142 @@ void decode_video(AVCodecContext* video_codec_ctx, AVRational video_time_base,
                 int64_t sleep_us = static_cast<int64_t>(diff * 1000000 - 50000);
                 if (sleep_us > 0)
                 {
-                    std::this_thread::sleep_for(std::chrono::microseconds(sleep_us));
+                    // Ждём на таймере пула, поток тем временем обслуживает другие задачи
+                    frame_span.stop();
+                    co_await scheduler.sleep_until(std::chrono::steady_clock::now() +
+                        std::chrono::microseconds(sleep_us));
                 }
                 
-                audio_time = shared->audio_clock.get_time();
+                audio_time = shared->clock_time();
                 diff = video_time - audio_time;
             }
+            trace_counter("av_diff_ms", diff * 1000.0);
+            metrics.av_drift_seconds = diff;
+            if (std::abs(diff) > metrics.av_drift_max_abs_seconds)
+            {
+                metrics.av_drift_max_abs_seconds = std::abs(diff);
+            }
             
             if (std::abs(diff) < 0.1)
             {
-                int buffer_size = av_image_get_buffer_size(AV_PIX_FMT_RGB24, video_codec_ctx->width,
-                    video_codec_ctx->height, 1);
-                uint8_t* buffer = (uint8_t*)av_malloc(buffer_size);
+                uint8_t* buffer = nullptr;
+                AVFrame* rgb_frame = nullptr;
                 
-                if (!buffer)
+                if (bilevel)
                 {
-                    std::cerr << "Failed to allocate image buffer" << std::endl;
-                    av_frame_unref(frame);
-                    continue;
+                    StageTimer timer(Stage::VideoScale);
+                    const uint8_t* luma = frame->data[0];
+                    int luma_stride = frame->linesize[0];
+                    if (luma_sws_ctx)
+                    {
+                        luma_plane.resize(static_cast<size_t>(video_codec_ctx->width) * video_codec_ctx->height);
+                        uint8_t* planes[4] = {luma_plane.data()};
+                        int strides[4] = {video_codec_ctx->width};
+                        sws_scale(luma_sws_ctx, frame->data, frame->linesize, 0, video_codec_ctx->height,
+                            planes, strides);
+                        luma = luma_plane.data();
+                        luma_stride = video_codec_ctx->width;
+                    }
+                    const BilevelFrame& packed = bilevel->encode(luma, luma_stride, video_codec_ctx->width,
+                        video_codec_ctx->height);
+                    timer.stop();
+                    
+                    metrics.bilevel_bytes += bilevel->encoded_bytes();
+                    sink->display_bilevel(packed, video_time);
+                }
+                else if (monochrome && monochrome->observe(frame))
+                {
+                    display_luma(frame, request.strided, luma_buffer, *sink, video_time);
                 }
+                else if (direct_target)
+                {
+                    VideoImage target;
+                    if (sink->acquire_target(target))
+                    {
+                        StageTimer timer(Stage::VideoScale);
+                        target_sws_ctx = sws_getCachedContext(target_sws_ctx,
+                            video_codec_ctx->width, video_codec_ctx->height, video_codec_ctx->pix_fmt,
+                            target.width, target.height, to_av_pixel_format(target.format),
+                            SWS_BILINEAR, nullptr, nullptr, nullptr);
+                        if (target_sws_ctx)
+                        {
+                            sws_scale(target_sws_ctx, frame->data, frame->linesize, 0,
+                                video_codec_ctx->height, target.data, target.stride);
+                        }
+                        timer.stop();
+                        sink->release_target(video_time, shared->clock_time() - video_time);
+                    }
+                }
+                else
+                {
+                    int buffer_size = av_image_get_buffer_size(output_pix_fmt, video_codec_ctx->width,
+                        video_codec_ctx->height, output.row_align);
+                    buffer = (uint8_t*)av_malloc(buffer_size);
                 
-                AVFrame* rgb_frame = av_frame_alloc();
-                av_image_fill_arrays(rgb_frame->data, rgb_frame->linesize, buffer,
-                    AV_PIX_FMT_RGB24, video_codec_ctx->width,
-                    video_codec_ctx->height, 1);
+                    if (!buffer)
+                    {
+                        std::cerr << "Failed to allocate image buffer" << std::endl;
+                        av_frame_unref(frame);
+                        continue;
+                    }
+                
+                    rgb_frame = av_frame_alloc();
+                    av_image_fill_arrays(rgb_frame->data, rgb_frame->linesize, buffer,
+                        output_pix_fmt, video_codec_ctx->width,
+                        video_codec_ctx->height, output.row_align);
                     
-                sws_scale(sws_ctx, frame->data, frame->linesize, 0,
-                    video_codec_ctx->height, rgb_frame->data,
-                    rgb_frame->linesize);
-
-                GLobal::frameDisplayer->DisplayFrame(rgb_frame->data[0]);
+                    {
+                        StageTimer timer(Stage::VideoScale);
+                        sws_scale(sws_ctx, frame->data, frame->linesize, 0,
+                            video_codec_ctx->height, rgb_frame->data,
+                            rgb_frame->linesize);
+                    }
 
-                
-                glBindTexture(GL_TEXTURE_2D, texture);
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, video_codec_ctx->width,
-                    video_codec_ctx->height, 0, GL_RGB, GL_UNSIGNED_BYTE,
-                    rgb_frame->data[0]);
+                    if (!packed_rgb)
+                    {
+                        VideoImage image;
+                        image.format = output.format;
+                        image.width = video_codec_ctx->width;
+                        image.height = video_codec_ctx->height;
+                        for (int plane = 0; plane < 4; plane++)
+                        {
+                            image.data[plane] = rgb_frame->data[plane];
+                            image.stride[plane] = rgb_frame->linesize[plane];
+                        }
+                        sink->display_image(image, video_time);
+                    }
+                    else if (damage_tracker)
+                    {
+                        StageTimer damage_timer(Stage::DamageCompare);
+                        const FrameDamage& damage = damage_tracker->update(rgb_frame->data[0],
+                            video_codec_ctx->width, video_codec_ctx->height);
+                        damage_timer.stop();
                     
-                glClear(GL_COLOR_BUFFER_BIT);
-                glUseProgram(shader_program);
-                glBindVertexArray(VAO);
-                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-                
-                glfwSwapBuffers(window);
-                glfwPollEvents();
+                        metrics.damage_tiles_total += static_cast<uint64_t>(damage.columns) * damage.rows;
+                        metrics.damage_tiles_dirty += damage.full ?
+                            static_cast<uint64_t>(damage.columns) * damage.rows : damage.tiles.size();
+                        if (damage.empty())
+                        {
+                            metrics.frames_unchanged++;
+                        }
+                        sink->display_frame_damage(rgb_frame->data[0], video_codec_ctx->width,
+                            video_codec_ctx->height, video_time, damage);
+                    }
+                    else
+                    {
+                        sink->display_frame(rgb_frame->data[0], video_codec_ctx->width,
+                            video_codec_ctx->height, video_time);
+                    }
+                }
                 
+                if (frame_file && (!rgb_frame || !frame_file->append(rgb_frame->data[0], video_time)))
+                {
+                    frame_file->abort();
+                    frame_file.reset();
+                }
                 
                 frames_displayed++;
+                metrics.frames_displayed++;
                 last_video_time = video_time;
                 
                 auto now = std::chrono::steady_clock::now();
@@ -275,6 +416,7 @@ void decode_video(AVCodecContext* video_codec_ctx, AVRational video_time_base,
                 if (elapsed >= 1000)
                 {
                     double fps = frames_in_second * 1000.0 / elapsed;
+                    metrics.video_fps = fps;
                     std::cout << "Video FPS: " << fps 
                             << ", Frames: " << frames_displayed 
                             << ", Dropped: " << frames_dropped << std::endl;
@@ -283,16 +425,59 @@ void decode_video(AVCodecContext* video_codec_ctx, AVRational video_time_base,
                 }
                 frames_in_second++;
                 
+                if (shared->frame_cache && packed_rgb && buffer)
+                {
+                    // Буфер переходит кэшу без копирования
+                    auto cached = std::make_shared<VideoFrame>();
+                    cached->data = buffer;
+                    cached->width = video_codec_ctx->width;
+                    cached->height = video_codec_ctx->height;
+                    cached->pts = frame->pts;
+                    cached->display_time = video_time;
+                    shared->frame_cache->insert(std::move(cached), frame_previous_pts);
+                    buffer = nullptr;
+                }
+                
                 av_frame_free(&rgb_frame);
                 av_free(buffer);
             }
             else if (diff < -0.1)
             {
                 frames_dropped++;
+                metrics.frames_dropped++;
+            }
+            
+            if (frame_file && std::abs(diff) >= 0.1)
+            {
+                std::cerr << "Frame skipped, frame file would be incomplete" << std::endl;
+                frame_file->abort();
+                frame_file.reset();
             }
             
             av_frame_unref(frame);
         }
+        
+        // Декодер слит; при повторе по кругу за пустым пакетом идёт
+        // следующий проход, который без сброса декодер не примет
+        if (!packet)
+        {
+            avcodec_flush_buffers(video_codec_ctx);
+        }
+    }
+    
+    metrics.thread_finished(PipelineThread::VideoDecode);
+    
+    // video_running сброшен — остановили раньше конца файла
+    if (frame_file)
+    {
+        if (shared->video_running)
+        {
+            frame_file->finish();
+        }
+        else
+        {
+            frame_file->abort();
+        }
     }
     
     std::cout << "Video playback finished." << std::endl;
@@ -301,60 +486,84 @@ void decode_video(AVCodecContext* video_codec_ctx, AVRational video_time_base,
     
     av_frame_free(&frame);
     sws_freeContext(sws_ctx);
+    sws_freeContext(luma_sws_ctx);
+    sws_freeContext(target_sws_ctx);
     
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
-    glDeleteTextures(1, &texture);
-    glDeleteProgram(shader_program);
-    
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    sink->stop();
 }
 
-GLuint create_shader_program()
+PipelineTask replay_frame_file(TaskScheduler& scheduler, std::shared_ptr<FrameFileReader> reader,
+    bool audio_sync, std::shared_ptr<SharedData> shared, std::shared_ptr<VideoSink> sink)
 {
-    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &vertex_shader_src, nullptr);
-    glCompileShader(vertex_shader);
-    
-    GLint success;
-    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    set_alloc_stage(AllocStage::Video);
+    if (!sink->start())
     {
-        char info_log[512];
-        glGetShaderInfoLog(vertex_shader, 512, nullptr, info_log);
-        std::cerr << "Vertex shader compilation failed: " << info_log << std::endl;
+        std::cerr << "Failed to start video sink" << std::endl;
+        co_return;
     }
     
-    GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &fragment_shader_src, nullptr);
-    glCompileShader(fragment_shader);
+    PipelineMetrics& metrics = shared->metrics;
+    metrics.thread_started(PipelineThread::VideoDecode);
     
-    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        char info_log[512];
-        glGetShaderInfoLog(fragment_shader, 512, nullptr, info_log);
-        std::cerr << "Fragment shader compilation failed: " << info_log
-            << std::endl;
-    }
+    const int width = reader->width();
+    const int height = reader->height();
+    std::vector<uint8_t> scratch;
+    int frames_displayed = 0;
+    int frames_dropped = 0;
     
-    GLuint shader_program = glCreateProgram();
-    glAttachShader(shader_program, vertex_shader);
-    glAttachShader(shader_program, fragment_shader);
-    glLinkProgram(shader_program);
+    // Без звука кадры идут по монотонным часам от первого кадра
+    const auto start_time = std::chrono::steady_clock::now();
+    const double start_pts = reader->pts(0);
+    auto clock_time = [&]()
+    {
+        if (audio_sync)
+        {
+            return shared->clock_time();
+        }
+        return start_pts + std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    };
     
-    glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
-    if (!success)
+    for (size_t i = 0; i < reader->frame_count() && shared->video_running; i++)
     {
-        char info_log[512];
-        glGetProgramInfoLog(shader_program, 512, nullptr, info_log);
-        std::cerr << "Shader program linking failed: " << info_log << std::endl;
+        double video_time = reader->pts(i);
+        double diff = video_time - clock_time();
+        if (diff > 0.005)
+        {
+            co_await scheduler.sleep_until(std::chrono::steady_clock::now() +
+                std::chrono::microseconds(static_cast<int64_t>(diff * 1000000)));
+            diff = video_time - clock_time();
+        }
+        metrics.progress(PipelineThread::VideoDecode);
+        metrics.av_drift_seconds = diff;
+        if (std::abs(diff) > metrics.av_drift_max_abs_seconds)
+        {
+            metrics.av_drift_max_abs_seconds = std::abs(diff);
+        }
+        
+        if (diff < -0.1)
+        {
+            frames_dropped++;
+            metrics.frames_dropped++;
+            continue;
+        }
+        
+        uint8_t* rgb = reader->frame(i, scratch);
+        if (!rgb)
+        {
+            std::cerr << "Corrupt frame " << i << " in frame file" << std::endl;
+            break;
+        }
+        
+        sink->display_frame(rgb, width, height, video_time);
+        frames_displayed++;
+        metrics.frames_displayed++;
     }
     
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
+    metrics.thread_finished(PipelineThread::VideoDecode);
     
-    return shader_program;
-}
\ No newline at end of file
+    std::cout << "Frame file replay finished." << std::endl;
+    std::cout << "Total frames displayed: " << frames_displayed << std::endl;
+    std::cout << "Total frames dropped: " << frames_dropped << std::endl;
+    
+    sink->stop();
+}
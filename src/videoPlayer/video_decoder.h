@@ -2,13 +2,20 @@
 #define VIDEO_DECODER_H
 
 #include "shared_data.h"
+#include "video_sink.h"
 
 extern "C"
 {
 #include <libavcodec/avcodec.h>
 }
 
-void decode_video(AVCodecContext* video_codec_ctx, AVRational video_time_base,
-    std::shared_ptr<SharedData> shared);
+PipelineTask decode_video(TaskScheduler& scheduler, AVCodecContext* video_codec_ctx,
+    AVRational video_time_base, std::shared_ptr<SharedData> shared, std::shared_ptr<VideoSink> sink);
+
+// Повтор из файла кадров (FrameFileStore) вместо decode_video: кадры идут
+// получателю прямо из отображения файла. audio_sync — по часам звука,
+// иначе по монотонным часам
+PipelineTask replay_frame_file(TaskScheduler& scheduler, std::shared_ptr<FrameFileReader> reader,
+    bool audio_sync, std::shared_ptr<SharedData> shared, std::shared_ptr<VideoSink> sink);
 
 #endif
\ No newline at end of file
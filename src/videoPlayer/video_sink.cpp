@@ -0,0 +1,219 @@
+#include "video_sink.h"
+
+NullVideoSink::NullVideoSink(PixelFormat format)
+    : format_(format)
+{
+}
+
+OutputFormatRequest NullVideoSink::output_formats() const
+{
+    return {{format_}, true};
+}
+
+void NullVideoSink::display_frame(uint8_t* rgb, int width, int height, double pts)
+{
+    frames_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void NullVideoSink::display_image(const VideoImage& image, double pts)
+{
+    frames_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool NullVideoSink::accepts_bilevel() const
+{
+    return true;
+}
+
+void NullVideoSink::display_bilevel(const BilevelFrame& frame, double pts)
+{
+    frames_.fetch_add(1, std::memory_order_relaxed);
+}
+
+TeeVideoSink::TeeVideoSink(std::vector<std::shared_ptr<VideoSink>> sinks)
+    : sinks_(std::move(sinks))
+{
+}
+
+void TeeVideoSink::set_video_size(int width, int height)
+{
+    for (auto& sink : sinks_)
+    {
+        sink->set_video_size(width, height);
+    }
+}
+
+void TeeVideoSink::wait_ready()
+{
+    for (auto& sink : sinks_)
+    {
+        sink->wait_ready();
+    }
+}
+
+bool TeeVideoSink::start()
+{
+    for (started_ = 0; started_ < sinks_.size(); started_++)
+    {
+        if (!sinks_[started_]->start())
+        {
+            stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+OutputFormatRequest TeeVideoSink::output_formats() const
+{
+    std::vector<OutputFormatRequest> requests;
+    for (const auto& sink : sinks_)
+    {
+        requests.push_back(sink->output_formats());
+    }
+    return intersect_output_formats(requests);
+}
+
+void TeeVideoSink::display_frame(uint8_t* rgb, int width, int height, double pts)
+{
+    for (auto& sink : sinks_)
+    {
+        sink->display_frame(rgb, width, height, pts);
+    }
+}
+
+void TeeVideoSink::display_frame_damage(uint8_t* rgb, int width, int height, double pts,
+    const FrameDamage& damage)
+{
+    for (auto& sink : sinks_)
+    {
+        sink->display_frame_damage(rgb, width, height, pts, damage);
+    }
+}
+
+void TeeVideoSink::display_image(const VideoImage& image, double pts)
+{
+    for (auto& sink : sinks_)
+    {
+        sink->display_image(image, pts);
+    }
+}
+
+bool TeeVideoSink::accepts_bilevel() const
+{
+    for (const auto& sink : sinks_)
+    {
+        if (!sink->accepts_bilevel())
+            return false;
+    }
+    return !sinks_.empty();
+}
+
+void TeeVideoSink::display_bilevel(const BilevelFrame& frame, double pts)
+{
+    for (auto& sink : sinks_)
+    {
+        sink->display_bilevel(frame, pts);
+    }
+}
+
+void TeeVideoSink::stop()
+{
+    while (started_ > 0)
+    {
+        sinks_[--started_]->stop();
+    }
+}
+
+PersistentVideoSink::PersistentVideoSink(std::shared_ptr<VideoSink> sink)
+    : sink_(std::move(sink))
+{
+}
+
+void PersistentVideoSink::set_video_size(int width, int height)
+{
+    std::lock_guard<std::mutex> lock(size_mutex_);
+    pending_width_ = width;
+    pending_height_ = height;
+}
+
+void PersistentVideoSink::apply_video_size()
+{
+    int width;
+    int height;
+    {
+        std::lock_guard<std::mutex> lock(size_mutex_);
+        width = pending_width_;
+        height = pending_height_;
+        pending_width_ = 0;
+        pending_height_ = 0;
+    }
+    if (width > 0 && height > 0)
+    {
+        sink_->set_video_size(width, height);
+    }
+}
+
+void PersistentVideoSink::wait_ready()
+{
+    if (!ready_)
+    {
+        // Первый файл: получатель ждёт размер, чтобы открыться
+        apply_video_size();
+        sink_->wait_ready();
+        ready_ = true;
+    }
+}
+
+bool PersistentVideoSink::start()
+{
+    if (!started_)
+    {
+        started_ = sink_->start();
+    }
+    return started_;
+}
+
+OutputFormatRequest PersistentVideoSink::output_formats() const
+{
+    return sink_->output_formats();
+}
+
+void PersistentVideoSink::display_frame(uint8_t* rgb, int width, int height, double pts)
+{
+    sink_->display_frame(rgb, width, height, pts);
+}
+
+void PersistentVideoSink::display_frame_damage(uint8_t* rgb, int width, int height, double pts,
+    const FrameDamage& damage)
+{
+    sink_->display_frame_damage(rgb, width, height, pts, damage);
+}
+
+void PersistentVideoSink::display_image(const VideoImage& image, double pts)
+{
+    sink_->display_image(image, pts);
+}
+
+bool PersistentVideoSink::accepts_bilevel() const
+{
+    return sink_->accepts_bilevel();
+}
+
+void PersistentVideoSink::display_bilevel(const BilevelFrame& frame, double pts)
+{
+    sink_->display_bilevel(frame, pts);
+}
+
+void PersistentVideoSink::stop()
+{
+}
+
+void PersistentVideoSink::finish()
+{
+    if (started_)
+    {
+        sink_->stop();
+        started_ = false;
+    }
+}
@@ -0,0 +1,182 @@
+#ifndef VIDEO_SINK_H
+#define VIDEO_SINK_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "bilevel.h"
+#include "frame_damage.h"
+#include "pixel_format.h"
+
+// Получатель готовых кадров. По умолчанию RGB24 (packed, выравнивание
+// строк 1) через display_frame; получатель может запросить другой формат
+// и шаг строк через output_formats(), тогда кадры идут в display_image.
+// set_video_size и wait_ready вызываются из MediaPlayer, start/display_frame/stop —
+// из потока декодирования видео (там, где нужен GL-контекст).
+// pts — время кадра в секундах от начала потока.
+class VideoSink
+{
+public:
+    virtual ~VideoSink() = default;
+
+    virtual void set_video_size(int width, int height)
+    {
+    }
+
+    virtual void wait_ready()
+    {
+    }
+
+    virtual bool start()
+    {
+        return true;
+    }
+
+    // Спрашивается один раз перед start()
+    virtual OutputFormatRequest output_formats() const
+    {
+        return {};
+    }
+
+    virtual void display_frame(uint8_t* rgb, int width, int height, double pts) = 0;
+
+    // Вызывается вместо display_frame, когда включено отслеживание
+    // изменившихся плиток (PlayerConfig::damage_tile_size). Получатель
+    // может перерисовать только их; по умолчанию — весь кадр
+    virtual void display_frame_damage(uint8_t* rgb, int width, int height, double pts,
+        const FrameDamage& damage)
+    {
+        display_frame(rgb, width, height, pts);
+    }
+
+    // Кадр в формате, выбранном по output_formats(). Packed RGB24 по
+    // умолчанию уходит в display_frame
+    virtual void display_image(const VideoImage& image, double pts)
+    {
+        display_frame(image.data[0], image.width, image.height, pts);
+    }
+
+    // Двухцветный режим (PlayerConfig::bilevel_threshold): кадры идут в
+    // display_bilevel только получателям, которые его понимают
+    virtual bool accepts_bilevel() const
+    {
+        return false;
+    }
+
+    virtual void display_bilevel(const BilevelFrame& frame, double pts)
+    {
+    }
+
+    // Получатель со своим буфером (плитка видеостены): декодер масштабирует
+    // кадр прямо в место, которое даёт acquire_target, без кадра исходного
+    // размера. Спрашивается один раз перед start()
+    virtual bool provides_target() const
+    {
+        return false;
+    }
+
+    // Формат, размер и плоскости под очередной кадр; буфер принадлежит
+    // декодеру до release_target. false — кадр пропускается
+    virtual bool acquire_target(VideoImage& image)
+    {
+        return false;
+    }
+
+    // late — на сколько секунд кадр отстал от часов плеера, когда лёг в
+    // буфер (отрицательное — раньше срока)
+    virtual void release_target(double pts, double late)
+    {
+    }
+
+    virtual void stop()
+    {
+    }
+};
+
+// Ничего не показывает, только считает кадры (для замеров без окна)
+class NullVideoSink : public VideoSink
+{
+public:
+    // format — в каком формате просить кадры (для замеров стоимости
+    // преобразования)
+    explicit NullVideoSink(PixelFormat format = PixelFormat::Rgb24);
+
+    OutputFormatRequest output_formats() const override;
+    void display_frame(uint8_t* rgb, int width, int height, double pts) override;
+    void display_image(const VideoImage& image, double pts) override;
+    bool accepts_bilevel() const override;
+    void display_bilevel(const BilevelFrame& frame, double pts) override;
+
+    uint64_t frames() const
+    {
+        return frames_.load(std::memory_order_relaxed);
+    }
+
+private:
+    PixelFormat format_;
+    std::atomic<uint64_t> frames_{0};
+};
+
+// Раздаёт кадры нескольким получателям по порядку
+class TeeVideoSink : public VideoSink
+{
+public:
+    explicit TeeVideoSink(std::vector<std::shared_ptr<VideoSink>> sinks);
+
+    void set_video_size(int width, int height) override;
+    void wait_ready() override;
+    bool start() override;
+    OutputFormatRequest output_formats() const override;
+    void display_frame(uint8_t* rgb, int width, int height, double pts) override;
+    void display_frame_damage(uint8_t* rgb, int width, int height, double pts,
+        const FrameDamage& damage) override;
+    void display_image(const VideoImage& image, double pts) override;
+    bool accepts_bilevel() const override;
+    void display_bilevel(const BilevelFrame& frame, double pts) override;
+    void stop() override;
+
+private:
+    std::vector<std::shared_ptr<VideoSink>> sinks_;
+    size_t started_ = 0;
+};
+
+// Держит получатель открытым между несколькими плеерами подряд
+// (плейлист): wait_ready и start доходят до него один раз, stop от
+// плеера игнорируется, а закрывает получатель finish().
+// Следующий файл готовится в другом потоке, пока играет текущий, поэтому
+// set_video_size только запоминает размер; до получателя он доходит в
+// первом wait_ready или в apply_video_size() при переключении файлов.
+class PersistentVideoSink : public VideoSink
+{
+public:
+    explicit PersistentVideoSink(std::shared_ptr<VideoSink> sink);
+
+    void set_video_size(int width, int height) override;
+    void wait_ready() override;
+    bool start() override;
+    OutputFormatRequest output_formats() const override;
+    void display_frame(uint8_t* rgb, int width, int height, double pts) override;
+    void display_frame_damage(uint8_t* rgb, int width, int height, double pts,
+        const FrameDamage& damage) override;
+    void display_image(const VideoImage& image, double pts) override;
+    bool accepts_bilevel() const override;
+    void display_bilevel(const BilevelFrame& frame, double pts) override;
+    void stop() override;
+
+    // Вызывается после конца предыдущего файла, до start() следующего
+    void apply_video_size();
+    void finish();
+
+private:
+    std::shared_ptr<VideoSink> sink_;
+    std::mutex size_mutex_;
+    int pending_width_ = 0;
+    int pending_height_ = 0;
+    bool ready_ = false;
+    bool started_ = false;
+};
+
+#endif
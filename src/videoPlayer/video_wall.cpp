@@ -0,0 +1,335 @@
+#include "video_wall.h"
+#include "thread_budget.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+extern "C"
+{
+#include <libswscale/swscale.h>
+}
+
+// Плитка общего буфера. Кадр вписывается в неё с сохранением пропорций
+// и пишется декодером прямо на место; между acquire_target и
+// release_target плитка заперта, и презентер не отдаёт полкадра
+class VideoWall::TileSink : public VideoSink
+{
+public:
+    TileSink(uint8_t* origin, int stride, int width, int height, double tick_seconds)
+        : origin_(origin), stride_(stride), width_(width), height_(height), tick_seconds_(tick_seconds)
+    {
+    }
+
+    ~TileSink() override
+    {
+        sws_freeContext(sws_ctx_);
+    }
+
+    void set_video_size(int width, int height) override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (width <= 0 || height <= 0)
+            return;
+
+        double scale = std::min(static_cast<double>(width_) / width, static_cast<double>(height_) / height);
+        fit_width_ = std::clamp(static_cast<int>(width * scale), 1, width_);
+        fit_height_ = std::clamp(static_cast<int>(height * scale), 1, height_);
+        fit_x_ = (width_ - fit_width_) / 2;
+        fit_y_ = (height_ - fit_height_) / 2;
+    }
+
+    OutputFormatRequest output_formats() const override
+    {
+        return {{PixelFormat::Rgb24}, true};
+    }
+
+    bool provides_target() const override
+    {
+        return true;
+    }
+
+    bool acquire_target(VideoImage& image) override
+    {
+        mutex_.lock();
+        if (fit_width_ <= 0 || fit_height_ <= 0)
+        {
+            mutex_.unlock();
+            return false;
+        }
+
+        image.format = PixelFormat::Rgb24;
+        image.width = fit_width_;
+        image.height = fit_height_;
+        image.data[0] = origin_ + static_cast<size_t>(fit_y_) * stride_ + static_cast<size_t>(fit_x_) * 3;
+        image.stride[0] = stride_;
+        return true;
+    }
+
+    void release_target(double pts, double late) override
+    {
+        frames_++;
+        late = std::max(late, 0.0);
+        late_sum_ += late;
+        late_max_ = std::max(late_max_, late);
+        if (late > tick_seconds_)
+        {
+            late_frames_++;
+        }
+        mutex_.unlock();
+    }
+
+    // Кадр исходного размера (повтор из файла кадров и т. п.): тот же
+    // масштаб в плитку, только из готового RGB24
+    void display_frame(uint8_t* rgb, int width, int height, double pts) override
+    {
+        VideoImage target;
+        if (!acquire_target(target))
+            return;
+
+        sws_ctx_ = sws_getCachedContext(sws_ctx_, width, height, AV_PIX_FMT_RGB24,
+            target.width, target.height, AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (sws_ctx_)
+        {
+            const uint8_t* planes[4] = {rgb};
+            int strides[4] = {width * 3};
+            sws_scale(sws_ctx_, planes, strides, 0, height, target.data, target.stride);
+        }
+        frames_++;
+        mutex_.unlock();
+    }
+
+    void stop() override
+    {
+        finished_ = true;
+    }
+
+    bool finished() const
+    {
+        return finished_;
+    }
+
+    void lock()
+    {
+        mutex_.lock();
+    }
+
+    void unlock()
+    {
+        mutex_.unlock();
+    }
+
+    void fill_report(WallTileReport& report)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        report.frames = frames_;
+        report.late_frames = late_frames_;
+        report.mean_late_seconds = frames_ > 0 ? late_sum_ / frames_ : 0.0;
+        report.max_late_seconds = late_max_;
+    }
+
+private:
+    uint8_t* origin_;
+    int stride_;
+    int width_;
+    int height_;
+    double tick_seconds_;
+
+    std::mutex mutex_;
+    int fit_x_ = 0;
+    int fit_y_ = 0;
+    int fit_width_ = 0;
+    int fit_height_ = 0;
+    SwsContext* sws_ctx_ = nullptr;
+    uint64_t frames_ = 0;
+    uint64_t late_frames_ = 0;
+    double late_sum_ = 0.0;
+    double late_max_ = 0.0;
+    std::atomic<bool> finished_{false};
+};
+
+VideoWall::~VideoWall()
+{
+    stop();
+}
+
+bool VideoWall::play(const std::vector<std::string>& paths, const VideoWallOptions& options,
+    const PlayerConfig& config, std::shared_ptr<VideoSink> output)
+{
+    const int width = std::max(options.width, 1);
+    const int height = std::max(options.height, 1);
+    const int stride = width * 3;
+    const double tick_seconds = 1.0 / std::max(options.fps, 1.0);
+
+    int count = std::max(static_cast<int>(paths.size()), 1);
+    int columns = options.columns > 0 ? options.columns : static_cast<int>(std::ceil(std::sqrt(count)));
+    columns = std::min(columns, count);
+    int rows = (count + columns - 1) / columns;
+    buffer_.assign(static_cast<size_t>(stride) * height, 0);
+    auto clock = std::make_shared<AudioClock>();
+    // Плитки идут по общим часам, поэтому темп задаётся им, а не плеерам
+    clock->set_speed(config.speed);
+
+    // Плитки не умеют кэш, сравнение плиток и двухцветный режим: всем им
+    // нужен кадр исходного размера
+    PlayerConfig tile_config = config;
+    tile_config.video_only = true;
+    tile_config.clock = clock;
+    tile_config.audio_device.reset();
+    tile_config.frame_cache.reset();
+    tile_config.frame_files.reset();
+    tile_config.damage_tile_size = 0;
+    tile_config.bilevel_threshold = 0;
+    // Параллельность даёт число файлов, а не потоки внутри декодера
+    tile_config.decode_threads = 1;
+    if (config.power_save)
+    {
+        // До общего пула: его потоки наследуют допуск
+        set_timer_slack(POWER_SAVE_TIMER_SLACK);
+    }
+    if (!tile_config.scheduler)
+    {
+        int threads = std::max(DEFAULT_PIPELINE_THREADS, static_cast<int>(std::thread::hardware_concurrency()));
+        tile_config.scheduler = std::make_shared<TaskScheduler>(threads);
+    }
+
+    reports_.assign(paths.size(), WallTileReport{});
+    size_t opened = 0;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        int column = static_cast<int>(i) % columns;
+        int row = static_cast<int>(i) / columns;
+        int x0 = column * width / columns;
+        int x1 = (column + 1) * width / columns;
+        int y0 = row * height / rows;
+        int y1 = (row + 1) * height / rows;
+
+        auto tile = std::make_shared<TileSink>(buffer_.data() + static_cast<size_t>(y0) * stride + x0 * 3,
+            stride, x1 - x0, y1 - y0, tick_seconds);
+        tile_config.video_sink = tile;
+
+        auto player = std::make_unique<MediaPlayer>();
+        reports_[i].path = paths[i];
+        if (!stopped_ && player->initialize(paths[i], tile_config))
+        {
+            player->preroll();
+            opened++;
+        }
+        else
+        {
+            std::cerr << "Video wall tile stays empty: " << paths[i] << std::endl;
+            reports_[i].failed = true;
+            tile->stop();
+            player.reset();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        tiles_.push_back(std::move(tile));
+        players_.push_back(std::move(player));
+    }
+
+    if (opened == 0 || stopped_)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        players_.clear();
+        return false;
+    }
+
+    output->set_video_size(width, height);
+    output->wait_ready();
+    bool started = output->start();
+    if (!started)
+    {
+        std::cerr << "Failed to start video wall output" << std::endl;
+        stop();
+    }
+    else
+    {
+        // Очереди пакетов уже полны; часы пускаются перед декодерами
+        clock->update(0, 1.0, 0, 1);
+        for (auto& player : players_)
+        {
+            if (player)
+            {
+                player->start();
+            }
+        }
+    }
+
+    const auto tick = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(tick_seconds));
+    auto next_tick = std::chrono::steady_clock::now();
+    uint64_t ticks = 0;
+    while (started && !stopped_)
+    {
+        bool running = std::any_of(tiles_.begin(), tiles_.end(),
+            [](const std::shared_ptr<TileSink>& tile) { return !tile->finished(); });
+        if (!running)
+            break;
+
+        // Плитки запираются по порядку, декодер держит только свою
+        for (auto& tile : tiles_)
+        {
+            tile->lock();
+        }
+        output->display_frame(buffer_.data(), width, height, clock->get_time());
+        for (auto& tile : tiles_)
+        {
+            tile->unlock();
+        }
+        ticks++;
+
+        // Не успели — следующий кадр сразу, пропущенные такты не догоняем
+        next_tick += tick;
+        auto now = std::chrono::steady_clock::now();
+        if (next_tick < now)
+        {
+            next_tick = now;
+        }
+        std::this_thread::sleep_until(next_tick);
+    }
+
+    if (started)
+    {
+        output->stop();
+    }
+
+    for (size_t i = 0; i < players_.size(); i++)
+    {
+        if (!players_[i])
+            continue;
+
+        if (stopped_)
+        {
+            players_[i]->stop();
+        }
+        players_[i]->wait();
+        reports_[i].frames_dropped = players_[i]->stats().frames_dropped;
+        players_[i]->cleanup();
+        tiles_[i]->fill_report(reports_[i]);
+    }
+
+    std::cout << "Video wall: " << opened << "/" << paths.size() << " tiles, "
+              << columns << "x" << rows << ", " << ticks << " frames composed" << std::endl;
+    return started;
+}
+
+void VideoWall::stop()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+    for (auto& player : players_)
+    {
+        if (player)
+        {
+            player->stop();
+        }
+    }
+}
+
+std::vector<WallTileReport> VideoWall::report() const
+{
+    return reports_;
+}
@@ -0,0 +1,82 @@
+#ifndef VIDEO_WALL_H
+#define VIDEO_WALL_H
+
+#include "audio_clock.h"
+#include "media_player.h"
+#include "video_sink.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct VideoWallOptions
+{
+    // Сетка; 0 — квадратная по числу файлов
+    int columns = 0;
+    // Размер общего кадра
+    int width = 1920;
+    int height = 1080;
+    // Сколько раз в секунду общий кадр уходит получателю
+    double fps = 30.0;
+};
+
+// Опоздание кадров одной плитки относительно общих часов
+struct WallTileReport
+{
+    std::string path;
+    // Файл не открылся, плитка осталась чёрной
+    bool failed = false;
+    uint64_t frames = 0;
+    // Кадры, легшие в плитку позже, чем через период общего кадра
+    uint64_t late_frames = 0;
+    // Кадры, которые плеер пропустил, не успев к своему времени
+    uint64_t frames_dropped = 0;
+    double mean_late_seconds = 0.0;
+    double max_late_seconds = 0.0;
+};
+
+// Видеостена: несколько файлов в одном кадре. Каждый файл играет свой
+// MediaPlayer без звука на общем пуле задач, а его декодер масштабирует
+// кадр прямо в плитку общего буфера (VideoSink::acquire_target), так что
+// кадров исходного размера нет вовсе. Все плееры идут по одним часам;
+// с частотой fps собранный кадр целиком уходит получателю через
+// display_frame.
+class VideoWall
+{
+public:
+    VideoWall() = default;
+    ~VideoWall();
+
+    VideoWall(const VideoWall&) = delete;
+    VideoWall& operator=(const VideoWall&) = delete;
+
+    // Играет, пока не закончатся все файлы или не придёт stop().
+    // config — общие настройки плееров; video_sink, scheduler, clock и
+    // звук в нём задаёт стена. output получает собранные кадры и
+    // запускается (start/stop) из вызывающего потока. false — ни один
+    // файл не открылся
+    bool play(const std::vector<std::string>& paths, const VideoWallOptions& options,
+        const PlayerConfig& config, std::shared_ptr<VideoSink> output);
+
+    // Можно вызывать из любого потока
+    void stop();
+
+    // По плитке на файл, после play()
+    std::vector<WallTileReport> report() const;
+
+private:
+    class TileSink;
+
+    std::vector<uint8_t> buffer_;
+    std::vector<std::shared_ptr<TileSink>> tiles_;
+    std::vector<std::unique_ptr<MediaPlayer>> players_;
+    std::vector<WallTileReport> reports_;
+
+    std::mutex mutex_;
+    std::atomic<bool> stopped_{false};
+};
+
+#endif
@@ -0,0 +1,161 @@
+// Эталонный читатель кольца кадров: подключается к плееру, запущенному
+// с --shm <name>, и печатает, сколько кадров получено и пропущено.
+// --hold-ms имитирует медленного читателя, --dump сохраняет последний кадр.
+
+#include <videoPlayer/frame_ring.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace
+{
+    void print_usage(const char* program)
+    {
+        std::cout << "Usage: " << program << " <name> [options]" << std::endl
+                  << "  --frames <n>           stop after <n> frames (default: until the player exits)" << std::endl
+                  << "  --hold-ms <ms>         keep each frame pinned for <ms> to simulate a slow reader" << std::endl
+                  << "  --dump <file.ppm>      save the last received frame" << std::endl;
+    }
+
+    bool dump_ppm(const FrameView& view, const std::string& path)
+    {
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+
+        std::fprintf(file, "P6\n%d %d\n255\n", view.width, view.height);
+        bool ok = true;
+        for (int y = 0; y < view.height && ok; y++)
+        {
+            ok = std::fwrite(view.rgb + static_cast<size_t>(y) * view.stride, 1,
+                static_cast<size_t>(view.width) * 3, file) == static_cast<size_t>(view.width) * 3;
+        }
+        return std::fclose(file) == 0 && ok;
+    }
+
+    // Читает каждый байт строки, чтобы замер включал реальный доступ к памяти
+    uint64_t checksum(const FrameView& view)
+    {
+        uint64_t sum = 0;
+        for (int y = 0; y < view.height; y++)
+        {
+            const uint8_t* row = view.rgb + static_cast<size_t>(y) * view.stride;
+            for (int x = 0; x < view.width * 3; x++)
+            {
+                sum += row[x];
+            }
+        }
+        return sum;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || std::strcmp(argv[1], "--help") == 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::string name = argv[1];
+    if (name[0] != '/')
+    {
+        name.insert(0, "/");
+    }
+
+    uint64_t max_frames = 0;
+    int hold_ms = 0;
+    std::string dump_path;
+    for (int i = 2; i < argc; i++)
+    {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--frames") == 0 && has_value)
+        {
+            max_frames = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--hold-ms") == 0 && has_value)
+        {
+            hold_ms = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--dump") == 0 && has_value)
+        {
+            dump_path = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Unknown or incomplete option: " << argv[i] << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    FrameRingReader reader;
+    // Плеер создаёт кольцо только после открытия файла
+    while (!reader.attach(name))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+
+    const FrameRingHeader* header = reader.header();
+    std::cout << "Attached to " << name << ": " << header->width << "x" << header->height
+              << ", " << header->slot_count << " slots" << std::endl;
+
+    uint64_t received = 0;
+    uint64_t skipped = 0;
+    uint64_t second_frames = 0;
+    auto second_start = std::chrono::steady_clock::now();
+    FrameView view;
+
+    while (max_frames == 0 || received < max_frames)
+    {
+        FrameRingStatus status = reader.acquire(view, 1000);
+        if (status == FrameRingStatus::Closed)
+            break;
+
+        if (status == FrameRingStatus::Frame)
+        {
+            received++;
+            second_frames++;
+            skipped += view.skipped;
+            uint64_t sum = checksum(view);
+
+            if (hold_ms > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(hold_ms));
+            }
+            if (!dump_path.empty() && (max_frames == 0 || received == max_frames))
+            {
+                dump_ppm(view, dump_path);
+            }
+            reader.release(view);
+
+            if (received == 1)
+            {
+                std::cout << "First frame #" << view.sequence << " pts " << view.pts
+                          << " checksum " << sum << std::endl;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - second_start).count();
+        if (elapsed >= 1.0)
+        {
+            std::cout << "Reader FPS: " << second_frames / elapsed
+                      << ", Received: " << received
+                      << ", Skipped: " << skipped
+                      << ", Writer dropped: " << header->dropped_frames.load(std::memory_order_relaxed)
+                      << ", Last pts: " << view.pts << std::endl;
+            second_start = now;
+            second_frames = 0;
+        }
+    }
+
+    std::cout << "Done: received " << received << ", skipped " << skipped << std::endl;
+    reader.detach();
+    return 0;
+}